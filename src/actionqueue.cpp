@@ -0,0 +1,23 @@
+#include "actionqueue.h"
+
+//
+// CActionQueue
+//
+
+CActionQueue::CActionQueue()
+{
+
+}
+
+CActionQueue::~CActionQueue()
+{
+
+}
+
+void CActionQueue::Push(uint8_t PID, const BYTEVIEW &Payload, uint64_t Received)
+{
+	// the payload comes from a single W3GS packet so its length always fits in 16 bits
+
+	m_Actions.push_back(CAction{ (uint32_t)m_Data.size(), (uint16_t)Payload.size(), PID, Received });
+	m_Data.insert(end(m_Data), begin(Payload), end(Payload));
+}
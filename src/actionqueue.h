@@ -0,0 +1,52 @@
+#ifndef AURA_ACTIONQUEUE_H_
+#define AURA_ACTIONQUEUE_H_
+
+#include "util.h"
+
+#include <vector>
+#include <stdint.h>
+
+//
+// CActionQueue
+//
+// the actions received from the players since the last action packet was sent
+// the payloads are appended back to back to a single buffer and indexed by (PID, offset, length)
+// so queueing an action doesn't allocate anything once the buffers have grown to fit a busy tick
+// Clear keeps the storage around for the next tick
+//
+
+class CActionQueue
+{
+public:
+	struct CAction
+	{
+		uint32_t Offset;                              // the offset of the payload in m_Data
+		uint16_t Length;                              // the length of the payload
+		uint8_t PID;
+		uint64_t Received;                            // GetProfileTime when the action arrived (for CRelayStats)
+	};
+
+private:
+	BYTEARRAY m_Data;
+	std::vector<CAction> m_Actions;
+
+public:
+	CActionQueue();
+	~CActionQueue();
+	CActionQueue(CActionQueue &) = delete;
+
+	inline uint32_t GetNumActions() const                   { return (uint32_t)m_Actions.size(); }
+	inline bool IsEmpty() const                             { return m_Actions.empty(); }
+	inline const CAction &GetAction(uint32_t i) const       { return m_Actions[i]; }
+	inline BYTEVIEW GetPayload(const CAction &Action) const { return BYTEVIEW(m_Data.data() + Action.Offset, Action.Length); }
+
+	// the number of bytes the action takes up in an action packet (the PID, the length and the payload)
+
+	inline static uint32_t GetEncodedLength(const CAction &Action)    { return Action.Length + 3; }
+
+	void Push(uint8_t PID, const BYTEVIEW &Payload, uint64_t Received);
+
+	inline void Clear()                                     { m_Data.clear(); m_Actions.clear(); }
+};
+
+#endif  // AURA_ACTIONQUEUE_H_
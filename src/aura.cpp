@@ -20,14 +20,25 @@ CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
 
 #include "aura.h"
 #include "config.h"
+#include "shard.h"
 #include "socket.h"
 #include "map.h"
+#include "mapcache.h"
 #include "game.h"
+#include "bandwidth.h"
+#include "eventlog.h"
+#include "profiler.h"
+#include "statsserver.h"
+#include "crc32.h"
+#include "sha1.h"
+#include "logging.h"
 
+#include <algorithm>
 #include <csignal>
 #include <cstdlib>
 #include <ctime>
 #include <iostream>
+#include <thread>
 
 #ifdef WIN32
 #include <ws2tcpip.h>
@@ -41,12 +52,6 @@ CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
 #include <mach/mach_time.h>
 #endif
 
-#ifdef WIN32
-#define MILLISLEEP( x ) Sleep( x )
-#else
-#define MILLISLEEP( x ) usleep( ( x ) * 1000 )
-#endif
-
 static CAura *gAura = nullptr;
 
 uint32_t GetTicks()
@@ -72,32 +77,34 @@ uint32_t GetTicks()
 
 	return elapsednano / 1000000;
 #else
-	static struct timespec t;
+	struct timespec t;
 	clock_gettime(CLOCK_MONOTONIC, &t);
 	return t.tv_sec * 1000 + t.tv_nsec / 1000000;
 #endif
 }
 
-#include "logging.h"
-void Print(const std::string &message)
-{
-	std::cout << message << std::endl;
-	logging::logger() << message;
-}
+// the signal handlers only set a flag and wake the main thread, CAura::Update does the rest
+// logging (which allocates and locks) or exit (which runs the atexit hooks) isn't safe here since the signal can interrupt either of them
+// a second SIGINT, or one before CAura exists, ends the process right away without flushing the log
 
 static void SignalCatcher(int32_t)
 {
-	Print("[!!!] caught signal SIGINT, exiting NOW");
+	if (gAura && !gAura->m_Exiting)
+	{
+		gAura->m_Exiting = true;
+		gAura->m_Shards[0]->Wake();
+	}
+	else
+		_exit(1);
+}
 
+static void ProfileSignalCatcher(int32_t)
+{
 	if (gAura)
 	{
-		if (gAura->m_Exiting)
-			exit(1);
-		else
-			gAura->m_Exiting = true;
+		gAura->m_DumpProfile = true;
+		gAura->m_Shards[0]->Wake();
 	}
-	else
-		exit(1);
 }
 
 //
@@ -106,6 +113,10 @@ static void SignalCatcher(int32_t)
 
 int main(int, char *argv[])
 {
+	// start the log writer first so everything gets logged
+
+	logging::start();
+
 	// seed the PRNG
 
 	srand((uint32_t)time(nullptr));
@@ -118,10 +129,28 @@ int main(int, char *argv[])
 
 	CConfig CFG("ydhost.cfg");
 
-	Print("[AURA] starting up");
+	// log levels, bot_loglevel applies to every tag that doesn't have its own bot_loglevel_<tag>
+
+	logging::level DefaultLevel = logging::LEVEL_INFO;
+	logging::parse_level(CFG.GetString("bot_loglevel", "info"), DefaultLevel);
+
+	for (int i = 0; i < logging::TAG_COUNT; ++i)
+	{
+		logging::level Level = DefaultLevel;
+		logging::parse_level(CFG.GetString("bot_loglevel_" + std::string(logging::tag_name((logging::tag)i)), std::string()), Level);
+		logging::set_level((logging::tag)i, Level);
+	}
+
+	LOG_INFO(AURA, "[AURA] starting up");
 
 	signal(SIGINT, SignalCatcher);
 
+#ifdef SIGUSR1
+	signal(SIGUSR1, ProfileSignalCatcher);
+#else
+	signal(SIGBREAK, ProfileSignalCatcher);
+#endif
+
 #ifndef WIN32
 	// disable SIGPIPE since some systems like OS X don't define MSG_NOSIGNAL
 
@@ -142,45 +171,47 @@ int main(int, char *argv[])
 			break;
 		}
 		else if (i < 5)
-			Print("[AURA] error setting Windows timer resolution to " + std::to_string(i) + " milliseconds, trying a higher resolution");
+			LOG_ERROR(AURA, "[AURA] error setting Windows timer resolution to {} milliseconds, trying a higher resolution", i);
 		else
 		{
-			Print("[AURA] error setting Windows timer resolution");
+			LOG_ERROR(AURA, "[AURA] error setting Windows timer resolution");
 			return 1;
 		}
 	}
 
-	Print("[AURA] using Windows timer with resolution " + std::to_string(TimerResolution) + " milliseconds");
+	LOG_INFO(AURA, "[AURA] using Windows timer with resolution {} milliseconds", TimerResolution);
 #elif !defined(__APPLE__)
 	// print the timer resolution
 
 	struct timespec Resolution;
 
 	if (clock_getres(CLOCK_MONOTONIC, &Resolution) == -1)
-		Print("[AURA] error getting monotonic timer resolution");
+		LOG_ERROR(AURA, "[AURA] error getting monotonic timer resolution");
 	else
-		Print("[AURA] using monotonic timer with resolution " + to_string((double)(Resolution.tv_nsec / 1000)) + " microseconds");
+		LOG_INFO(AURA, "[AURA] using monotonic timer with resolution {} microseconds", (double)(Resolution.tv_nsec / 1000));
 
 #endif
 
 #ifdef WIN32
 	// initialize winsock
 
-	Print("[AURA] starting winsock");
+	LOG_INFO(AURA, "[AURA] starting winsock");
 	WSADATA wsadata;
 
 	if (WSAStartup(MAKEWORD(2, 2), &wsadata) != 0)
 	{
-		Print("[AURA] error starting winsock");
+		LOG_ERROR(AURA, "[AURA] error starting winsock");
 		return 1;
 	}
 
 	// increase process priority
 
-	Print("[AURA] setting process priority to \"high\"");
+	LOG_INFO(AURA, "[AURA] setting process priority to \"high\"");
 	SetPriorityClass(GetCurrentProcess(), HIGH_PRIORITY_CLASS);
 #endif
 
+	LOG_INFO(AURA, "[AURA] using the {} CRC32 kernel and the {} SHA-1 kernel", hash::crc32_kernel(), hash::sha1_kernel());
+
 	// initialize aura
 
 	gAura = new CAura(&CFG);
@@ -191,13 +222,13 @@ int main(int, char *argv[])
 
 	// shutdown aura
 
-	Print("[AURA] shutting down");
+	LOG_INFO(AURA, "[AURA] shutting down");
 	delete gAura;
 
 #ifdef WIN32
 	// shutdown winsock
 
-	Print("[AURA] shutting down winsock");
+	LOG_INFO(AURA, "[AURA] shutting down winsock");
 	WSACleanup();
 
 	// shutdown timer
@@ -205,6 +236,8 @@ int main(int, char *argv[])
 	timeEndPeriod(TimerResolution);
 #endif
 
+	logging::stop();
+
 	return 0;
 }
 
@@ -213,20 +246,51 @@ int main(int, char *argv[])
 //
 
 CAura::CAura(CConfig *CFG)
-	: m_UDPSocket(new CUDPSocket()),
-	m_Map(nullptr),
+	: m_Map(nullptr),
+	m_Bandwidth(nullptr),
+	m_EventLog(nullptr),
+	m_Profiler(nullptr),
+	m_Stats(nullptr),
 	m_HostCounter(1),
-	m_Exiting(false)
+	m_Exiting(false),
+	m_DumpProfile(false)
 {
-	Print("[AURA] Aura++ version 1.24");
-
-	m_UDPSocket->SetBroadcastTarget(std::string());
-	m_UDPSocket->SetDontRoute(false);
+	LOG_INFO(AURA, "[AURA] Aura++ version 1.24");
 
 	std::string MapPath = CFG->GetString("bot_mappath", std::string());
 	std::string MapCFGPath = CFG->GetString("bot_mapcfgpath", std::string());
-	CConfig MAP(MapCFGPath);
-	m_Map = new CMap(MapPath, &MAP);
+
+	// bot_mappath is the path Warcraft III uses, the map file itself is loaded from bot_maplocalpath
+	// when that's not set the map is expected at the same relative path on this machine
+
+	std::string MapLocalPath = CFG->GetString("bot_maplocalpath", std::string());
+
+	if (MapLocalPath.empty())
+	{
+		MapLocalPath = MapPath;
+#ifndef WIN32
+		std::replace(MapLocalPath.begin(), MapLocalPath.end(), '\\', '/');
+#endif
+	}
+
+	// without bot_mapcfgpath the map info is calculated from the map file at startup
+	// common.j and blizzard.j are read from bot_jasspath for maps which don't have their own
+	// the results are kept in bot_mapcachepath (by default next to the map) so unchanged maps aren't hashed again on the next start
+
+	const std::string JassPath = CFG->GetString("bot_jasspath", "jass");
+
+	if (MapCFGPath.empty())
+	{
+		const std::string::size_type Slash = MapLocalPath.find_last_of("/\\");
+		const std::string MapDirectory = Slash == std::string::npos ? std::string() : MapLocalPath.substr(0, Slash + 1);
+		CMapCache Cache(CFG->GetString("bot_mapcachepath", MapDirectory + "mapcache.txt"));
+		m_Map = new CMap(MapPath, MapLocalPath, JassPath, nullptr, &Cache);
+	}
+	else
+	{
+		CConfig MAP(MapCFGPath);
+		m_Map = new CMap(MapPath, MapLocalPath, JassPath, &MAP, nullptr);
+	}
 
 	std::string GameName = CFG->GetString("bot_defaultgamename", "");
 	std::string VirtualHostName = CFG->GetString("bot_virtualhostname", "|cFF4080C0YDWE");
@@ -240,91 +304,184 @@ CAura::CAura(CConfig *CFG)
 		VirtualHostName = VirtualHostName.substr(0, 15);
 	}
 
+	// how much we read from a socket at once, a bigger budget lets a burst through in one go but a flooding client can hog the loop for longer
+
+	CTCPSocket::SetRecvLimits(CFG->GetInt("bot_recvchunksize", 16384), CFG->GetInt("bot_recvbudget", 65536));
+
+	// each shard is an independent event loop, the first one runs on the main thread and the others get a thread each
+	// bot_threads = 0 means one shard per core
+
+	int32_t NumThreads = CFG->GetInt("bot_threads", 1);
+
+	if (NumThreads <= 0)
+		NumThreads = std::max(1u, std::thread::hardware_concurrency());
+
+	// map downloads share bot_maxdownloadspeed KB/s between every downloading player of every game, 0 = unlimited
+	// in game traffic isn't counted so a lobby full of downloaders can't slow down the games in progress
+
+	m_Bandwidth = new CBandwidthManager(std::max(0, CFG->GetInt("bot_maxdownloadspeed", 0)) * 1024);
+
+	// joins, leaves, lag, desyncs, downloads and action batches are also recorded as binary events in bot_eventlogpath for offline analysis
+	// tools/eventlog converts the files to CSV or JSON
+
+	const std::string EventLogPath = CFG->GetString("bot_eventlogpath", std::string());
+
+	if (!EventLogPath.empty())
+		m_EventLog = new CEventLog(EventLogPath);
+
+	// the event loops time their phases, SIGUSR1 (SIGBREAK on Windows) logs a summary and writes the last bot_profiletrace seconds as a Chrome trace to bot_profilepath
+
+	if (CFG->GetInt("bot_profile", 1) != 0)
+		m_Profiler = new CProfiler(CFG->GetString("bot_profilepath", "log"), std::max(1, CFG->GetInt("bot_profiletrace", 10)));
+
+	// the action batch intervals and queueing delays of the running games (to tune bot_latency) are served as JSON on bot_statsport
+	// they're also logged when a game ends
+
+	const int32_t StatsPort = CFG->GetInt("bot_statsport", 0);
+
+	if (StatsPort > 0 && StatsPort < 65536)
+		m_Stats = new CStatsServer();
+
+	for (int32_t i = 0; i < NumThreads; ++i)
+		m_Shards.push_back(new CShard(i, m_Bandwidth, m_EventLog, m_Profiler, m_Stats));
+
+	// the first shard runs on the main thread so the stats connections are handled there
+
+	if (m_Stats)
+		m_Stats->Listen(m_Shards[0]->GetPoller(), CFG->GetString("bot_statsaddress", "127.0.0.1"), (uint16_t)StatsPort);
+
+	// the event log starts a new file every day, the timer runs on the main thread along with the first shard
+
+	if (m_EventLog)
+	{
+		m_EventLogTimer.Init(m_Shards[0]->GetTimers(), [this](uint32_t Ticks) {
+			m_EventLog->Update();
+			m_EventLogTimer.Schedule(Ticks + m_EventLog->GetTimeUntilRotation());
+		});
+
+		m_EventLogTimer.Schedule(GetTicks() + m_EventLog->GetTimeUntilRotation());
+	}
+
 	if (!m_Map->GetValid())
 	{
 		return;
 	}
 
-	Print("[AURA] creating game [" + GameName + "]");
+	// the main thread sleeps in the first shard's poller so the others wake it when a game ends, once they're all gone we exit
 
-	CGameConfig* config = new CGameConfig;
-	config->GameName = GameName;
-	config->VirtualHostName = VirtualHostName;
-	config->War3Version = CFG->GetInt("lan_war3version", 26);
-	config->Latency = CFG->GetInt("bot_latency", 100);
-	config->AutoStart = CFG->GetInt("bot_autostart", 1);
-	m_Games.push_back(new CGame(m_Map, config, m_UDPSocket, m_HostCounter++));
+	for (uint32_t i = 1; i < m_Shards.size(); ++i)
+	{
+		m_Shards[i]->SetOnGameDeleted([this]() { m_Shards[0]->Wake(); });
+		m_Shards[i]->Start();
+	}
+
+	// host bot_games lobbies at once, numbered when there's more than one
+
+	const int32_t NumGames = std::max(1, CFG->GetInt("bot_games", 1));
+
+	for (int32_t i = 1; i <= NumGames; ++i)
+	{
+		CGameConfig* config = new CGameConfig;
+		config->GameName = GameName;
+		config->VirtualHostName = VirtualHostName;
+		config->War3Version = CFG->GetInt("lan_war3version", 26);
+		config->Latency = CFG->GetInt("bot_latency", 100);
+		config->AutoStart = CFG->GetInt("bot_autostart", 1);
+		config->MaxDownloadSpeed = std::max(0, CFG->GetInt("bot_maxgamedownloadspeed", 0)) * 1024;
+
+		if (NumGames > 1)
+		{
+			const std::string Suffix = " #" + std::to_string(i);
+			config->GameName = GameName.substr(0, 31 - Suffix.size()) + Suffix;
+		}
+
+		CreateGame(config);
+	}
 }
 
 CAura::~CAura()
 {
-	delete m_UDPSocket;
+	// stop every shard before deleting anything they might still be using
+
+	for (auto & shard : m_Shards)
+		shard->Stop();
+
+	// the stats sockets are registered with the first shard's poller so close them before it's deleted
+	// the games unregister themselves from the stats server when the shards delete them so that goes last
+
+	if (m_Stats)
+		m_Stats->Stop();
+
+	// the timer is registered with the first shard's timer wheel
+
+	m_EventLogTimer.Cancel();
+
+	for (auto & shard : m_Shards)
+		delete shard;
+
+	for (auto & config : m_GameConfigs)
+		delete config;
+
+	delete m_Bandwidth;
+	delete m_EventLog;
+	delete m_Profiler;
+	delete m_Stats;
 
 	if (m_Map)
 		delete m_Map;
-
-	for (auto & game : m_Games)
-		delete game;
 }
 
-bool CAura::Update()
+void CAura::CreateGame(CGameConfig *Config)
 {
-	uint32_t NumFDs = 0;
+	// place the game on the least loaded shard
 
-	// take every socket we own and throw it in one giant select statement so we can block on all sockets
+	CShard *Shard = m_Shards[0];
 
-	int32_t nfds = 0;
-	fd_set fd, send_fd;
-	FD_ZERO(&fd);
-	FD_ZERO(&send_fd);
+	for (auto & shard : m_Shards)
+	{
+		if (shard->GetNumGames() < Shard->GetNumGames())
+			Shard = shard;
+	}
 
-	// 2. all running games' player sockets
+	LOG_INFO(AURA, "[AURA] creating game [{}] on shard {}", Config->GameName, Shard->GetID());
+	m_GameConfigs.push_back(Config);
+	Shard->AddGame(m_Map, Config, m_HostCounter++);
+}
 
-	for (auto & game : m_Games)
-		NumFDs += game->SetFD(&fd, &send_fd, &nfds);
+uint32_t CAura::GetNumGames() const
+{
+	uint32_t NumGames = 0;
 
-	// before we call select we need to determine how long to block for
-	// 50 ms is the hard maximum
-	static struct timeval tv;
-	tv.tv_sec = 0;
-	tv.tv_usec = 50000;
+	for (const auto & shard : m_Shards)
+		NumGames += shard->GetNumGames();
 
-	static struct timeval send_tv;
-	send_tv.tv_sec = 0;
-	send_tv.tv_usec = 0;
+	return NumGames;
+}
 
-#ifdef WIN32
-	select(1, &fd, nullptr, nullptr, &tv);
-	select(1, nullptr, &send_fd, nullptr, &send_tv);
-#else
-	select(nfds + 1, &fd, nullptr, nullptr, &tv);
-	select(nfds + 1, nullptr, &send_fd, nullptr, &send_tv);
-#endif
+bool CAura::Update()
+{
+	// the first shard runs on the main thread, this blocks until one of its sockets or timers is ready or something wakes it (see Wake)
 
-	if (NumFDs == 0)
+	m_Shards[0]->Update();
+
+	if (m_Stats)
+		m_Stats->Update();
+
+	if (m_DumpProfile)
 	{
-		// we don't have any sockets (i.e. we aren't connected to battle.net and irc maybe due to a lost connection and there aren't any games running)
-		// select will return immediately and we'll chew up the CPU if we let it loop so just sleep for 200ms to kill some time
+		m_DumpProfile = false;
 
-		MILLISLEEP(200);
+		if (m_Profiler)
+			m_Profiler->Dump();
+		else
+			LOG_INFO(PROFILE, "[PROFILE] the profiler is off (bot_profile = 0)");
 	}
 
-	// update running games
-
-	for (auto i = begin(m_Games); i != end(m_Games);)
+	if (m_Exiting)
 	{
-		if ((*i)->Update(&fd, &send_fd))
-		{
-			Print("[AURA] deleting game [" + (*i)->GetGameName() + "]");
-			delete *i;
-			i = m_Games.erase(i);
-		}
-		else
-		{
-			(*i)->UpdatePost(&send_fd);
-			++i;
-		}
+		LOG_WARNING(AURA, "[!!!] caught signal SIGINT, exiting NOW");
+		return true;
 	}
 
-	return m_Exiting || m_Games.size() == 0;
+	return GetNumGames() == 0;
 }
@@ -21,6 +21,9 @@ CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
 #ifndef AURA_AURA_H_
 #define AURA_AURA_H_
 
+#include "timerwheel.h"
+
+#include <csignal>
 #include <vector>
 #include <stdint.h>
 
@@ -28,27 +31,38 @@ CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
 // CAura
 //
 
-class CUDPSocket;
-class CTCPSocket;
-class CTCPServer;
 class CGPSProtocol;
-class CGame;
+class CShard;
+class CBandwidthManager;
+class CEventLog;
+class CProfiler;
+class CStatsServer;
 class CMap;
 class CConfig;
+struct CGameConfig;
 
 class CAura
 {
 public:
-	CUDPSocket *m_UDPSocket;                      // a UDP socket for sending broadcasts and other junk (used with !sendlan)
-	std::vector<CGame *> m_Games;                 // these games are in progress
-	CMap *m_Map;                                  // the currently loaded map
+	std::vector<CShard *> m_Shards;               // the event loops the games run on, the first one runs on the main thread
+	std::vector<CGameConfig *> m_GameConfigs;     // the configs of every game we created
+	CMap *m_Map;                                  // the currently loaded map (shared read only by every shard)
+	CBandwidthManager *m_Bandwidth;               // the map upload budget shared by every game on every shard
+	CEventLog *m_EventLog;                        // the binary event log shared by every game on every shard, null if bot_eventlogpath isn't set
+	CProfiler *m_Profiler;                        // times the phases of every shard's event loop, null if bot_profile = 0
+	CStatsServer *m_Stats;                        // serves every game's relay stats on bot_statsport, null if that isn't set
+	CTimer m_EventLogTimer;                       // rotates the event log at midnight (on the first shard's timer wheel)
 	uint32_t m_HostCounter;                       // the current host counter (a unique number to identify a game, incremented each time a game is created)
-	bool m_Exiting;                               // set to true to force aura to shutdown next update (used by SignalCatcher)
+	volatile sig_atomic_t m_Exiting;              // set to true to force aura to shutdown next update (used by SignalCatcher)
+	volatile sig_atomic_t m_DumpProfile;          // set to true to dump the profiler next update (used by ProfileSignalCatcher)
 
 	explicit CAura(CConfig *CFG);
 	~CAura();
 	CAura(CAura &) = delete;
 	bool Update();
+
+	void CreateGame(CGameConfig *Config);
+	uint32_t GetNumGames() const;
 };
 
 #endif  // AURA_AURA_H_
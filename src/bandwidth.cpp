@@ -0,0 +1,95 @@
+#include "bandwidth.h"
+
+#include <algorithm>
+
+//
+// CTokenBucket
+//
+
+CTokenBucket::CTokenBucket(uint32_t nRate)
+	: m_Rate(0),
+	m_Burst(0),
+	m_Tokens(0),
+	m_LastTicks(0)
+{
+	SetRate(nRate);
+	m_Tokens = m_Burst;
+}
+
+void CTokenBucket::SetRate(uint32_t Rate)
+{
+	m_Rate = Rate;
+	m_Burst = std::max<uint32_t>(Rate / 10, 4 * 1460);
+	m_Tokens = std::min(m_Tokens, m_Burst);
+}
+
+void CTokenBucket::Refill(uint32_t Ticks)
+{
+	// only move m_LastTicks forward when at least one token was added so slow rates don't lose the fractions
+
+	const uint64_t Tokens = (uint64_t)(Ticks - m_LastTicks) * m_Rate / 1000;
+
+	if (Tokens > 0 || m_Tokens >= m_Burst)
+	{
+		m_Tokens = (uint32_t)std::min<uint64_t>(m_Burst, m_Tokens + Tokens);
+		m_LastTicks = Ticks;
+	}
+}
+
+bool CTokenBucket::IsHalfFull(uint32_t Ticks)
+{
+	if (IsUnlimited())
+		return true;
+
+	Refill(Ticks);
+	return m_Tokens >= m_Burst / 2;
+}
+
+bool CTokenBucket::HasTokens(uint32_t Ticks, uint32_t Bytes)
+{
+	if (IsUnlimited())
+		return true;
+
+	Refill(Ticks);
+	return m_Tokens >= Bytes;
+}
+
+void CTokenBucket::Take(uint32_t Bytes)
+{
+	m_Tokens -= std::min(Bytes, m_Tokens);
+}
+
+//
+// CBandwidthManager
+//
+
+CBandwidthManager::CBandwidthManager(uint32_t nRate)
+	: m_Bucket(nRate),
+	m_NumDownloaders(0)
+{
+
+}
+
+CBandwidthManager::~CBandwidthManager()
+{
+
+}
+
+uint32_t CBandwidthManager::GetFairShare() const
+{
+	return m_Bucket.GetRate() / std::max<uint32_t>(1, m_NumDownloaders);
+}
+
+bool CBandwidthManager::Take(uint32_t Ticks, uint32_t Bytes, bool Borrow)
+{
+	if (IsUnlimited())
+		return true;
+
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+
+	if (!m_Bucket.HasTokens(Ticks, Bytes) || (Borrow && !m_Bucket.IsHalfFull(Ticks)))
+		return false;
+
+	m_Bucket.Take(Bytes);
+	return true;
+}
@@ -0,0 +1,78 @@
+#ifndef AURA_BANDWIDTH_H_
+#define AURA_BANDWIDTH_H_
+
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+
+//
+// CTokenBucket
+//
+// a rate limiter, tokens (bytes) accumulate at m_Rate bytes per second up to m_Burst and sending data takes them out
+// a rate of 0 means unlimited
+//
+
+class CTokenBucket
+{
+private:
+	uint32_t m_Rate;                              // bytes per second
+	uint32_t m_Burst;                             // the most tokens that can accumulate (100 ms worth of data but at least a few map parts)
+	uint32_t m_Tokens;
+	uint32_t m_LastTicks;                         // GetTicks when tokens were last added
+
+	void Refill(uint32_t Ticks);
+
+public:
+	explicit CTokenBucket(uint32_t nRate = 0);
+
+	inline uint32_t GetRate() const                         { return m_Rate; }
+	inline bool IsUnlimited() const                         { return m_Rate == 0; }
+
+	void SetRate(uint32_t Rate);
+
+	// at least half of the burst is unused, i.e. whoever shares this bucket isn't using all of it
+
+	bool IsHalfFull(uint32_t Ticks);
+
+	bool HasTokens(uint32_t Ticks, uint32_t Bytes);
+
+	// call HasTokens first, this doesn't check if there are enough tokens
+
+	void Take(uint32_t Bytes);
+};
+
+//
+// CBandwidthManager
+//
+// the map upload budget shared by every game on every shard (bot_maxdownloadspeed)
+// it also counts the players downloading the map from any game so each of them can be given a fair share of the budget
+// in game traffic (actions, chat, ...) is never limited, the budget only keeps map downloads from taking all of the upload capacity
+//
+
+class CBandwidthManager
+{
+private:
+	std::mutex m_Mutex;
+	CTokenBucket m_Bucket;                        // the rate never changes so checking for unlimited doesn't need the mutex
+	std::atomic<uint32_t> m_NumDownloaders;
+
+public:
+	explicit CBandwidthManager(uint32_t nRate);
+	~CBandwidthManager();
+	CBandwidthManager(CBandwidthManager &) = delete;
+
+	inline bool IsUnlimited() const                         { return m_Bucket.IsUnlimited(); }
+	inline void AddDownloader()                             { ++m_NumDownloaders; }
+	inline void RemoveDownloader()                          { --m_NumDownloaders; }
+
+	// the rate each downloading player gets if they all download as fast as they can, 0 = unlimited
+
+	uint32_t GetFairShare() const;
+
+	// take Bytes from the budget if there's enough left
+	// when Borrow is true the caller is over its fair share so it's only allowed to use what the other downloaders leave unused
+
+	bool Take(uint32_t Ticks, uint32_t Bytes, bool Borrow);
+};
+
+#endif  // AURA_BANDWIDTH_H_
@@ -19,21 +19,20 @@ CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
 */
 
 #include "config.h"
+#include "logging.h"
 
 #include <fstream>
 #include <algorithm>
 #include <string>
 
-void Print(const std::string &message);
-
 CConfig::CConfig(const std::string& filename)
 {
 	std::ifstream in(filename.c_str());
 	if (!in) {
-		Print("[CONFIG] warning - unable to read file [" + filename + "]");
+		LOG_WARNING(CONFIG, "[CONFIG] warning - unable to read file [{}]", filename);
 		return;
 	}
-	Print("[CONFIG] loading file [" + filename + "]");
+	LOG_INFO(CONFIG, "[CONFIG] loading file [{}]", filename);
 	std::string Line;
 	while (!in.eof())
 	{
@@ -22,6 +22,7 @@ CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
 #define AURA_CONFIG_H_
 
 #include <map>
+#include <string>
 #include <stdint.h>
 
 //
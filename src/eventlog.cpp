@@ -0,0 +1,312 @@
+#include "eventlog.h"
+#include "logging.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <cstring>
+
+#ifdef WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	uint64_t GetTime()
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+
+	struct tm GetLocalTime(time_t Time)
+	{
+		struct tm Local;
+#ifdef WIN32
+		localtime_s(&Local, &Time);
+#else
+		localtime_r(&Time, &Local);
+#endif
+		return Local;
+	}
+
+#ifndef WIN32
+	// allocate the blocks under the segment at Offset so stores through its mapping can always be backed
+	bool ReserveSegment(int File, uint64_t Offset)
+	{
+#ifdef __APPLE__
+		// there's no posix_fallocate, writing the zeros makes the file system allocate the blocks just the same
+
+		static const uint8_t Zeros[64 * 1024] = { 0 };
+
+		for (uint64_t Written = 0; Written < CEventLog::SEGMENT_SIZE; Written += sizeof(Zeros))
+		{
+			if (pwrite(File, Zeros, sizeof(Zeros), (off_t)(Offset + Written)) != (ssize_t)sizeof(Zeros))
+				return false;
+		}
+
+		return true;
+#else
+		// grows the file when the segment is past the end, never shrinks it
+
+		return posix_fallocate(File, (off_t)Offset, CEventLog::SEGMENT_SIZE) == 0;
+#endif
+	}
+#endif
+}
+
+//
+// CEventLog
+//
+
+CEventLog::CEventLog(const std::string &nDirectory)
+	: m_Directory(nDirectory),
+	m_File(nullptr),
+	m_Retired(nullptr),
+	m_Day(GetLocalTime(time(nullptr)).tm_yday),
+	m_Dropped(0)
+{
+	if (!m_Directory.empty() && m_Directory.back() != '/' && m_Directory.back() != '\\')
+		m_Directory += '/';
+
+	m_File = OpenFile();
+}
+
+CEventLog::~CEventLog()
+{
+	CloseFile(m_File);
+	CloseFile(m_Retired);
+
+	if (m_Dropped > 0)
+		LOG_WARNING(AURA, "[EVENTLOG] dropped {} events, the event log file was full", (uint64_t)m_Dropped);
+}
+
+CEventLog::CFile *CEventLog::OpenFile()
+{
+	const uint64_t Created = GetTime();
+	const struct tm Local = GetLocalTime((time_t)(Created / 1000000));
+	char Name[96];
+#ifdef WIN32
+	const int ProcessID = _getpid();
+#else
+	const int ProcessID = getpid();
+#endif
+	sprintf(Name, "events-%04d-%02d-%02d-%02d%02d%02d-%d.ydev", Local.tm_year + 1900, Local.tm_mon + 1, Local.tm_mday, Local.tm_hour, Local.tm_min, Local.tm_sec, ProcessID);
+
+	CFile *File = new CFile;
+	File->FileName = m_Directory + Name;
+	File->Size = 0;
+	File->NextRecord = 0;
+
+	for (auto & segment : File->Segments)
+		segment = nullptr;
+
+#ifdef WIN32
+	File->File = CreateFileA(File->FileName.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (File->File == INVALID_HANDLE_VALUE)
+#else
+	File->File = open(File->FileName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+
+	if (File->File == -1)
+#endif
+	{
+		LOG_ERROR(AURA, "[EVENTLOG] unable to create [{}], events won't be recorded", File->FileName);
+		delete File;
+		return nullptr;
+	}
+
+	// the header takes the place of the first record
+
+	uint8_t *Data = MapSegment(File, 0);
+
+	if (!Data)
+	{
+		CloseFile(File);
+		return nullptr;
+	}
+
+	CEventLogHeader Header;
+	memset(&Header, 0, sizeof(Header));
+	Header.Magic = EVENTLOG_MAGIC;
+	Header.Version = EVENTLOG_VERSION;
+	Header.HeaderSize = sizeof(CEventLogHeader);
+	Header.RecordSize = sizeof(CEventRecord);
+	Header.Created = Created;
+	memcpy(Data, &Header, sizeof(Header));
+
+	LOG_INFO(AURA, "[EVENTLOG] recording events to [{}]", File->FileName);
+	return File;
+}
+
+void CEventLog::CloseFile(CFile *File)
+{
+	if (!File)
+		return;
+
+	// cut off the unused end of the last segment
+
+	const uint64_t Capacity = (uint64_t)MAX_SEGMENTS * SEGMENT_SIZE / sizeof(CEventRecord) - 1;
+	const uint64_t NumRecords = std::min<uint64_t>(File->NextRecord, Capacity);
+	uint64_t Size = sizeof(CEventLogHeader) + NumRecords * sizeof(CEventRecord);
+
+	bool Gap = false;
+
+	for (uint32_t i = 0; i < MAX_SEGMENTS; ++i)
+	{
+		uint8_t *Data = File->Segments[i];
+
+		if (!Data)
+		{
+			// a segment that couldn't be mapped, nothing after it was written either
+
+			if (!Gap)
+				Size = std::min<uint64_t>(Size, (uint64_t)i * SEGMENT_SIZE);
+
+			Gap = true;
+			continue;
+		}
+
+#ifdef WIN32
+		UnmapViewOfFile(Data);
+#else
+		munmap(Data, SEGMENT_SIZE);
+#endif
+	}
+
+#ifdef WIN32
+	LARGE_INTEGER Offset;
+	Offset.QuadPart = (LONGLONG)Size;
+
+	if (SetFilePointerEx(File->File, Offset, nullptr, FILE_BEGIN))
+		SetEndOfFile(File->File);
+
+	CloseHandle(File->File);
+#else
+	if (ftruncate(File->File, (off_t)Size) == -1)
+		LOG_WARNING(AURA, "[EVENTLOG] unable to truncate [{}]", File->FileName);
+
+	close(File->File);
+#endif
+
+	delete File;
+}
+
+uint8_t *CEventLog::MapSegment(CFile *File, uint32_t Segment)
+{
+	std::lock_guard<std::mutex> Lock(File->Mutex);
+
+	// another thread might have mapped it while we were waiting for the lock
+
+	uint8_t *Data = File->Segments[Segment];
+
+	if (Data)
+		return Data;
+
+	// segments can be mapped out of order, the file must never shrink under a segment that's already mapped
+
+	const uint64_t Offset = (uint64_t)Segment * SEGMENT_SIZE;
+	const uint64_t Size = std::max<uint64_t>(File->Size, Offset + SEGMENT_SIZE);
+
+#ifdef WIN32
+	// the mapping object grows the file to its size, the view keeps it alive after the handle is closed
+
+	void *Mapping = CreateFileMappingA(File->File, nullptr, PAGE_READWRITE, (DWORD)(Size >> 32), (DWORD)Size, nullptr);
+
+	if (Mapping)
+	{
+		Data = (uint8_t *)MapViewOfFile(Mapping, FILE_MAP_WRITE, (DWORD)(Offset >> 32), (DWORD)Offset, SEGMENT_SIZE);
+		CloseHandle(Mapping);
+	}
+#else
+	// the segment's blocks are allocated before it's mapped, a store to a page of a sparse file that can't be backed on a full disk raises SIGBUS
+	// this way a full disk only fails the mapping and the records are counted as dropped
+
+	if (ReserveSegment(File->File, Offset))
+	{
+		void *Mapped = mmap(nullptr, SEGMENT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, File->File, (off_t)Offset);
+
+		if (Mapped != MAP_FAILED)
+			Data = (uint8_t *)Mapped;
+	}
+#endif
+
+	if (!Data)
+		return nullptr;
+
+	File->Size = Size;
+	File->Segments[Segment] = Data;
+	return Data;
+}
+
+void CEventLog::Update()
+{
+	const int32_t Day = GetLocalTime(time(nullptr)).tm_yday;
+
+	if (Day == m_Day)
+		return;
+
+	m_Day = Day;
+
+	CFile *File = OpenFile();
+
+	if (!File)
+		return;
+
+	// writers which loaded the old file just before the switch finish with it long before the next rotation closes it
+
+	CloseFile(m_Retired);
+	m_Retired = m_File.exchange(File);
+}
+
+uint32_t CEventLog::GetTimeUntilRotation() const
+{
+	// mktime normalizes the day after today and accounts for daylight saving time changes in between
+
+	const time_t Now = time(nullptr);
+	struct tm Midnight = GetLocalTime(Now);
+	++Midnight.tm_mday;
+	Midnight.tm_hour = 0;
+	Midnight.tm_min = 0;
+	Midnight.tm_sec = 0;
+	Midnight.tm_isdst = -1;
+
+	// a second late so the day has changed for sure when Update runs
+
+	const int64_t Seconds = std::max<int64_t>(0, (int64_t)(mktime(&Midnight) - Now)) + 1;
+	return (uint32_t)std::min<int64_t>(Seconds * 1000, 86400 * 2 * 1000);
+}
+
+void CEventLog::Write(uint32_t HostCounter, uint8_t Type, uint8_t PID, uint32_t Field0, uint32_t Field1, uint32_t Field2, uint32_t Field3)
+{
+	CFile *File = m_File;
+
+	if (!File)
+		return;
+
+	const uint64_t Offset = sizeof(CEventLogHeader) + File->NextRecord++ * sizeof(CEventRecord);
+	const uint64_t Segment = Offset / SEGMENT_SIZE;
+	uint8_t *Data = Segment < MAX_SEGMENTS ? File->Segments[Segment].load() : nullptr;
+
+	if (!Data && (Segment >= MAX_SEGMENTS || !(Data = MapSegment(File, (uint32_t)Segment))))
+	{
+		++m_Dropped;
+		return;
+	}
+
+	CEventRecord Record;
+	Record.Time = GetTime();
+	Record.HostCounter = HostCounter;
+	Record.Type = Type;
+	Record.PID = PID;
+	Record.Reserved = 0;
+	Record.Fields[0] = Field0;
+	Record.Fields[1] = Field1;
+	Record.Fields[2] = Field2;
+	Record.Fields[3] = Field3;
+	memcpy(Data + Offset % SEGMENT_SIZE, &Record, sizeof(Record));
+}
@@ -0,0 +1,72 @@
+#ifndef AURA_EVENTLOG_H_
+#define AURA_EVENTLOG_H_
+
+#include "eventrecord.h"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <stdint.h>
+
+//
+// CEventLog
+//
+// the binary event log, fixed size records (see eventrecord.h) appended to a memory mapped file for offline analysis
+// a new file is started every day, named events-YYYY-MM-DD-HHMMSS-<process id>.ydev in bot_eventlogpath
+// any shard can write without blocking: a record's place in the file is reserved with an atomic increment and the record is copied straight into the mapping
+// the file is mapped a segment at a time, only mapping a new segment takes a lock
+// a segment is never unmapped while the file is in use so a record pointer stays valid, when a file reaches MAX_SEGMENTS further records are dropped
+//
+
+class CEventLog
+{
+public:
+	static const uint32_t SEGMENT_SIZE = 1 << 20;       // a multiple of the record size and of the mapping granularity (64 KB on Windows)
+	static const uint32_t MAX_SEGMENTS = 4096;          // 4 GB per file
+
+private:
+	struct CFile
+	{
+		std::string FileName;
+#ifdef WIN32
+		void *File;                                       // HANDLE of the file
+#else
+		int File;
+#endif
+		std::mutex Mutex;                                 // taken to map a new segment
+		uint64_t Size;                                    // the size the file was grown to (guarded by Mutex)
+		std::atomic<uint8_t *> Segments[MAX_SEGMENTS];
+		std::atomic<uint64_t> NextRecord;                 // the index of the next record to write
+	};
+
+	std::string m_Directory;
+	std::atomic<CFile *> m_File;                  // the file written to, null if it couldn't be created
+	CFile *m_Retired;                             // the previous day's file, shards may still be writing to it so it's closed at the next rotation
+	int32_t m_Day;                                // the day of the year m_File was created on
+	std::atomic<uint64_t> m_Dropped;              // the number of records lost because the file couldn't grow
+
+	CFile *OpenFile();
+	void CloseFile(CFile *File);
+	uint8_t *MapSegment(CFile *File, uint32_t Segment);
+
+public:
+	explicit CEventLog(const std::string &nDirectory);
+	~CEventLog();
+	CEventLog(CEventLog &) = delete;
+
+	inline uint64_t GetDropped() const                      { return m_Dropped; }
+
+	// start a new file when the day changes, only call this from the main thread
+
+	void Update();
+
+	// the milliseconds until the next day starts (and Update should be called)
+
+	uint32_t GetTimeUntilRotation() const;
+
+	// this can be called from any thread
+
+	void Write(uint32_t HostCounter, uint8_t Type, uint8_t PID, uint32_t Field0 = 0, uint32_t Field1 = 0, uint32_t Field2 = 0, uint32_t Field3 = 0);
+};
+
+#endif  // AURA_EVENTLOG_H_
@@ -0,0 +1,96 @@
+#ifndef AURA_EVENTRECORD_H_
+#define AURA_EVENTRECORD_H_
+
+#include <stdint.h>
+
+//
+// the file format of the binary event log (bot_eventlogpath), shared by ydhost and the tools/eventlog reader
+//
+// a file is a CEventLogHeader followed by CEventRecords, everything is little endian
+// the file grows a segment at a time so until it's closed it ends in zeroed records, those have a Time of 0 and are skipped
+// the shards write records concurrently so records close together in time aren't necessarily in order
+//
+
+#define EVENTLOG_MAGIC              0x56454459    // "YDEV"
+#define EVENTLOG_VERSION            1
+
+struct CEventLogHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t HeaderSize;                          // the records start at this offset
+	uint32_t RecordSize;
+	uint64_t Created;                             // microseconds since the epoch
+	uint64_t Reserved;
+};
+
+struct CEventRecord
+{
+	uint64_t Time;                                // microseconds since the epoch, 0 = unused
+	uint32_t HostCounter;                         // the game the event happened in
+	uint8_t Type;                                 // one of EVENT_
+	uint8_t PID;                                  // the player the event is about, 255 if it's about the whole game
+	uint16_t Reserved;
+	uint32_t Fields[4];                           // depends on the type, unused fields are 0
+};
+
+static_assert(sizeof(CEventLogHeader) == 32, "the event log header must be 32 bytes");
+static_assert(sizeof(CEventRecord) == 32, "an event record must be 32 bytes");
+
+// new types are only ever added at the end so old files keep their meaning
+
+enum
+{
+	EVENT_GAME_CREATED = 1,
+	EVENT_PLAYER_JOINED,
+	EVENT_PLAYER_LEFT,
+	EVENT_LAG_STARTED,
+	EVENT_LAG_STOPPED,
+	EVENT_DESYNC,
+	EVENT_DOWNLOAD_STARTED,
+	EVENT_DOWNLOAD_PROGRESS,
+	EVENT_DOWNLOAD_STOPPED,
+	EVENT_ACTION_BATCH,
+	EVENT_GAME_LOADING,
+	EVENT_GAME_LOADED,
+	EVENT_GAME_OVER,
+	EVENT_COUNT
+};
+
+//
+// CEventInfo
+//
+// the name of an event type and of its fields for the reader, a field without a name is unused
+//
+
+struct CEventInfo
+{
+	const char *Name;
+	const char *Fields[4];
+	uint8_t IPFields;                             // a bit for each field holding an IPv4 address in network byte order
+};
+
+inline const CEventInfo *GetEventInfo(uint8_t Type)
+{
+	static const CEventInfo Info[EVENT_COUNT] =
+	{
+		{ "unknown", { nullptr, nullptr, nullptr, nullptr }, 0 },
+		{ "game_created", { "port", nullptr, nullptr, nullptr }, 0 },
+		{ "player_joined", { "external_ip", "internal_ip", nullptr, nullptr }, 3 },
+		{ "player_left", { "left_code", "sync_counter", nullptr, nullptr }, 0 },
+		{ "lag_started", { "keepalives_behind", nullptr, nullptr, nullptr }, 0 },
+		{ "lag_stopped", { "duration_ms", "player_left", nullptr, nullptr }, 0 },
+		{ "desync", { "checksum", "first_checksum", "sync_counter", nullptr }, 0 },
+		{ "download_started", { "map_size", nullptr, nullptr, nullptr }, 0 },
+		{ "download_progress", { "bytes", "percent", nullptr, nullptr }, 0 },
+		{ "download_stopped", { "bytes", "map_size", nullptr, nullptr }, 0 },
+		{ "action_batch", { "actions", "bytes", "packets", "sync_counter" }, 0 },
+		{ "game_loading", { "players", nullptr, nullptr, nullptr }, 0 },
+		{ "game_loaded", { "players", "loading_ms", nullptr, nullptr }, 0 },
+		{ "game_over", { "players", "sync_counter", nullptr, nullptr }, 0 }
+	};
+
+	return Type < EVENT_COUNT ? &Info[Type] : &Info[0];
+}
+
+#endif  // AURA_EVENTRECORD_H_
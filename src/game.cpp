@@ -24,20 +24,23 @@ CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
 #include "map.h"
 #include "gameplayer.h"
 #include "gameprotocol.h"
+#include "eventlog.h"
+#include "profiler.h"
+#include "logging.h"
 
 #include <ctime>
 #include <cmath>
+#include <algorithm>
 
 uint32_t GetTicks();
-void Print(const std::string &message);
-
 //
 // CGame
 //
 
-CGame::CGame(const CMap* Map, const CGameConfig* Config, CUDPSocket* UDPSocket, uint32_t HostCounter)
+CGame::CGame(const CMap* Map, const CGameConfig* Config, CUDPSocket* UDPSocket, CPoller* Poller, CTimerWheel* Timers, CBandwidthManager* Bandwidth, CEventLog* EventLog, CThreadProfile* Profile, uint32_t HostCounter)
 	: m_UDPSocket(UDPSocket),
-	m_Socket(new CTCPServer()),
+	m_Timers(Timers),
+	m_Socket(new CTCPServer(Poller)),
 	m_Protocol(new CGameProtocol()),
 	m_Slots(Map->GetSlots()),
 	m_Map(Map),
@@ -47,16 +50,16 @@ CGame::CGame(const CMap* Map, const CGameConfig* Config, CUDPSocket* UDPSocket,
 	m_EntryKey(rand()),
 	m_SyncLimit(50),
 	m_SyncCounter(0),
-	m_PingTimer(),
-	m_DownloadTimer(),
-	m_SyncSlotInfoTimer(),
-	m_CountDownTimer(),
 	m_CountDownCounter(0),
-	m_LagScreenResetTimer(),
-	m_ActionSentTimer(),
 	m_StartedLaggingTicks(0),
 	m_LastLagScreenTicks(0),
-	m_EmptyWaitingTicks(0),
+	m_StartedLoadingTicks(0),
+	m_Bandwidth(Bandwidth),
+	m_DownloadBucket(Config->MaxDownloadSpeed),
+	m_EventLog(EventLog),
+	m_Profile(Profile),
+	m_RelayStats(Config->GameName, HostCounter, Config->Latency),
+	m_NumDownloaders(0),
 	m_HostPort(0),
 	m_VirtualHostPID(255),
 	m_Exiting(false),
@@ -65,17 +68,35 @@ CGame::CGame(const CMap* Map, const CGameConfig* Config, CUDPSocket* UDPSocket,
 	m_Desynced(false),
 	m_State(State::Waiting)
 {
+	m_ActionSentTimer.Init(m_Timers, [this](uint32_t Ticks) { EventActionTimer(Ticks); });
+	m_PingTimer.Init(m_Timers, [this](uint32_t Ticks) { EventPingTimer(Ticks); });
+	m_DownloadTimer.Init(m_Timers, [this](uint32_t Ticks) { EventDownloadTimer(Ticks); });
+	m_SyncSlotInfoTimer.Init(m_Timers, [this](uint32_t Ticks) { EventSyncSlotInfoTimer(Ticks); });
+	m_CountDownTimer.Init(m_Timers, [this](uint32_t Ticks) { EventCountDownTimer(Ticks); });
+	m_LagScreenResetTimer.Init(m_Timers, [this](uint32_t Ticks) { EventLagScreenResetTimer(Ticks); });
+	m_EmptyTimer.Init(m_Timers, [this](uint32_t Ticks) { EventEmptyTimer(Ticks); });
+
+	// the first ping (and LAN broadcast) goes out right away
+
+	m_PingTimer.Schedule(GetTicks());
+
 	if (m_Socket->Listen(std::string(), m_HostPort))
-		Print("[GAME: " + GetGameName() + "] listening on port " + std::to_string(m_HostPort));
+	{
+		LOG_INFO(GAME, "[GAME: {}] listening on port {}", GetGameName(), m_HostPort);
+		LogEvent(EVENT_GAME_CREATED, 255, m_HostPort);
+	}
 	else
 	{
-		Print("[GAME: " + GetGameName() + "] error listening on port " + std::to_string(m_HostPort));
+		LOG_ERROR(GAME, "[GAME: {}] error listening on port {}", GetGameName(), m_HostPort);
 		m_Exiting = true;
 	}
 }
 
 CGame::~CGame()
 {
+	LogEvent(EVENT_GAME_OVER, 255, (uint32_t)m_Players.size(), m_SyncCounter);
+	m_RelayStats.LogSummary();
+
 	delete m_Socket;
 	delete m_Protocol;
 
@@ -83,10 +104,10 @@ CGame::~CGame()
 		delete potential;
 
 	for (auto & player : m_Players)
+	{
+		StopDownload(player);
 		delete player;
-
-	for (auto& act : m_Actions)
-		delete act;
+	}
 }
 
 uint32_t CGame::GetNumPlayers() const
@@ -101,83 +122,18 @@ uint32_t CGame::GetNumPlayers() const
 	return NumPlayers;
 }
 
-uint32_t CGame::SetFD(void *fd, void *send_fd, int32_t *nfds)
-{
-	uint32_t NumFDs = 0;
-
-	if (m_Socket)
-	{
-		m_Socket->SetFD((fd_set *)fd, (fd_set *)send_fd, nfds);
-		++NumFDs;
-	}
-
-	for (auto & player : m_Players)
-	{
-		player->GetSocket()->SetFD((fd_set *)fd, (fd_set *)send_fd, nfds);
-		++NumFDs;
-	}
-
-	for (auto & potential : m_Potentials)
-	{
-		if (potential->GetSocket())
-		{
-			potential->GetSocket()->SetFD((fd_set *)fd, (fd_set *)send_fd, nfds);
-			++NumFDs;
-		}
-	}
-
-	return NumFDs;
-}
-
-bool CGame::Update(void *fd, void *send_fd)
+bool CGame::Update()
 {
+	CProfileScope Scope(m_Profile, PHASE_GAME_UPDATE, m_HostCounter);
 	const uint32_t Ticks = GetTicks();
 
-	// ping every 5 seconds
-	// changed this to ping during game loading as well to hopefully fix some problems with people disconnecting during loading
-	// changed this to ping during the game as well
-	if (m_PingTimer.update(Ticks, 5000))
-	{
-		// note: we must send pings to players who are downloading the map because Warcraft III disconnects from the lobby if it doesn't receive a ping every ~90 seconds
-		// so if the player takes longer than 90 seconds to download the map they would be disconnected unless we keep sending pings
-
-		SendAll(m_Protocol->SEND_W3GS_PING_FROM_HOST(Ticks));
-
-		// we also broadcast the game to the local network every 5 seconds so we hijack this timer for our nefarious purposes
-		// however we only want to broadcast if the countdown hasn't started
-		// see the !sendlan code later in this file for some more information about how this works
-
-		if (m_State == State::Waiting)
-		{
-			// construct a fixed host counter which will be used to identify players from this "realm" (i.e. LAN)
-			// the fixed host counter's 4 most significant bits will contain a 4 bit ID (0-15)
-			// the rest of the fixed host counter will contain the 28 least significant bits of the actual host counter
-			// since we're destroying 4 bits of information here the actual host counter should not be greater than 2^28 which is a reasonable assumption
-			// when a player joins a game we can obtain the ID from the received host counter
-			// note: LAN broadcasts use an ID of 0, battle.net refreshes use an ID of 1-10, the rest are unused
-
-			// we send 12 for SlotsTotal because this determines how many PID's Warcraft 3 allocates
-			// we need to make sure Warcraft 3 allocates at least SlotsTotal + 1 but at most 12 PID's
-			// this is because we need an extra PID for the virtual host player (but we always delete the virtual host player when the 12th person joins)
-			// however, we can't send 13 for SlotsTotal because this causes Warcraft 3 to crash when sharing control of units
-			// nor can we send SlotsTotal because then Warcraft 3 crashes when playing maps with less than 12 PID's (because of the virtual host player taking an extra PID)
-			// we also send 12 for SlotsOpen because Warcraft 3 assumes there's always at least one player in the game (the host)
-			// so if we try to send accurate numbers it'll always be off by one and results in Warcraft 3 assuming the game is full when it still needs one more player
-			// the easiest solution is to simply send 12 for both so the game will always show up as (1/12) players
-
-			// note: the PrivateGame flag is not set when broadcasting to LAN (as you might expect)
-			// note: we do not use m_Map->GetMapGameType because none of the filters are set when broadcasting to LAN (also as you might expect)
-
-			m_UDPSocket->Broadcast(6112, m_Protocol->SEND_W3GS_GAMEINFO(m_Config->War3Version, 1, m_Map->GetMapGameFlags(), m_Map->GetMapWidth(), m_Map->GetMapHeight(), GetGameName(), "Clan 007", 0, m_Map->GetMapPath(), m_Map->GetMapCRC(), 12, 12, m_HostPort, m_HostCounter & 0x0FFFFFFF, m_EntryKey));
-		}
-	}
-
 	// update players
 	for (auto i = begin(m_Players); i != end(m_Players);)
 	{
-		if ((*i)->Update(Ticks, fd))
+		if ((*i)->Update(Ticks))
 		{
 			EventPlayerDeleted(Ticks, *i);
+			StopDownload(*i);
 			delete *i;
 			i = m_Players.erase(i);
 		}
@@ -187,11 +143,11 @@ bool CGame::Update(void *fd, void *send_fd)
 
 	for (auto i = begin(m_Potentials); i != end(m_Potentials);)
 	{
-		if ((*i)->Update(fd))
+		if ((*i)->Update())
 		{
 			// flush the socket (e.g. in case a rejection message is queued)
 			if ((*i)->GetSocket())
-				(*i)->GetSocket()->DoSend((fd_set *)send_fd);
+				(*i)->GetSocket()->DoSend();
 			delete *i;
 			i = m_Potentials.erase(i);
 		}
@@ -213,6 +169,7 @@ bool CGame::Update(void *fd, void *send_fd)
 			{
 				if (m_SyncCounter - player->GetSyncCounter() > m_SyncLimit)
 				{
+					LogEvent(EVENT_LAG_STARTED, player->GetPID(), m_SyncCounter - player->GetSyncCounter());
 					player->SetLagging(true);
 					player->SetStartedLaggingTicks(Ticks);
 					m_Lagging = true;
@@ -228,7 +185,7 @@ bool CGame::Update(void *fd, void *send_fd)
 			if (m_Lagging)
 			{
 				// start the lag screen
-				Print("[GAME: " + GetGameName() + "] started lagging on [" + LaggingString + "]");
+				LOG_INFO(GAME, "[GAME: {}] started lagging on [{}]", GetGameName(), LaggingString);
 
 				std::vector<std::pair<uint8_t, uint32_t>> lags;
 				for (auto& ply : m_Players)
@@ -239,50 +196,18 @@ bool CGame::Update(void *fd, void *send_fd)
 					}
 				}
 				SendAll(m_Protocol->SEND_W3GS_START_LAG(lags));
+				m_RelayStats.ResetInterval();
 
 				// reset everyone's drop vote
 				for (auto & player : m_Players)
 					player->SetDropVote(false);
-				m_LagScreenResetTimer.reset(Ticks);
+
+				m_LagScreenResetTimer.Schedule(Ticks + 60000);
 			}
 		}
 
 		if (m_Lagging)
 		{
-			if (Ticks - m_StartedLaggingTicks >= 600000)
-				StopLaggers();
-
-			// we cannot allow the lag screen to stay up for more than ~65 seconds because Warcraft III disconnects if it doesn't receive an action packet at least this often
-			// one (easy) solution is to simply drop all the laggers if they lag for more than 60 seconds
-			// another solution is to reset the lag screen the same way we reset it when using load-in-game
-			if (m_LagScreenResetTimer.update(Ticks, 60000))
-			{
-				for (auto & _i : m_Players)
-				{
-					// stop the lag screen
-					for (auto& ply : m_Players)
-					{
-						if (ply->GetLagging())
-							Send(_i, m_Protocol->SEND_W3GS_STOP_LAG(ply->GetPID(), Ticks - ply->GetStartedLaggingTicks()));
-					}
-
-					Send(_i, m_Protocol->SEND_W3GS_INCOMING_ACTION(std::vector<CIncomingAction *>(), 0));
-
-					// start the lag screen
-					std::vector<std::pair<uint8_t, uint32_t>> lags;
-					for (auto& ply : m_Players)
-					{
-						if (ply->GetLagging())
-						{
-							lags.push_back(std::make_pair(ply->GetPID(), Ticks - ply->GetStartedLaggingTicks()));
-						}
-					}
-					Send(_i, m_Protocol->SEND_W3GS_START_LAG(lags));
-				}
-
-				// Warcraft III doesn't seem to respond to empty actions
-			}
-
 			// check if anyone has stopped lagging normally
 			// we consider a player to have stopped lagging if they're less than half m_SyncLimit keepalives behind
 
@@ -292,8 +217,9 @@ bool CGame::Update(void *fd, void *send_fd)
 				{
 					// stop the lag screen for this player
 
-					Print("[GAME: " + GetGameName() + "] stopped lagging on [" + ply->GetName() + "]");
+					LOG_INFO(GAME, "[GAME: {}] stopped lagging on [{}]", GetGameName(), ply->GetName());
 					SendAll(m_Protocol->SEND_W3GS_STOP_LAG(ply->GetPID(), Ticks - ply->GetStartedLaggingTicks()));
+					LogEvent(EVENT_LAG_STOPPED, ply->GetPID(), Ticks - ply->GetStartedLaggingTicks(), 0);
 					ply->SetLagging(false);
 					ply->SetStartedLaggingTicks(0);
 				}
@@ -314,39 +240,33 @@ bool CGame::Update(void *fd, void *send_fd)
 
 			m_Lagging = Lagging;
 
-			// reset m_ActionSentTimer because we want the game to stop running while the lag screen is up
-			m_ActionSentTimer.reset(Ticks);
-
 			// keep track of the last lag screen time so we can avoid timing out players
 			m_LastLagScreenTicks = Ticks;
-		}
-	}
 
-	// send actions every GetLatency() milliseconds
-	// actions are at the heart of every Warcraft 3 game but luckily we don't need to know their contents to relay them
-	// we queue player actions in EventPlayerAction then just resend them in batches to all players here
-	if (m_State == State::Loaded && !m_Lagging && m_ActionSentTimer.update(Ticks, GetLatency())) {
-		SendAllActions();
+			// the action timer stops while the lag screen is up because we want the game to stop running
+			// restart it now so the next batch goes out GetLatency() milliseconds from now
+
+			if (!m_Lagging)
+			{
+				m_LagScreenResetTimer.Cancel();
+				m_ActionSentTimer.Schedule(Ticks + GetLatency());
+			}
+		}
 	}
 
 	// end the game if there aren't any players left
 	if (m_Players.empty())
 	{
 		if (m_State != State::Waiting) {
-			Print("[GAME: " + GetGameName() + "] is over (no players left)");
-			return true;
-		}
-		if (m_EmptyWaitingTicks == 0) {
-			m_EmptyWaitingTicks = GetTicks();
-		}
-		else if (Ticks - m_EmptyWaitingTicks >= 60000) {
-			Print("[GAME: " + GetGameName() + "] is over (waiting too long)");
+			LOG_INFO(GAME, "[GAME: {}] is over (no players left)", GetGameName());
 			return true;
 		}
+		if (!m_EmptyTimer.IsScheduled())
+			m_EmptyTimer.Schedule(Ticks + 60000);
 	}
 	else
 	{
-		m_EmptyWaitingTicks = 0;
+		m_EmptyTimer.Cancel();
 	}
 
 	// check if the game is loaded
@@ -363,7 +283,8 @@ bool CGame::Update(void *fd, void *send_fd)
 
 		if (FinishedLoading)
 		{
-			m_ActionSentTimer.reset(Ticks);
+			LogEvent(EVENT_GAME_LOADED, 255, (uint32_t)m_Players.size(), Ticks - m_StartedLoadingTicks);
+			m_ActionSentTimer.Schedule(Ticks + GetLatency());
 			m_State = State::Loaded;
 		}
 	}
@@ -371,57 +292,6 @@ bool CGame::Update(void *fd, void *send_fd)
 	if (m_State == State::Loaded || m_State == State::Loading)
 		return m_Exiting;
 
-	if (m_SyncSlotInfoTimer.update(Ticks, 1000))
-	{
-		if (m_SlotInfoChanged)
-			SendAllSlotInfo();
-	}
-
-	if (m_DownloadTimer.update(Ticks, 100))
-	{
-		for (auto & player : m_Players)
-		{
-			if (player->GetDownloadStarted() && !player->GetDownloadFinished())
-			{
-				// send up to 100 pieces of the map at once so that the download goes faster
-				// if we wait for each MAPPART packet to be acknowledged by the client it'll take a long time to download
-				// this is because we would have to wait the round trip time (the ping time) between sending every 1442 bytes of map data
-				// doing it this way allows us to send at least 140 KB in each round trip int32_terval which is much more reasonable
-				// the theoretical throughput is [140 KB * 1000 / ping] in KB/sec so someone with 100 ping (round trip ping, not LC ping) could download at 1400 KB/sec
-				// note: this creates a queue of map data which clogs up the connection when the client is on a slower connection (e.g. dialup)
-				// in this case any changes to the lobby are delayed by the amount of time it takes to send the queued data (i.e. 140 KB, which could be 30 seconds or more)
-				// for example, players joining and leaving, slot changes, chat messages would all appear to happen much later for the low bandwidth player
-				// note: the throughput is also limited by the number of times this code is executed each second
-				// e.g. if we send the maximum amount (140 KB) 10 times per second the theoretical throughput is 1400 KB/sec
-				// therefore the maximum throughput is 1400 KB/sec regardless of ping and this value slowly diminishes as the player's ping increases
-				// in addition to this, the throughput is limited by the configuration value bot_maxdownloadspeed
-				// in summary: the actual throughput is MIN( 140 * 1000 / ping, 1400, bot_maxdownloadspeed ) in KB/sec assuming only one player is downloading the map
-
-				while (player->GetLastMapPartSent() < player->GetLastMapPartAcked() + 1442 * 100 && player->GetLastMapPartSent() < m_Map->GetMapSize())
-				{
-					Send(player, m_Protocol->SEND_W3GS_MAPPART(GetHostPID(), player->GetPID(), player->GetLastMapPartSent(), m_Map->GetMapData()));
-					player->SetLastMapPartSent(player->GetLastMapPartSent() + 1442);
-				}
-			}
-		}
-	}
-
-	if (m_State == State::CountDown && m_CountDownTimer.update(Ticks, 500))
-	{
-		if (m_CountDownCounter > 0)
-		{
-			// we use a countdown counter rather than a "finish countdown time" here because it might alternately round up or down the count
-			// this sometimes resulted in a countdown of e.g. "6 5 3 2 1" during my testing which looks pretty dumb
-			// doing it this way ensures it's always "5 4 3 2 1" but each int32_terval might not be *exactly* the same length
-			SendAllChat(std::to_string(m_CountDownCounter--) + ". . .");
-		}
-		else
-		{
-			EventGameStarted(Ticks);
-			return m_Exiting;
-		}
-	}
-
 	// create the virtual host player
 	if (GetNumPlayers() < 12)
 		CreateVirtualHost();
@@ -429,9 +299,9 @@ bool CGame::Update(void *fd, void *send_fd)
 	// accept new connections
 	if (m_Socket)
 	{
-		CTCPSocket *NewSocket = m_Socket->Accept((fd_set *)fd);
+		CTCPSocket *NewSocket;
 
-		if (NewSocket)
+		while ((NewSocket = m_Socket->Accept()))
 			m_Potentials.push_back(new CPotentialPlayer(m_Protocol, this, NewSocket));
 
 		if (m_Socket->HasError())
@@ -441,32 +311,300 @@ bool CGame::Update(void *fd, void *send_fd)
 	return m_Exiting;
 }
 
-void CGame::UpdatePost(void *send_fd)
+void CGame::UpdatePost()
 {
 	// we need to manually call DoSend on each player now because CGamePlayer :: Update doesn't do it
 	// this is in case player 2 generates a packet for player 1 during the update but it doesn't get sent because player 1 already finished updating
 	// in reality since we're queueing actions it might not make a big difference but oh well
 
+	CProfileScope Scope(m_Profile, PHASE_SEND, m_HostCounter);
+
 	for (auto & player : m_Players)
-		player->GetSocket()->DoSend((fd_set *)send_fd);
+		player->GetSocket()->DoSend();
 
 	for (auto & potential : m_Potentials)
 	{
 		if (potential->GetSocket())
-			potential->GetSocket()->DoSend((fd_set *)send_fd);
+			potential->GetSocket()->DoSend();
 	}
 }
 
-void CGame::Send(CGamePlayer *player, const BYTEARRAY &data)
+void CGame::EventActionTimer(uint32_t Ticks)
+{
+	// send actions every GetLatency() milliseconds
+	// actions are at the heart of every Warcraft 3 game but luckily we don't need to know their contents to relay them
+	// we queue player actions in EventPlayerAction then just resend them in batches to all players here
+	// the timer stops while the lag screen is up, Update restarts it when everyone has caught up
+
+	if (m_State != State::Loaded || m_Lagging)
+		return;
+
+	SendAllActions();
+	m_ActionSentTimer.ScheduleNext(Ticks, GetLatency());
+}
+
+void CGame::EventPingTimer(uint32_t Ticks)
+{
+	// ping every 5 seconds
+	// changed this to ping during game loading as well to hopefully fix some problems with people disconnecting during loading
+	// changed this to ping during the game as well
+
+	// note: we must send pings to players who are downloading the map because Warcraft III disconnects from the lobby if it doesn't receive a ping every ~90 seconds
+	// so if the player takes longer than 90 seconds to download the map they would be disconnected unless we keep sending pings
+
+	SendAll(m_Protocol->SEND_W3GS_PING_FROM_HOST(Ticks));
+
+	// we also broadcast the game to the local network every 5 seconds so we hijack this timer for our nefarious purposes
+	// however we only want to broadcast if the countdown hasn't started
+	// see the !sendlan code later in this file for some more information about how this works
+
+	if (m_State == State::Waiting)
+	{
+		// construct a fixed host counter which will be used to identify players from this "realm" (i.e. LAN)
+		// the fixed host counter's 4 most significant bits will contain a 4 bit ID (0-15)
+		// the rest of the fixed host counter will contain the 28 least significant bits of the actual host counter
+		// since we're destroying 4 bits of information here the actual host counter should not be greater than 2^28 which is a reasonable assumption
+		// when a player joins a game we can obtain the ID from the received host counter
+		// note: LAN broadcasts use an ID of 0, battle.net refreshes use an ID of 1-10, the rest are unused
+
+		// we send 12 for SlotsTotal because this determines how many PID's Warcraft 3 allocates
+		// we need to make sure Warcraft 3 allocates at least SlotsTotal + 1 but at most 12 PID's
+		// this is because we need an extra PID for the virtual host player (but we always delete the virtual host player when the 12th person joins)
+		// however, we can't send 13 for SlotsTotal because this causes Warcraft 3 to crash when sharing control of units
+		// nor can we send SlotsTotal because then Warcraft 3 crashes when playing maps with less than 12 PID's (because of the virtual host player taking an extra PID)
+		// we also send 12 for SlotsOpen because Warcraft 3 assumes there's always at least one player in the game (the host)
+		// so if we try to send accurate numbers it'll always be off by one and results in Warcraft 3 assuming the game is full when it still needs one more player
+		// the easiest solution is to simply send 12 for both so the game will always show up as (1/12) players
+
+		// note: the PrivateGame flag is not set when broadcasting to LAN (as you might expect)
+		// note: we do not use m_Map->GetMapGameType because none of the filters are set when broadcasting to LAN (also as you might expect)
+
+		m_UDPSocket->Broadcast(6112, m_Protocol->SEND_W3GS_GAMEINFO(m_Config->War3Version, 1, m_Map->GetMapGameFlags(), m_Map->GetMapWidth(), m_Map->GetMapHeight(), GetGameName(), "Clan 007", 0, m_Map->GetMapPath(), m_Map->GetMapCRC(), 12, 12, m_HostPort, m_HostCounter & 0x0FFFFFFF, m_EntryKey));
+	}
+
+	m_PingTimer.ScheduleNext(Ticks, 5000);
+}
+
+void CGame::EventDownloadTimer(uint32_t Ticks)
+{
+	if (m_State != State::Waiting && m_State != State::CountDown)
+		return;
+
+	bool Downloading = false;
+
+	for (auto & player : m_Players)
+	{
+		if (player->GetDownloading())
+		{
+			Downloading = true;
+			SendMapParts(player, Ticks);
+		}
+	}
+
+	// keep going every 100 ms until nobody is downloading anymore, EventPlayerMapSize starts us again
+
+	if (Downloading)
+		m_DownloadTimer.ScheduleNext(Ticks, 100);
+}
+
+void CGame::SendMapParts(CGamePlayer *player, uint32_t Ticks)
+{
+	// send as many pieces of the map as the player's download window allows
+	// if we waited for each MAPPART packet to be acknowledged it would take a round trip for every 1442 bytes of map data
+	// but sending a fixed large amount clogs up the connection of a player on a slow link and delays everything else sent to them (chat, slot changes, ...)
+	// so the window is sized from the round trip times of the map data itself (see CGamePlayer::EventMapPartsAcked)
+	// on top of that every part has to fit in the upload budget, whatever doesn't is sent by the download timer later
+
+	if (player->GetDownloadFinished())
+		return;
+
+	bool Sent = false;
+
+	while (player->GetLastMapPartSent() < player->GetLastMapPartAcked() + player->GetDownloadWindow() && player->GetLastMapPartSent() < m_Map->GetMapSize())
+	{
+		// the map data is queued by reference and sent straight from the mapped map file
+
+		const uint32_t Start = player->GetLastMapPartSent();
+		const BYTEVIEW Part = m_Map->GetMapPart(Start);
+
+		if (!TakeDownloadBudget(player, Ticks, Part.size() + sizeof(CGameProtocol::MAPPART_HEADER)))
+			break;
+
+		player->Send(m_Protocol->SEND_W3GS_MAPPART_HEADER(GetHostPID(), player->GetPID(), Start, Part.size(), m_Map->GetMapPartCRC(Start)), Part);
+		player->SetLastMapPartSent(Start + Part.size());
+		Sent = true;
+	}
+
+	if (Sent)
+		player->EventMapPartsSent(Ticks);
+}
+
+bool CGame::TakeDownloadBudget(CGamePlayer *player, uint32_t Ticks, uint32_t Bytes)
+{
+	if (m_DownloadBucket.IsUnlimited() && m_Bandwidth->IsUnlimited())
+		return true;
+
+	// the player's fair share is an equal part of whichever budget is tighter, the game's or the global one
+	// a player who is over their share (e.g. because the others are on slow links and can't use theirs) may still borrow what's left unused
+	// but only while the budgets are at least half full so the players within their share always get to send first
+
+	uint32_t Share = m_Bandwidth->GetFairShare();
+
+	if (!m_DownloadBucket.IsUnlimited())
+	{
+		const uint32_t GameShare = m_DownloadBucket.GetRate() / std::max<uint32_t>(1, m_NumDownloaders);
+
+		if (Share == 0 || GameShare < Share)
+			Share = GameShare;
+	}
+
+	CTokenBucket &PlayerBucket = player->GetDownloadBucket();
+
+	if (PlayerBucket.GetRate() != Share)
+		PlayerBucket.SetRate(Share);
+
+	const bool Borrow = !PlayerBucket.HasTokens(Ticks, Bytes);
+
+	if (!m_DownloadBucket.HasTokens(Ticks, Bytes) || (Borrow && !m_DownloadBucket.IsHalfFull(Ticks)))
+		return false;
+
+	if (!m_Bandwidth->Take(Ticks, Bytes, Borrow))
+		return false;
+
+	m_DownloadBucket.Take(Bytes);
+
+	if (!Borrow)
+		PlayerBucket.Take(Bytes);
+
+	return true;
+}
+
+void CGame::StartDownload(CGamePlayer *player)
+{
+	LogEvent(EVENT_DOWNLOAD_STARTED, player->GetPID(), m_Map->GetMapSize());
+	player->SetDownloadStarted(true);
+	++m_NumDownloaders;
+	m_Bandwidth->AddDownloader();
+}
+
+void CGame::StopDownload(CGamePlayer *player)
+{
+	// called when the download finishes or the player leaves, whichever comes first
+
+	if (!player->GetDownloading())
+		return;
+
+	LogEvent(EVENT_DOWNLOAD_STOPPED, player->GetPID(), player->GetLastMapPartAcked(), m_Map->GetMapSize());
+	player->SetDownloadFinished(true);
+	--m_NumDownloaders;
+	m_Bandwidth->RemoveDownloader();
+}
+
+void CGame::LogEvent(uint8_t Type, uint8_t PID, uint32_t Field0, uint32_t Field1, uint32_t Field2, uint32_t Field3)
+{
+	if (m_EventLog)
+		m_EventLog->Write(m_HostCounter, Type, PID, Field0, Field1, Field2, Field3);
+}
+
+void CGame::EventSyncSlotInfoTimer(uint32_t)
+{
+	if (m_SlotInfoChanged && (m_State == State::Waiting || m_State == State::CountDown))
+		SendAllSlotInfo();
+}
+
+void CGame::EventCountDownTimer(uint32_t Ticks)
+{
+	if (m_State != State::CountDown)
+		return;
+
+	if (m_CountDownCounter > 0)
+	{
+		// we use a countdown counter rather than a "finish countdown time" here because it might alternately round up or down the count
+		// this sometimes resulted in a countdown of e.g. "6 5 3 2 1" during my testing which looks pretty dumb
+		// doing it this way ensures it's always "5 4 3 2 1" but each int32_terval might not be *exactly* the same length
+		SendAllChat(std::to_string(m_CountDownCounter--) + ". . .");
+		m_CountDownTimer.ScheduleNext(Ticks, 500);
+	}
+	else
+		EventGameStarted(Ticks);
+}
+
+void CGame::EventLagScreenResetTimer(uint32_t Ticks)
+{
+	if (m_State != State::Loaded || !m_Lagging)
+		return;
+
+	// this fires every 60 seconds from the start of the lag screen so the tenth time is exactly when the laggers have to go
+
+	if (Ticks - m_StartedLaggingTicks >= 600000)
+		StopLaggers();
+
+	// we cannot allow the lag screen to stay up for more than ~65 seconds because Warcraft III disconnects if it doesn't receive an action packet at least this often
+	// one (easy) solution is to simply drop all the laggers if they lag for more than 60 seconds
+	// another solution is to reset the lag screen the same way we reset it when using load-in-game
+	for (auto & _i : m_Players)
+	{
+		// stop the lag screen
+		for (auto& ply : m_Players)
+		{
+			if (ply->GetLagging())
+				Send(_i, m_Protocol->SEND_W3GS_STOP_LAG(ply->GetPID(), Ticks - ply->GetStartedLaggingTicks()));
+		}
+
+		Send(_i, m_Protocol->SEND_W3GS_INCOMING_ACTION(m_Actions, 0, 0, 0));
+
+		// start the lag screen
+		std::vector<std::pair<uint8_t, uint32_t>> lags;
+		for (auto& ply : m_Players)
+		{
+			if (ply->GetLagging())
+			{
+				lags.push_back(std::make_pair(ply->GetPID(), Ticks - ply->GetStartedLaggingTicks()));
+			}
+		}
+		Send(_i, m_Protocol->SEND_W3GS_START_LAG(lags));
+	}
+
+	// Warcraft III doesn't seem to respond to empty actions
+
+	m_LagScreenResetTimer.ScheduleNext(Ticks, 60000);
+}
+
+void CGame::EventEmptyTimer(uint32_t)
+{
+	if (m_Players.empty() && m_State == State::Waiting)
+	{
+		LOG_INFO(GAME, "[GAME: {}] is over (waiting too long)", GetGameName());
+		m_Exiting = true;
+	}
+}
+
+void CGame::Send(CGamePlayer *player, const BYTEVIEW &data)
 {
 	if (player)
 		player->Send(data);
 }
 
-void CGame::SendAll(const BYTEARRAY &data)
+void CGame::SendAll(const BYTEVIEW &data)
 {
+	// every player's send queue references the same copy of the packet
+	// unless it's small enough to be copied into the queue without allocating
+
+	if (m_Players.empty())
+		return;
+
+	if (data.size() <= CSendQueue::INLINE_SIZE)
+	{
+		for (auto & player : m_Players)
+			player->Send(data);
+
+		return;
+	}
+
+	const SHAREDBYTEARRAY Packet = std::make_shared<const BYTEARRAY>(begin(data), end(data));
+
 	for (auto & player : m_Players)
-		player->Send(data);
+		player->Send(Packet);
 }
 
 void CGame::SendAllChat(const std::string &message)
@@ -476,7 +614,7 @@ void CGame::SendAllChat(const std::string &message)
 
 	if (GetNumPlayers() > 0)
 	{
-		Print("[GAME: " + GetGameName() + "] [Local] " + message);
+		LOG_INFO(GAME, "[GAME: {}] [Local] {}", GetGameName(), message);
 
 		if (m_State == State::Waiting || m_State == State::CountDown)
 		{
@@ -513,39 +651,54 @@ void CGame::SendVirtualHostPlayerInfo(CGamePlayer *player)
 
 void CGame::SendAllActions()
 {
+	CProfileScope Scope(m_Profile, PHASE_SEND_ACTIONS, m_HostCounter);
+	const uint64_t Now = GetProfileTime();
+	m_RelayStats.RecordBatch(Now);
 	++m_SyncCounter;
 
 	// we aren't allowed to send more than 1460 bytes in a single packet but it's possible we might have more than that many bytes waiting in the queue
 
+	// so the queue is split into runs that fit and every run but the last is sent in a W3GS_INCOMING_ACTION2 packet
+
+	uint32_t First = 0;
 	uint32_t SubActionsLength = 0;
-	std::vector<CIncomingAction *> SubActions;
-	for (auto& act : m_Actions)
+	uint32_t TotalLength = 0;
+	uint32_t NumPackets = 1;
+
+	for (uint32_t i = 0; i < m_Actions.GetNumActions(); ++i)
 	{
-		if (SubActionsLength + act->GetLength() > 1452)
+		const CActionQueue::CAction &Action = m_Actions.GetAction(i);
+		const uint32_t Length = CActionQueue::GetEncodedLength(Action);
+		m_RelayStats.RecordDelay(Now - Action.Received);
+
+		if (SubActionsLength + Length > 1452)
 		{
-			SendAll(m_Protocol->SEND_W3GS_INCOMING_ACTION2(SubActions));
-			SubActions.clear();
+			SendAll(m_Protocol->SEND_W3GS_INCOMING_ACTION2(m_Actions, First, i));
+			First = i;
 			SubActionsLength = 0;
+			++NumPackets;
 		}
-		SubActions.push_back(act);
-		SubActionsLength += act->GetLength();
-	}
 
-	SendAll(m_Protocol->SEND_W3GS_INCOMING_ACTION(SubActions, GetLatency()));
-
-	for (auto& act : m_Actions)
-	{
-		delete act;
+		SubActionsLength += Length;
+		TotalLength += Length;
 	}
-	m_Actions.clear();
+
+	SendAll(m_Protocol->SEND_W3GS_INCOMING_ACTION(m_Actions, First, m_Actions.GetNumActions(), GetLatency()));
+	LogEvent(EVENT_ACTION_BATCH, 255, m_Actions.GetNumActions(), TotalLength, NumPackets, m_SyncCounter);
+	m_Actions.Clear();
 }
 
 void CGame::EventPlayerDeleted(uint32_t Ticks, CGamePlayer *player)
 {
-	Print("[GAME: " + GetGameName() + "] deleting player [" + player->GetName() + "]");
+	LOG_INFO(GAME, "[GAME: {}] deleting player [{}]", GetGameName(), player->GetName());
 
 	if (player->GetLagging())
+	{
 		SendAll(m_Protocol->SEND_W3GS_STOP_LAG(player->GetPID(), Ticks - player->GetStartedLaggingTicks()));
+		LogEvent(EVENT_LAG_STOPPED, player->GetPID(), Ticks - player->GetStartedLaggingTicks(), 1);
+	}
+
+	LogEvent(EVENT_PLAYER_LEFT, player->GetPID(), player->GetLeftCode(), player->GetSyncCounter());
 
 	// tell everyone about the player leaving
 
@@ -575,13 +728,19 @@ void CGame::EventPlayerDisconnectConnectionClosed(CGamePlayer *player)
 	DeletePlayer(player, PLAYERLEAVE_DISCONNECT);
 }
 
+void CGame::EventPlayerDisconnectProtocolError(CGamePlayer *player)
+{
+	LOG_WARNING(GAME, "[GAME: {}] player [{}] sent a malformed packet", GetGameName(), player->GetName());
+	DeletePlayer(player, PLAYERLEAVE_DISCONNECT);
+}
+
 void CGame::EventPlayerJoined(CPotentialPlayer *potential, CIncomingJoinPlayer *joinPlayer)
 {
 	// check the new player's name
 
 	if (joinPlayer->GetName().empty() || joinPlayer->GetName().size() > 15 || joinPlayer->GetName() == GetVirtualHostName())
 	{
-		Print("[GAME: " + GetGameName() + "] player [" + joinPlayer->GetName() + "|" + potential->GetExternalIPString() + "] invalid name (taken, invalid char, spoofer, too long)");
+		LOG_WARNING(GAME, "[GAME: {}] player [{}|{}] invalid name (taken, invalid char, spoofer, too long)", GetGameName(), joinPlayer->GetName(), logging::ipv4(potential->GetExternalIP()));
 		potential->Send(m_Protocol->SEND_W3GS_REJECTJOIN(REJECTJOIN_FULL));
 		potential->SetDeleteMe(true);
 		return;
@@ -597,7 +756,7 @@ void CGame::EventPlayerJoined(CPotentialPlayer *potential, CIncomingJoinPlayer *
 
 		if (joinPlayer->GetEntryKey() != m_EntryKey)
 		{
-			Print("[GAME: " + GetGameName() + "] player [" + joinPlayer->GetName() + "|" + potential->GetExternalIPString() + "] is trying to join the game over LAN but used an incorrect entry key");
+			LOG_INFO(GAME, "[GAME: {}] player [{}|{}] is trying to join the game over LAN but used an incorrect entry key", GetGameName(), joinPlayer->GetName(), logging::ipv4(potential->GetExternalIP()));
 			potential->Send(m_Protocol->SEND_W3GS_REJECTJOIN(REJECTJOIN_WRONGPASSWORD));
 			potential->SetDeleteMe(true);
 			return;
@@ -623,8 +782,9 @@ void CGame::EventPlayerJoined(CPotentialPlayer *potential, CIncomingJoinPlayer *
 	// this problem is solved by setting the socket to nullptr before deletion and handling the nullptr case in the destructor
 	// we also have to be careful to not modify the m_Potentials vector since we're currently looping through it
 
-	Print("[GAME: " + GetGameName() + "] player [" + joinPlayer->GetName() + "|" + potential->GetExternalIPString() + "] joined the game");
+	LOG_INFO(GAME, "[GAME: {}] player [{}|{}] joined the game", GetGameName(), joinPlayer->GetName(), logging::ipv4(potential->GetExternalIP()));
 	CGamePlayer *Player = new CGamePlayer(potential, GetNewPID(), joinPlayer->GetName(), joinPlayer->GetInternalIP());
+	LogEvent(EVENT_PLAYER_JOINED, Player->GetPID(), potential->GetExternalIP(), joinPlayer->GetInternalIP());
 
 	m_Players.push_back(Player);
 	potential->SetSocket(nullptr);
@@ -727,9 +887,9 @@ void CGame::EventPlayerLoaded(CGamePlayer *player)
 	SendAll(m_Protocol->SEND_W3GS_GAMELOADED_OTHERS(player->GetPID()));
 }
 
-void CGame::EventPlayerAction(CGamePlayer *player, CIncomingAction *action)
+void CGame::EventPlayerAction(CGamePlayer *player, const BYTEVIEW &action)
 {
-	m_Actions.push_back(action);
+	m_Actions.Push(player->GetPID(), action, GetProfileTime());
 }
 
 void CGame::EventPlayerKeepAlive(CGamePlayer *player)
@@ -746,7 +906,8 @@ void CGame::EventPlayerKeepAlive(CGamePlayer *player)
 		if (!m_Desynced && player->GetCheckSums()->front() != FirstCheckSum)
 		{
 			m_Desynced = true;
-			Print("[GAME: " + GetGameName() + "] desync detected");
+			LOG_WARNING(GAME, "[GAME: {}] desync detected", GetGameName());
+			LogEvent(EVENT_DESYNC, player->GetPID(), player->GetCheckSums()->front(), FirstCheckSum, m_SyncCounter);
 			SendAllChat("Warning! Desync detected!");
 			SendAllChat("Warning! Desync detected!");
 			SendAllChat("Warning! Desync detected!");
@@ -908,7 +1069,7 @@ void CGame::EventPlayerDropRequest(CGamePlayer *player)
 
 	if (m_Lagging)
 	{
-		Print("[GAME: " + GetGameName() + "] player [" + player->GetName() + "] voted to drop laggers");
+		LOG_INFO(GAME, "[GAME: {}] player [{}] voted to drop laggers", GetGameName(), player->GetName());
 		SendAllChat("Player [" + player->GetName() + "] voted to drop laggers");
 
 		// check if at least half the players voted to drop
@@ -935,20 +1096,29 @@ void CGame::EventPlayerMapSize(CGamePlayer *player, CIncomingMapSize *mapSize)
 	{
 		// the player doesn't have the map
 
-		const std::string *MapData = m_Map->GetMapData();
-
-		if (!MapData->empty())
+		if (!m_Map->GetMapData().empty())
 		{
 			if (!player->GetDownloadStarted() && mapSize->GetSizeFlag() == 1)
 			{
 				// inform the client that we are willing to send the map
 
-				Print("[GAME: " + GetGameName() + "] map download started for player [" + player->GetName() + "]");
+				LOG_INFO(GAME, "[GAME: {}] map download started for player [{}]", GetGameName(), player->GetName());
 				Send(player, m_Protocol->SEND_W3GS_STARTDOWNLOAD(GetHostPID()));
-				player->SetDownloadStarted(true);
+				StartDownload(player);
+
+				if (!m_DownloadTimer.IsScheduled())
+					m_DownloadTimer.Schedule(GetTicks());
 			}
 			else
-				player->SetLastMapPartAcked(mapSize->GetMapSize());
+			{
+				// send more map data right away instead of waiting for the download timer so the download keeps pace with the acknowledgements
+
+				const uint32_t Ticks = GetTicks();
+				player->EventMapPartsAcked(Ticks, mapSize->GetMapSize());
+
+				if (player->GetDownloadStarted())
+					SendMapParts(player, Ticks);
+			}
 		}
 		else
 		{
@@ -957,7 +1127,8 @@ void CGame::EventPlayerMapSize(CGamePlayer *player, CIncomingMapSize *mapSize)
 	}
 	else if (player->GetDownloadStarted())
 	{
-		player->SetDownloadFinished(true);
+		player->SetLastMapPartAcked(mapSize->GetMapSize());
+		StopDownload(player);
 	}
 
 	uint8_t NewDownloadStatus = (uint8_t)((float)mapSize->GetMapSize() / m_Map->GetMapSize() * 100.f);
@@ -974,19 +1145,27 @@ void CGame::EventPlayerMapSize(CGamePlayer *player, CIncomingMapSize *mapSize)
 		{
 			m_Slots[SID].SetDownloadStatus(NewDownloadStatus);
 
+			if (player->GetDownloadStarted())
+				LogEvent(EVENT_DOWNLOAD_PROGRESS, player->GetPID(), mapSize->GetMapSize(), NewDownloadStatus);
+
 			// we don't actually send the new slot info here
 			// this is an optimization because it's possible for a player to download a map very quickly
 			// if we send a new slot update for every percentage change in their download status it adds up to a lot of data
 			// instead, we mark the slot info as "out of date" and update it only once in awhile (once per second when this comment was made)
 
 			m_SlotInfoChanged = true;
+
+			if (!m_SyncSlotInfoTimer.IsScheduled())
+				m_SyncSlotInfoTimer.Schedule(GetTicks() + 1000);
 		}
 	}
 }
 
 void CGame::EventGameStarted(uint32_t Ticks)
 {
-	Print("[GAME: " + GetGameName() + "] started loading with " + std::to_string(GetNumPlayers()) + " players");
+	LOG_INFO(GAME, "[GAME: {}] started loading with {} players", GetGameName(), GetNumPlayers());
+	LogEvent(EVENT_GAME_LOADING, 255, GetNumPlayers());
+	m_StartedLoadingTicks = Ticks;
 
 	// send a final slot info update if necessary
 	// this typically won't happen because we prevent the !start command from completing while someone is downloading the map
@@ -997,7 +1176,6 @@ void CGame::EventGameStarted(uint32_t Ticks)
 	if (m_SlotInfoChanged)
 		SendAllSlotInfo();
 
-	m_LagScreenResetTimer.reset(Ticks);
 	m_State = State::Loading;
 
 	// since we use a fake countdown to deal with leavers during countdown the COUNTDOWN_START and COUNTDOWN_END packets are sent in quick succession
@@ -1024,6 +1202,11 @@ void CGame::EventGameStarted(uint32_t Ticks)
 		delete potential;
 
 	m_Potentials.clear();
+
+	// no more map data is sent once the game has started so don't hold on to a share of the upload budget
+
+	for (auto & player : m_Players)
+		StopDownload(player);
 }
 
 uint8_t CGame::GetSIDFromPID(uint8_t PID) const
@@ -1272,6 +1455,9 @@ void CGame::StartCountDown()
 	{
 		m_State = State::CountDown;
 		m_CountDownCounter = 5;
+
+		if (!m_CountDownTimer.IsScheduled())
+			m_CountDownTimer.Schedule(GetTicks());
 	}
 }
 
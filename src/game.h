@@ -21,7 +21,12 @@ CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
 #ifndef AURA_GAME_H_
 #define AURA_GAME_H_
 
+#include "actionqueue.h"
 #include "gameslot.h"
+#include "timerwheel.h"
+#include "bandwidth.h"
+#include "relaystats.h"
+#include <string>
 #include <vector>
 #include <queue>
 typedef std::vector<uint8_t> BYTEARRAY;
@@ -32,41 +37,18 @@ typedef std::vector<uint8_t> BYTEARRAY;
 
 class CUDPSocket;
 class CTCPServer;
+class CPoller;
 class CGameProtocol;
 class CPotentialPlayer;
 class CGamePlayer;
 class CMap;
+class CBandwidthManager;
+class CEventLog;
+class CThreadProfile;
 class CIncomingJoinPlayer;
-class CIncomingAction;
 class CIncomingChatPlayer;
 class CIncomingMapSize;
 
-class CTimer
-{
-public:
-	CTimer()
-		: m_Ticks(0)
-	{ }
-
-	bool update(uint32_t CurTicks, int32_t Timeout)
-	{
-		if (CurTicks < m_Ticks + Timeout)
-		{
-			return false;
-		}
-		reset(m_Ticks + Timeout);
-		return true;
-	}
-
-	void reset(uint32_t CurTicks)
-	{
-		m_Ticks = CurTicks;
-	}
-
-private:
-	uint32_t m_Ticks;
-};
-
 struct CGameConfig
 {
 	std::string GameName;
@@ -74,18 +56,20 @@ struct CGameConfig
 	uint8_t     War3Version;
 	uint32_t    Latency;
 	uint32_t    AutoStart;
+	uint32_t    MaxDownloadSpeed;                 // the map upload budget of this game in bytes per second, 0 = unlimited
 };
 
 class CGame
 {
 protected:
 	CUDPSocket *m_UDPSocket;
+	CTimerWheel *m_Timers;                        // the timer wheel of the shard running this game
 	CTCPServer *m_Socket;                         // listening socket
 	CGameProtocol *m_Protocol;                    // game protocol
 	std::vector<CGameSlot> m_Slots;               // std::vector of slots
 	std::vector<CPotentialPlayer *> m_Potentials; // std::vector of potential players (connections that haven't sent a W3GS_REQJOIN packet yet)
 	std::vector<CGamePlayer *> m_Players;         // std::vector of players
-	std::vector<CIncomingAction *> m_Actions;     // queue of actions to be sent
+	CActionQueue m_Actions;                       // queue of actions to be sent
 	const CMap *m_Map;                            // map data
 	const CGameConfig* m_Config;
 	uint32_t m_RandomSeed;                        // the random seed sent to the Warcraft III clients
@@ -96,13 +80,20 @@ protected:
 	uint32_t m_CountDownCounter;                  // the countdown is finished when this reaches zero
 	uint32_t m_StartedLaggingTicks;               // GetTicks when the last lag screen started
 	uint32_t m_LastLagScreenTicks;                // GetTicks when the last lag screen was active (continuously updated)
-	uint32_t m_EmptyWaitingTicks;
-	CTimer m_ActionSentTimer;                     // GetTicks when the last action packet was sent
-	CTimer m_PingTimer;                           // GetTicks when the last ping was sent
-	CTimer m_DownloadTimer;                       // GetTicks when the last map download cycle was performed
-	CTimer m_SyncSlotInfoTimer;                   // GetTicks when the download counter was last reset
-	CTimer m_CountDownTimer;                      // GetTicks when the last countdown message was sent
-	CTimer m_LagScreenResetTimer;                 // GetTicks when the "lag" screen was last reset
+	uint32_t m_StartedLoadingTicks;               // GetTicks when the game started loading
+	CTimer m_ActionSentTimer;                     // sends the queued actions every GetLatency() milliseconds (stopped while lagging)
+	CTimer m_PingTimer;                           // pings the players and broadcasts the game every 5 seconds
+	CTimer m_DownloadTimer;                       // sends map parts every 100 ms while anyone is downloading
+	CBandwidthManager *m_Bandwidth;               // the global map upload budget shared with every other game
+	CTokenBucket m_DownloadBucket;                // this game's map upload budget (bot_maxgamedownloadspeed)
+	CEventLog *m_EventLog;                        // the binary event log shared with every other game, null if it's off
+	CThreadProfile *m_Profile;                    // the phase timings of the shard running this game, null if the profiler is off
+	CRelayStats m_RelayStats;                     // the action batch intervals and queueing delays (logged at the end and served by CStatsServer)
+	uint32_t m_NumDownloaders;                    // the number of players downloading the map right now
+	CTimer m_SyncSlotInfoTimer;                   // sends the download status changes at most once per second
+	CTimer m_CountDownTimer;                      // sends the next countdown message every 500 ms
+	CTimer m_LagScreenResetTimer;                 // resets the "lag" screen every 60 seconds
+	CTimer m_EmptyTimer;                          // ends the game when the lobby has been empty for 60 seconds
 	uint16_t m_HostPort;                          // the port to host games on
 	uint8_t m_VirtualHostPID;                     // host's PID
 	bool m_Exiting;                               // set to true and this class will be deleted next update
@@ -122,14 +113,19 @@ protected:
 	State m_State;
 
 public:
-	CGame(const CMap* Map, const CGameConfig* Config, CUDPSocket* UDPSocket, uint32_t HostCounter);
+	CGame(const CMap* Map, const CGameConfig* Config, CUDPSocket* UDPSocket, CPoller* Poller, CTimerWheel* Timers, CBandwidthManager* Bandwidth, CEventLog* EventLog, CThreadProfile* Profile, uint32_t HostCounter);
 	~CGame();
 	CGame(CGame &) = delete;
 
-	inline std::string GetGameName() const            { return m_Config->GameName; }
+	inline const std::string &GetGameName() const    { return m_Config->GameName; }
 	inline std::string GetVirtualHostName() const     { return m_Config->VirtualHostName; }
 	inline uint32_t GetLatency() const                { return m_Config->Latency; }
 	inline uint32_t GetLastLagScreenTicks() const     { return m_LastLagScreenTicks; }
+	inline CTimerWheel *GetTimers() const             { return m_Timers; }
+	inline CThreadProfile *GetProfile() const         { return m_Profile; }
+	inline uint32_t GetHostCounter() const            { return m_HostCounter; }
+	inline const CRelayStats *GetRelayStats() const   { return &m_RelayStats; }
+	inline bool GetLagging() const                    { return m_Lagging; }
 	
 	uint32_t GetNumPlayers() const;
 
@@ -137,14 +133,13 @@ public:
 
 	// processing functions
 
-	uint32_t SetFD(void *fd, void *send_fd, int32_t *nfds);
-	bool Update(void *fd, void *send_fd);
-	void UpdatePost(void *send_fd);
+	bool Update();
+	void UpdatePost();
 
 	// generic functions to send packets to players
 
-	void Send(CGamePlayer *player, const BYTEARRAY &data);
-	void SendAll(const BYTEARRAY &data);
+	void Send(CGamePlayer *player, const BYTEVIEW &data);
+	void SendAll(const BYTEVIEW &data);
 
 	// functions to send packets to players
 
@@ -152,6 +147,28 @@ public:
 	void SendAllSlotInfo();
 	void SendVirtualHostPlayerInfo(CGamePlayer *player);
 	void SendAllActions();
+	void SendMapParts(CGamePlayer *player, uint32_t Ticks);
+
+	// map download bookkeeping
+
+	bool TakeDownloadBudget(CGamePlayer *player, uint32_t Ticks, uint32_t Bytes);
+	void StartDownload(CGamePlayer *player);
+	void StopDownload(CGamePlayer *player);
+
+	// record an event in the binary event log (if it's on), PID is 255 for events about the whole game
+
+	void LogEvent(uint8_t Type, uint8_t PID, uint32_t Field0 = 0, uint32_t Field1 = 0, uint32_t Field2 = 0, uint32_t Field3 = 0);
+
+	// timer events
+	// these are called by the timer wheel outside of any iterations, periodic timers schedule themselves again
+
+	void EventActionTimer(uint32_t Ticks);
+	void EventPingTimer(uint32_t Ticks);
+	void EventDownloadTimer(uint32_t Ticks);
+	void EventSyncSlotInfoTimer(uint32_t Ticks);
+	void EventCountDownTimer(uint32_t Ticks);
+	void EventLagScreenResetTimer(uint32_t Ticks);
+	void EventEmptyTimer(uint32_t Ticks);
 
 	// events
 	// note: these are only called while iterating through the m_Potentials or m_Players std::vectors
@@ -161,10 +178,11 @@ public:
 	void EventPlayerDisconnectTimedOut(CGamePlayer *player);
 	void EventPlayerDisconnectSocketError(CGamePlayer *player);
 	void EventPlayerDisconnectConnectionClosed(CGamePlayer *player);
+	void EventPlayerDisconnectProtocolError(CGamePlayer *player);
 	void EventPlayerJoined(CPotentialPlayer *potential, CIncomingJoinPlayer *joinPlayer);
 	void EventPlayerLeft(CGamePlayer *player, uint32_t reason);
 	void EventPlayerLoaded(CGamePlayer *player);
-	void EventPlayerAction(CGamePlayer *player, CIncomingAction *action);
+	void EventPlayerAction(CGamePlayer *player, const BYTEVIEW &action);
 	void EventPlayerKeepAlive(CGamePlayer *player);
 	void EventPlayerChatToHost(CGamePlayer *player, CIncomingChatPlayer *chatPlayer);
 	void EventPlayerChangeTeam(CGamePlayer *player, uint8_t team);
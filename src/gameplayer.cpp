@@ -22,6 +22,10 @@ CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
 #include "gameprotocol.h"
 #include "game.h"
 #include "util.h"
+#include "profiler.h"
+#include "logging.h"
+
+#include <algorithm>
 
 //
 // CPotentialPlayer
@@ -45,7 +49,7 @@ CPotentialPlayer::~CPotentialPlayer()
 	delete m_IncomingJoinPlayer;
 }
 
-bool CPotentialPlayer::Update(void *fd)
+bool CPotentialPlayer::Update()
 {
 	if (m_DeleteMe)
 		return true;
@@ -53,51 +57,54 @@ bool CPotentialPlayer::Update(void *fd)
 	if (!m_Socket)
 		return false;
 
-	m_Socket->DoRecv((fd_set *)fd);
+	// only a socket the poller marked is timed, the others have nothing to do
+
+	{
+		CProfileScope Scope(m_Socket->IsReadable() ? m_Game->GetProfile() : nullptr, PHASE_RECV, m_Game->GetHostCounter());
+		m_Socket->DoRecv();
+	}
 
 	// extract as many packets as possible from the socket's receive buffer and process them
+	// the packets are parsed in place and the processed bytes are dropped from the buffer once at the end
 
-	std::string *RecvBuffer = m_Socket->GetBytes();
-	BYTEARRAY Bytes = CreateByteArray((uint8_t *)RecvBuffer->c_str(), RecvBuffer->size());
+	CRingBuffer *RecvBuffer = m_Socket->GetBytes();
+	CProfileScope Scope(RecvBuffer->GetSize() > 0 ? m_Game->GetProfile() : nullptr, PHASE_PARSE, m_Game->GetHostCounter());
+	const uint8_t *Buffer = RecvBuffer->Linearize();
+	const uint32_t BufferSize = RecvBuffer->GetSize();
 	uint32_t LengthProcessed = 0;
 
-	// a packet is at least 4 bytes so loop as long as the buffer contains 4 bytes
-
-	while (Bytes.size() >= 4)
+	while (true)
 	{
-		if (Bytes[0] == W3GS_HEADER_CONSTANT)
-		{
-			// bytes 2 and 3 contain the length of the packet
+		const int32_t Length = CGameProtocol::FramePacket(BYTEVIEW(Buffer + LengthProcessed, BufferSize - LengthProcessed));
 
-			const uint16_t Length = ByteArrayToUInt16(Bytes, 2);
-			const BYTEARRAY Data = BYTEARRAY(begin(Bytes), begin(Bytes) + Length);
+		if (Length == 0)
+			break;
 
-			if (Bytes.size() >= Length)
-			{
-				if (Bytes[0] == W3GS_HEADER_CONSTANT && Bytes[1] == CGameProtocol::W3GS_REQJOIN)
-				{
-					delete m_IncomingJoinPlayer;
-					m_IncomingJoinPlayer = m_Protocol->RECEIVE_W3GS_REQJOIN(Data);
+		if (Length < 0)
+		{
+			LOG_WARNING(GAME, "[GAME: {}] dropping connection from [{}] (malformed packet)", m_Game->GetGameName(), logging::ipv4(GetExternalIP()));
+			m_DeleteMe = true;
+			break;
+		}
 
-					if (m_IncomingJoinPlayer)
-						m_Game->EventPlayerJoined(this, m_IncomingJoinPlayer);
+		const BYTEVIEW Data(Buffer + LengthProcessed, Length);
+		LengthProcessed += Length;
 
-					// this is the packet which int32_terests us for now, the remainder is left for CGamePlayer
+		if (Data[1] == CGameProtocol::W3GS_REQJOIN)
+		{
+			delete m_IncomingJoinPlayer;
+			m_IncomingJoinPlayer = m_Protocol->RECEIVE_W3GS_REQJOIN(Data);
 
-					LengthProcessed += Length;
-					Bytes = BYTEARRAY(begin(Bytes) + Length, end(Bytes));
-					break;
-				}
+			if (m_IncomingJoinPlayer)
+				m_Game->EventPlayerJoined(this, m_IncomingJoinPlayer);
 
-				LengthProcessed += Length;
-				Bytes = BYTEARRAY(begin(Bytes) + Length, end(Bytes));
-			}
-			else
-				break;
+			// this is the packet which int32_terests us for now, the remainder is left for CGamePlayer
+
+			break;
 		}
 	}
 
-	*RecvBuffer = RecvBuffer->substr(LengthProcessed);
+	RecvBuffer->Consume(LengthProcessed);
 
 	// don't call DoSend here because some other players may not have updated yet and may generate a packet for this player
 	// also m_Socket may have been set to nullptr during ProcessPackets but we're banking on the fact that m_DeleteMe has been set to true as well so it'll short circuit before dereferencing
@@ -105,7 +112,13 @@ bool CPotentialPlayer::Update(void *fd)
 	return m_DeleteMe || !m_Socket->GetConnected() || m_Socket->HasError();
 }
 
-void CPotentialPlayer::Send(const BYTEARRAY &data) const
+void CPotentialPlayer::Send(const BYTEVIEW &data) const
+{
+	if (m_Socket)
+		m_Socket->PutBytes(data);
+}
+
+void CPotentialPlayer::Send(const SHAREDBYTEARRAY &data) const
 {
 	if (m_Socket)
 		m_Socket->PutBytes(data);
@@ -125,6 +138,11 @@ CGamePlayer::CGamePlayer(CPotentialPlayer *potential, uint8_t nPID, const std::s
 	m_SyncCounter(0),
 	m_LastMapPartSent(0),
 	m_LastMapPartAcked(0),
+	m_DownloadWindow(16 * 1442),
+	m_DownloadProbe(0),
+	m_DownloadProbeTicks(0),
+	m_RTT(0),
+	m_MinRTT(0xFFFFFFFF),
 	m_StartedLaggingTicks(0),
 	m_PID(nPID),
 	m_DownloadStarted(false),
@@ -134,7 +152,8 @@ CGamePlayer::CGamePlayer(CPotentialPlayer *potential, uint8_t nPID, const std::s
 	m_DropVote(false),
 	m_DeleteMe(false)
 {
-
+	m_TimeoutTimer.Init(m_Game->GetTimers(), [this](uint32_t Ticks) { EventTimeoutTimer(Ticks); });
+	m_TimeoutTimer.Schedule(m_Socket->GetLastRecv() + 30000);
 }
 
 CGamePlayer::~CGamePlayer()
@@ -142,127 +161,143 @@ CGamePlayer::~CGamePlayer()
 	delete m_Socket;
 }
 
-bool CGamePlayer::Update(uint32_t Ticks, void *fd)
+void CGamePlayer::EventTimeoutTimer(uint32_t Ticks)
 {
 	// check for socket timeouts
 	// if we don't receive anything from a player for 30 seconds we can assume they've dropped
 	// this works because in the lobby we send pings every 5 seconds and expect a response to each one
 	// and in the game the Warcraft 3 client sends keepalives frequently (at least once per second it looks like)
+	// receiving doesn't touch the timer, instead it checks the last receive time when it fires and goes back to sleep if there was one
 
-	if (Ticks - m_Socket->GetLastRecv() >= 30000)
+	const uint32_t LastRecv = m_Socket->GetLastRecv();
+
+	if (Ticks - LastRecv < 30000)
 	{
-		// not only do we not do any timeouts if the game is lagging, we allow for an additional grace period of 10 seconds
-		// this is because Warcraft 3 stops sending packets during the lag screen
-		// so when the lag screen finishes we would immediately disconnect everyone if we didn't give them some extra time
+		m_TimeoutTimer.Schedule(LastRecv + 30000);
+		return;
+	}
 
-		if (Ticks - m_Game->GetLastLagScreenTicks() >= 10000)
-		{
-			m_Game->EventPlayerDisconnectTimedOut(this);
-		}
+	// not only do we not do any timeouts if the game is lagging, we allow for an additional grace period of 10 seconds
+	// this is because Warcraft 3 stops sending packets during the lag screen
+	// so when the lag screen finishes we would immediately disconnect everyone if we didn't give them some extra time
+
+	if (m_Game->GetLagging())
+	{
+		m_TimeoutTimer.Schedule(Ticks + 10000);
+		return;
 	}
 
-	m_Socket->DoRecv((fd_set *)fd);
+	if (Ticks - m_Game->GetLastLagScreenTicks() < 10000)
+	{
+		m_TimeoutTimer.Schedule(m_Game->GetLastLagScreenTicks() + 10000);
+		return;
+	}
+
+	m_Game->EventPlayerDisconnectTimedOut(this);
+}
+
+bool CGamePlayer::Update(uint32_t Ticks)
+{
+	{
+		CProfileScope Scope(m_Socket->IsReadable() ? m_Game->GetProfile() : nullptr, PHASE_RECV, m_Game->GetHostCounter());
+		m_Socket->DoRecv();
+	}
 
 	// extract as many packets as possible from the socket's receive buffer and process them
+	// the packets are parsed in place and the processed bytes are dropped from the buffer once at the end
 
-	std::string *RecvBuffer = m_Socket->GetBytes();
-	BYTEARRAY Bytes = CreateByteArray((uint8_t *)RecvBuffer->c_str(), RecvBuffer->size());
+	CRingBuffer *RecvBuffer = m_Socket->GetBytes();
+	CProfileScope Scope(RecvBuffer->GetSize() > 0 ? m_Game->GetProfile() : nullptr, PHASE_PARSE, m_Game->GetHostCounter());
+	const uint8_t *Buffer = RecvBuffer->Linearize();
+	const uint32_t BufferSize = RecvBuffer->GetSize();
 	uint32_t LengthProcessed = 0;
 
-	// a packet is at least 4 bytes so loop as long as the buffer contains 4 bytes
-
-	CIncomingAction *Action;
+	BYTEVIEW Action;
 	CIncomingChatPlayer *ChatPlayer;
 	CIncomingMapSize *MapSize;
 
-	while (Bytes.size() >= 4)
+	while (true)
 	{
-		// bytes 2 and 3 contain the length of the packet
+		const int32_t Length = CGameProtocol::FramePacket(BYTEVIEW(Buffer + LengthProcessed, BufferSize - LengthProcessed));
 
-		const uint16_t Length = ByteArrayToUInt16(Bytes, 2);
-		const BYTEARRAY Data = BYTEARRAY(begin(Bytes), begin(Bytes) + Length);
+		if (Length == 0)
+			break;
 
-		if (Bytes[0] == W3GS_HEADER_CONSTANT)
+		if (Length < 0)
 		{
-			if (Bytes.size() >= Length)
-			{
-				// byte 1 contains the packet ID
-
-				switch (Bytes[1])
-				{
-				case CGameProtocol::W3GS_LEAVEGAME:
-					m_Game->EventPlayerLeft(this, m_Protocol->RECEIVE_W3GS_LEAVEGAME(Data));
-					break;
+			m_Game->EventPlayerDisconnectProtocolError(this);
+			break;
+		}
 
-				case CGameProtocol::W3GS_GAMELOADED_SELF:
-					if (m_Protocol->RECEIVE_W3GS_GAMELOADED_SELF(Data))
-					{
-						if (!m_FinishedLoading)
-						{
-							m_FinishedLoading = true;
-							m_Game->EventPlayerLoaded(this);
-						}
-					}
+		const BYTEVIEW Data(Buffer + LengthProcessed, Length);
+		LengthProcessed += Length;
 
-					break;
+		// byte 1 contains the packet ID
 
-				case CGameProtocol::W3GS_OUTGOING_ACTION:
-					Action = m_Protocol->RECEIVE_W3GS_OUTGOING_ACTION(Data, m_PID);
+		switch (Data[1])
+		{
+		case CGameProtocol::W3GS_LEAVEGAME:
+			m_Game->EventPlayerLeft(this, m_Protocol->RECEIVE_W3GS_LEAVEGAME(Data));
+			break;
 
-					if (Action)
-						m_Game->EventPlayerAction(this, Action);
+		case CGameProtocol::W3GS_GAMELOADED_SELF:
+			if (m_Protocol->RECEIVE_W3GS_GAMELOADED_SELF(Data))
+			{
+				if (!m_FinishedLoading)
+				{
+					m_FinishedLoading = true;
+					m_Game->EventPlayerLoaded(this);
+				}
+			}
 
-					// don't delete Action here because the game is going to store it in a queue and delete it later
+			break;
 
-					break;
+		case CGameProtocol::W3GS_OUTGOING_ACTION:
+			if (m_Protocol->RECEIVE_W3GS_OUTGOING_ACTION(Data, m_PID, Action))
+				m_Game->EventPlayerAction(this, Action);
 
-				case CGameProtocol::W3GS_OUTGOING_KEEPALIVE:
-					m_CheckSums.push(m_Protocol->RECEIVE_W3GS_OUTGOING_KEEPALIVE(Data));
-					++m_SyncCounter;
-					m_Game->EventPlayerKeepAlive(this);
-					break;
+			break;
 
-				case CGameProtocol::W3GS_CHAT_TO_HOST:
-					ChatPlayer = m_Protocol->RECEIVE_W3GS_CHAT_TO_HOST(Data);
+		case CGameProtocol::W3GS_OUTGOING_KEEPALIVE:
+			m_CheckSums.push(m_Protocol->RECEIVE_W3GS_OUTGOING_KEEPALIVE(Data));
+			++m_SyncCounter;
+			m_Game->EventPlayerKeepAlive(this);
+			break;
 
-					if (ChatPlayer)
-						m_Game->EventPlayerChatToHost(this, ChatPlayer);
+		case CGameProtocol::W3GS_CHAT_TO_HOST:
+			ChatPlayer = m_Protocol->RECEIVE_W3GS_CHAT_TO_HOST(Data);
 
-					delete ChatPlayer;
-					break;
+			if (ChatPlayer)
+				m_Game->EventPlayerChatToHost(this, ChatPlayer);
 
-				case CGameProtocol::W3GS_DROPREQ:
-					if (!m_DropVote)
-					{
-						m_DropVote = true;
-						m_Game->EventPlayerDropRequest(this);
-					}
+			delete ChatPlayer;
+			break;
 
-					break;
+		case CGameProtocol::W3GS_DROPREQ:
+			if (!m_DropVote)
+			{
+				m_DropVote = true;
+				m_Game->EventPlayerDropRequest(this);
+			}
 
-				case CGameProtocol::W3GS_MAPSIZE:
-					MapSize = m_Protocol->RECEIVE_W3GS_MAPSIZE(Data);
+			break;
 
-					if (MapSize)
-						m_Game->EventPlayerMapSize(this, MapSize);
+		case CGameProtocol::W3GS_MAPSIZE:
+			MapSize = m_Protocol->RECEIVE_W3GS_MAPSIZE(Data);
 
-					delete MapSize;
-					break;
+			if (MapSize)
+				m_Game->EventPlayerMapSize(this, MapSize);
 
-				case CGameProtocol::W3GS_PONG_TO_HOST:
-					m_Protocol->RECEIVE_W3GS_PONG_TO_HOST(Data);
-					break;
-				}
+			delete MapSize;
+			break;
 
-				LengthProcessed += Length;
-				Bytes = BYTEARRAY(begin(Bytes) + Length, end(Bytes));
-			}
-			else
-				break;
+		case CGameProtocol::W3GS_PONG_TO_HOST:
+			EventPong(Ticks, m_Protocol->RECEIVE_W3GS_PONG_TO_HOST(Data));
+			break;
 		}
 	}
 
-	*RecvBuffer = RecvBuffer->substr(LengthProcessed);
+	RecvBuffer->Consume(LengthProcessed);
 
 	// try to find out why we're requesting deletion
 
@@ -283,7 +318,74 @@ bool CGamePlayer::Update(uint32_t Ticks, void *fd)
 	return m_DeleteMe || m_Socket->HasError() || !m_Socket->GetConnected();
 }
 
-void CGamePlayer::Send(const BYTEARRAY &data)
+void CGamePlayer::EventPong(uint32_t Ticks, uint32_t Pong)
+{
+	// the pong value is the GetTicks value we sent in the ping so the round trip time is a subtraction
+	// the very first pong value seems to be 1 so discard that one, and anything that doesn't look like one of our pings
+
+	if (Pong == 1 || Ticks - Pong > 60000)
+		return;
+
+	const uint32_t RTT = Ticks - Pong;
+
+	if (m_RTT == 0)
+		m_RTT = RTT;
+	else
+		m_RTT = (m_RTT * 7 + RTT) / 8;
+
+	if (RTT < m_MinRTT)
+		m_MinRTT = RTT;
+}
+
+void CGamePlayer::EventMapPartsSent(uint32_t Ticks)
+{
+	// time one round trip at a time: the first time the data up to m_LastMapPartSent is acknowledged we know how long it took
+	// this includes the time spent in our send queue and in the network buffers so it grows when we send faster than the player's link
+
+	if (m_DownloadProbe == 0)
+	{
+		m_DownloadProbe = m_LastMapPartSent;
+		m_DownloadProbeTicks = Ticks;
+	}
+}
+
+void CGamePlayer::EventMapPartsAcked(uint32_t Ticks, uint32_t Acked)
+{
+	m_LastMapPartAcked = Acked;
+
+	if (m_DownloadProbe == 0 || Acked < m_DownloadProbe)
+		return;
+
+	// adjust the window once per round trip based on how much longer the round trip was than the lowest one we've seen
+	// as long as the extra delay stays under 100 ms the link isn't saturated yet so the window doubles
+	// otherwise the map data is piling up in a queue in front of everything else we send to the player (chat, slot changes, ...) so the window shrinks
+	// this lets a player on a LAN download as fast as their link allows while a player on a slow link only has a small amount of map data queued at a time
+
+	const uint32_t RTT = Ticks - m_DownloadProbeTicks;
+	m_DownloadProbe = 0;
+
+	if (RTT < m_MinRTT)
+		m_MinRTT = RTT;
+
+	if (RTT - m_MinRTT > 100)
+		m_DownloadWindow = std::max<uint32_t>(4 * 1442, m_DownloadWindow / 4 * 3);
+	else
+		m_DownloadWindow = std::min<uint32_t>(1024 * 1442, m_DownloadWindow * 2);
+}
+
+void CGamePlayer::Send(const BYTEVIEW &data)
+{
+	m_Socket->PutBytes(data);
+}
+
+void CGamePlayer::Send(const SHAREDBYTEARRAY &data)
 {
 	m_Socket->PutBytes(data);
 }
+
+void CGamePlayer::Send(const BYTEVIEW &header, const BYTEVIEW &tail)
+{
+	// the tail isn't copied so it has to stay valid until it's been sent
+
+	m_Socket->PutBytes(header, tail);
+}
@@ -22,6 +22,8 @@ CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
 #define AURA_GAMEPLAYER_H_
 
 #include "socket.h"
+#include "timerwheel.h"
+#include "bandwidth.h"
 #include <queue>
 
 class CTCPSocket;
@@ -62,11 +64,12 @@ public:
 
 	// processing functions
 
-	bool Update(void *fd);
+	bool Update();
 
 	// other functions
 
-	void Send(const BYTEARRAY &data) const;
+	void Send(const BYTEVIEW &data) const;
+	void Send(const SHAREDBYTEARRAY &data) const;
 };
 
 //
@@ -90,6 +93,12 @@ private:
 	uint32_t m_SyncCounter;                   // the number of keepalive packets received from this player
 	uint32_t m_LastMapPartSent;               // the last mappart sent to the player (for sending more than one part at a time)
 	uint32_t m_LastMapPartAcked;              // the last mappart acknowledged by the player
+	uint32_t m_DownloadWindow;                // the number of map bytes which may be sent but not yet acknowledged
+	uint32_t m_DownloadProbe;                 // the map offset whose acknowledgement completes the current round trip sample (0 = no sample in progress)
+	uint32_t m_DownloadProbeTicks;            // GetTicks when the map data up to m_DownloadProbe was queued
+	uint32_t m_RTT;                           // the smoothed round trip time in milliseconds from the lobby pings (0 = no pong received yet)
+	uint32_t m_MinRTT;                        // the lowest round trip time seen from pings and map parts, i.e. the round trip time without any queueing
+	CTokenBucket m_DownloadBucket;            // the player's fair share of the map upload budget
 	uint32_t m_StartedLaggingTicks;           // GetTicks when the player started laggin
 	uint8_t m_PID;                            // the player's PID
 	bool m_DownloadStarted;                   // if we've started downloading the map or not
@@ -97,6 +106,7 @@ private:
 	bool m_FinishedLoading;                   // if the player has finished loading or not
 	bool m_Lagging;                           // if the player is lagging or not (on the lag screen)
 	bool m_DropVote;                          // if the player voted to drop the laggers or not (on the lag screen)
+	CTimer m_TimeoutTimer;                    // disconnects the player after 30 seconds without receiving anything
 
 protected:
 	bool m_DeleteMe;
@@ -110,16 +120,20 @@ public:
 	inline std::string GetExternalIPString() const                      { return m_Socket->GetIPString(); }
 	inline bool GetDeleteMe() const                                     { return m_DeleteMe; }
 	inline uint8_t GetPID() const                                       { return m_PID; }
-	inline std::string GetName() const                                  { return m_Name; }
+	inline const std::string &GetName() const                          { return m_Name; }
 	inline uint32_t GetInternalIP() const                               { return m_InternalIP; }
 	inline std::queue<uint32_t> *GetCheckSums()                         { return &m_CheckSums; }
 	inline uint32_t GetLeftCode() const                                 { return m_LeftCode; }
 	inline uint32_t GetSyncCounter() const                              { return m_SyncCounter; }
 	inline uint32_t GetLastMapPartSent() const                          { return m_LastMapPartSent; }
 	inline uint32_t GetLastMapPartAcked() const                         { return m_LastMapPartAcked; }
+	inline uint32_t GetDownloadWindow() const                           { return m_DownloadWindow; }
+	inline uint32_t GetRTT() const                                      { return m_RTT; }
+	inline CTokenBucket &GetDownloadBucket()                            { return m_DownloadBucket; }
 	inline uint32_t GetStartedLaggingTicks() const                      { return m_StartedLaggingTicks; }
 	inline bool GetDownloadStarted() const                              { return m_DownloadStarted; }
 	inline bool GetDownloadFinished() const                             { return m_DownloadFinished; }
+	inline bool GetDownloading() const                                  { return m_DownloadStarted && !m_DownloadFinished; }
 	inline bool GetFinishedLoading() const                              { return m_FinishedLoading; }
 	inline bool GetLagging() const                                      { return m_Lagging; }
 	inline bool GetDropVote() const                                     { return m_DropVote; }
@@ -138,11 +152,17 @@ public:
 
 	// processing functions
 
-	bool Update(uint32_t Ticks, void *fd);
+	bool Update(uint32_t Ticks);
+	void EventTimeoutTimer(uint32_t Ticks);
+	void EventPong(uint32_t Ticks, uint32_t Pong);
+	void EventMapPartsSent(uint32_t Ticks);
+	void EventMapPartsAcked(uint32_t Ticks, uint32_t Acked);
 
 	// other functions
 
-	void Send(const BYTEARRAY &data);
+	void Send(const BYTEVIEW &data);
+	void Send(const SHAREDBYTEARRAY &data);
+	void Send(const BYTEVIEW &header, const BYTEVIEW &tail);
 };
 
 #endif  // AURA_GAMEPLAYER_H_
@@ -19,11 +19,11 @@ CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
 */
 
 #include "gameprotocol.h"
+#include "actionqueue.h"
 #include "util.h"
 #include "crc32.h"
 #include "gameslot.h"
-
-void Print(const std::string &message);
+#include "logging.h"
 
 //
 // CGameProtocol
@@ -43,7 +43,7 @@ CGameProtocol::~CGameProtocol()
 // RECEIVE FUNCTIONS //
 ///////////////////////
 
-CIncomingJoinPlayer *CGameProtocol::RECEIVE_W3GS_REQJOIN(const BYTEARRAY &data)
+CIncomingJoinPlayer *CGameProtocol::RECEIVE_W3GS_REQJOIN(const BYTEVIEW &data)
 {
 	// DEBUG_Print( "RECEIVED W3GS_REQJOIN" );
 	// DEBUG_Print( data );
@@ -76,7 +76,7 @@ CIncomingJoinPlayer *CGameProtocol::RECEIVE_W3GS_REQJOIN(const BYTEARRAY &data)
 	return nullptr;
 }
 
-uint32_t CGameProtocol::RECEIVE_W3GS_LEAVEGAME(const BYTEARRAY &data)
+uint32_t CGameProtocol::RECEIVE_W3GS_LEAVEGAME(const BYTEVIEW &data)
 {
 	// DEBUG_Print( "RECEIVED W3GS_LEAVEGAME" );
 	// DEBUG_Print( data );
@@ -91,7 +91,7 @@ uint32_t CGameProtocol::RECEIVE_W3GS_LEAVEGAME(const BYTEARRAY &data)
 	return 0;
 }
 
-bool CGameProtocol::RECEIVE_W3GS_GAMELOADED_SELF(const BYTEARRAY &data)
+bool CGameProtocol::RECEIVE_W3GS_GAMELOADED_SELF(const BYTEVIEW &data)
 {
 	// DEBUG_Print( "RECEIVED W3GS_GAMELOADED_SELF" );
 	// DEBUG_Print( data );
@@ -105,7 +105,7 @@ bool CGameProtocol::RECEIVE_W3GS_GAMELOADED_SELF(const BYTEARRAY &data)
 	return false;
 }
 
-CIncomingAction *CGameProtocol::RECEIVE_W3GS_OUTGOING_ACTION(const BYTEARRAY &data, uint8_t PID)
+bool CGameProtocol::RECEIVE_W3GS_OUTGOING_ACTION(const BYTEVIEW &data, uint8_t PID, BYTEVIEW &action)
 {
 	// DEBUG_Print( "RECEIVED W3GS_OUTGOING_ACTION" );
 	// DEBUG_Print( data );
@@ -115,17 +115,19 @@ CIncomingAction *CGameProtocol::RECEIVE_W3GS_OUTGOING_ACTION(const BYTEARRAY &da
 	// 4 bytes                -> CRC
 	// remainder of packet		-> Action
 
+	// the action refers to the receive buffer so it has to be copied before the buffer is consumed
+	// the CRC isn't needed for anything
+
 	if (PID != 255 && ValidateLength(data) && data.size() >= 8)
 	{
-		const BYTEARRAY CRC = BYTEARRAY(begin(data) + 4, begin(data) + 8);
-		const BYTEARRAY Action = BYTEARRAY(begin(data) + 8, end(data));
-		return new CIncomingAction(PID, CRC, Action);
+		action = data.substr(8, data.size() - 8);
+		return true;
 	}
 
-	return nullptr;
+	return false;
 }
 
-uint32_t CGameProtocol::RECEIVE_W3GS_OUTGOING_KEEPALIVE(const BYTEARRAY &data)
+uint32_t CGameProtocol::RECEIVE_W3GS_OUTGOING_KEEPALIVE(const BYTEVIEW &data)
 {
 	// DEBUG_Print( "RECEIVED W3GS_OUTGOING_KEEPALIVE" );
 	// DEBUG_Print( data );
@@ -141,7 +143,7 @@ uint32_t CGameProtocol::RECEIVE_W3GS_OUTGOING_KEEPALIVE(const BYTEARRAY &data)
 	return 0;
 }
 
-CIncomingChatPlayer *CGameProtocol::RECEIVE_W3GS_CHAT_TO_HOST(const BYTEARRAY &data)
+CIncomingChatPlayer *CGameProtocol::RECEIVE_W3GS_CHAT_TO_HOST(const BYTEVIEW &data)
 {
 	// DEBUG_Print( "RECEIVED W3GS_CHAT_TO_HOST" );
 	// DEBUG_Print( data );
@@ -208,7 +210,7 @@ CIncomingChatPlayer *CGameProtocol::RECEIVE_W3GS_CHAT_TO_HOST(const BYTEARRAY &d
 	return nullptr;
 }
 
-CIncomingMapSize *CGameProtocol::RECEIVE_W3GS_MAPSIZE(const BYTEARRAY &data)
+CIncomingMapSize *CGameProtocol::RECEIVE_W3GS_MAPSIZE(const BYTEVIEW &data)
 {
 	// DEBUG_Print( "RECEIVED W3GS_MAPSIZE" );
 	// DEBUG_Print( data );
@@ -225,7 +227,7 @@ CIncomingMapSize *CGameProtocol::RECEIVE_W3GS_MAPSIZE(const BYTEARRAY &data)
 	return nullptr;
 }
 
-uint32_t CGameProtocol::RECEIVE_W3GS_PONG_TO_HOST(const BYTEARRAY &data)
+uint32_t CGameProtocol::RECEIVE_W3GS_PONG_TO_HOST(const BYTEVIEW &data)
 {
 	// DEBUG_Print( "RECEIVED W3GS_PONG_TO_HOST" );
 	// DEBUG_Print( data );
@@ -248,157 +250,100 @@ uint32_t CGameProtocol::RECEIVE_W3GS_PONG_TO_HOST(const BYTEARRAY &data)
 // SEND FUNCTIONS //
 ////////////////////
 
-BYTEARRAY CGameProtocol::SEND_W3GS_PING_FROM_HOST(uint32_t ticks)
+CGameProtocol::PING_FROM_HOST::Packet CGameProtocol::SEND_W3GS_PING_FROM_HOST(uint32_t ticks)
 {
-	BYTEARRAY packet = { W3GS_HEADER_CONSTANT, W3GS_PING_FROM_HOST, 8, 0 };
-	AppendByteArray(packet, ticks);    // ping value
-	return packet;
+	return PING_FROM_HOST::Encode(ticks);   // ping value
 }
 
 BYTEARRAY CGameProtocol::SEND_W3GS_SLOTINFOJOIN(uint8_t PID, uint16_t port, uint32_t externalIP, const std::vector<CGameSlot> &slots, uint32_t randomSeed, uint8_t layoutStyle, uint8_t playerSlots)
 {
-	BYTEARRAY packet;
-	const uint8_t Zeros[] = { 0, 0, 0, 0 };
-	const BYTEARRAY SlotInfo = EncodeSlotInfo(slots, randomSeed, layoutStyle, playerSlots);
-	packet.push_back(W3GS_HEADER_CONSTANT);   // W3GS header constant
-	packet.push_back(W3GS_SLOTINFOJOIN);   // W3GS_SLOTINFOJOIN
-	packet.push_back(0);   // packet length will be assigned later
-	packet.push_back(0);   // packet length will be assigned later
-	AppendByteArray(packet, (uint16_t)SlotInfo.size());    // SlotInfo length
-	AppendByteArray(packet, SlotInfo);   // SlotInfo
-	packet.push_back(PID);   // PID
-	packet.push_back(2);   // AF_INET
-	packet.push_back(0);   // AF_INET continued...
-	AppendByteArray(packet, port);   // port
-	AppendByteArray(packet, externalIP);   // external IP
-	AppendByteArray(packet, Zeros, 4);   // ???
-	AppendByteArray(packet, Zeros, 4);   // ???
-	AssignLength(packet);
+	const uint16_t SlotInfoLength = GetSlotInfoLength(slots);
+	BYTEARRAY packet(4 + 2 + SlotInfoLength + 1 + 2 + 2 + 4 + 8);
+	CPacketWriter Writer(packet.data());
+	Writer.WriteHeader(W3GS_HEADER_CONSTANT, W3GS_SLOTINFOJOIN, (uint16_t)packet.size());
+	Writer.Write(SlotInfoLength);   // SlotInfo length
+	WriteSlotInfo(Writer, slots, randomSeed, layoutStyle, playerSlots);   // SlotInfo
+	Writer.Write(PID);   // PID
+	Writer.Write((uint16_t)2);   // AF_INET
+	Writer.Write(port);   // port
+	Writer.Write(externalIP);   // external IP
+	Writer.Write((uint32_t)0);   // ???
+	Writer.Write((uint32_t)0);   // ???
 	return packet;
 }
 
-BYTEARRAY CGameProtocol::SEND_W3GS_REJECTJOIN(uint32_t reason)
+CGameProtocol::REJECTJOIN::Packet CGameProtocol::SEND_W3GS_REJECTJOIN(uint32_t reason)
 {
-	BYTEARRAY packet = { W3GS_HEADER_CONSTANT, W3GS_REJECTJOIN, 8, 0 };
-	AppendByteArray(packet, reason);   // reason
-	return packet;
+	return REJECTJOIN::Encode(reason);   // reason
 }
 
 BYTEARRAY CGameProtocol::SEND_W3GS_PLAYERINFO(uint8_t PID, const std::string &name, uint32_t externalIP, uint32_t internalIP)
 {
-	BYTEARRAY packet;
-
 	if (!name.empty() && name.size() <= 15)
 	{
-		const uint8_t PlayerJoinCounter[] = { 2, 0, 0, 0 };
-		const uint8_t Zeros[] = { 0, 0, 0, 0 };
-
-		packet.push_back(W3GS_HEADER_CONSTANT);   // W3GS header constant
-		packet.push_back(W3GS_PLAYERINFO);   // W3GS_PLAYERINFO
-		packet.push_back(0);   // packet length will be assigned later
-		packet.push_back(0);   // packet length will be assigned later
-		AppendByteArray(packet, PlayerJoinCounter, 4);   // player join counter
-		packet.push_back(PID);   // PID
-		AppendByteArray(packet, name);   // player name
-		packet.push_back(1);   // ???
-		packet.push_back(0);   // ???
-		packet.push_back(2);   // AF_INET
-		packet.push_back(0);   // AF_INET continued...
-		packet.push_back(0);   // port
-		packet.push_back(0);   // port continued...
-		AppendByteArray(packet, externalIP);   // external IP
-		AppendByteArray(packet, Zeros, 4);   // ???
-		AppendByteArray(packet, Zeros, 4);   // ???
-		packet.push_back(2);   // AF_INET
-		packet.push_back(0);   // AF_INET continued...
-		packet.push_back(0);   // port
-		packet.push_back(0);   // port continued...
-		AppendByteArray(packet, internalIP);   // internal IP
-		AppendByteArray(packet, Zeros, 4);   // ???
-		AppendByteArray(packet, Zeros, 4);   // ???
-		AssignLength(packet);
-	}
-	else
-		Print("[GAMEPROTO] invalid parameters passed to SEND_W3GS_PLAYERINFO");
-
-	return packet;
-}
-
-BYTEARRAY CGameProtocol::SEND_W3GS_PLAYERLEAVE_OTHERS(uint8_t PID, uint32_t leftCode)
-{
-	if (PID != 255)
-	{
-		BYTEARRAY packet = { W3GS_HEADER_CONSTANT, W3GS_PLAYERLEAVE_OTHERS, 9, 0, PID };
-		AppendByteArray(packet, leftCode);   // left code (see PLAYERLEAVE_ constants in gameprotocol.h)
+		BYTEARRAY packet(4 + 4 + 1 + name.size() + 1 + 2 + 16 + 16);
+		CPacketWriter Writer(packet.data());
+		Writer.WriteHeader(W3GS_HEADER_CONSTANT, W3GS_PLAYERINFO, (uint16_t)packet.size());
+		Writer.Write((uint32_t)2);   // player join counter
+		Writer.Write(PID);   // PID
+		Writer.Write(name);   // player name
+		Writer.Write((uint8_t)1);   // ???
+		Writer.Write((uint8_t)0);   // ???
+		Writer.Write((uint16_t)2);   // AF_INET
+		Writer.Write((uint16_t)0);   // port
+		Writer.Write(externalIP);   // external IP
+		Writer.Write((uint32_t)0);   // ???
+		Writer.Write((uint32_t)0);   // ???
+		Writer.Write((uint16_t)2);   // AF_INET
+		Writer.Write((uint16_t)0);   // port
+		Writer.Write(internalIP);   // internal IP
+		Writer.Write((uint32_t)0);   // ???
+		Writer.Write((uint32_t)0);   // ???
 		return packet;
 	}
 
-	Print("[GAMEPROTO] invalid parameters passed to SEND_W3GS_PLAYERLEAVE_OTHERS");
+	LOG_WARNING(GAMEPROTO, "[GAMEPROTO] invalid parameters passed to SEND_W3GS_PLAYERINFO");
 	return BYTEARRAY();
 }
 
-BYTEARRAY CGameProtocol::SEND_W3GS_GAMELOADED_OTHERS(uint8_t PID)
+CGameProtocol::PLAYERLEAVE_OTHERS::Packet CGameProtocol::SEND_W3GS_PLAYERLEAVE_OTHERS(uint8_t PID, uint32_t leftCode)
 {
-	if (PID != 255)
-		return BYTEARRAY{ W3GS_HEADER_CONSTANT, W3GS_GAMELOADED_OTHERS, 5, 0, PID };
-
-	Print("[GAMEPROTO] invalid parameters passed to SEND_W3GS_GAMELOADED_OTHERS");
+	return PLAYERLEAVE_OTHERS::Encode(PID, leftCode);   // left code (see PLAYERLEAVE_ constants in gameprotocol.h)
+}
 
-	return BYTEARRAY();
+CGameProtocol::GAMELOADED_OTHERS::Packet CGameProtocol::SEND_W3GS_GAMELOADED_OTHERS(uint8_t PID)
+{
+	return GAMELOADED_OTHERS::Encode(PID);
 }
 
 BYTEARRAY CGameProtocol::SEND_W3GS_SLOTINFO(const std::vector<CGameSlot> &slots, uint32_t randomSeed, uint8_t layoutStyle, uint8_t playerSlots)
 {
-	const BYTEARRAY SlotInfo = EncodeSlotInfo(slots, randomSeed, layoutStyle, playerSlots);
-	const uint16_t SlotInfoSize = (uint16_t)SlotInfo.size();
-
-	BYTEARRAY packet = { W3GS_HEADER_CONSTANT, W3GS_SLOTINFO, 0, 0 };
-	AppendByteArray(packet, SlotInfoSize); // SlotInfo length
-	AppendByteArray(packet, SlotInfo);        // SlotInfo
-	AssignLength(packet);
+	const uint16_t SlotInfoLength = GetSlotInfoLength(slots);
+	BYTEARRAY packet(4 + 2 + SlotInfoLength);
+	CPacketWriter Writer(packet.data());
+	Writer.WriteHeader(W3GS_HEADER_CONSTANT, W3GS_SLOTINFO, (uint16_t)packet.size());
+	Writer.Write(SlotInfoLength);   // SlotInfo length
+	WriteSlotInfo(Writer, slots, randomSeed, layoutStyle, playerSlots);   // SlotInfo
 	return packet;
 }
 
-BYTEARRAY CGameProtocol::SEND_W3GS_COUNTDOWN_START()
+CGameProtocol::COUNTDOWN_START::Packet CGameProtocol::SEND_W3GS_COUNTDOWN_START()
 {
-	return BYTEARRAY{ W3GS_HEADER_CONSTANT, W3GS_COUNTDOWN_START, 4, 0 };
+	return COUNTDOWN_START::Encode();
 }
 
-BYTEARRAY CGameProtocol::SEND_W3GS_COUNTDOWN_END()
+CGameProtocol::COUNTDOWN_END::Packet CGameProtocol::SEND_W3GS_COUNTDOWN_END()
 {
-	return BYTEARRAY{ W3GS_HEADER_CONSTANT, W3GS_COUNTDOWN_END, 4, 0 };
+	return COUNTDOWN_END::Encode();
 }
 
-BYTEARRAY CGameProtocol::SEND_W3GS_INCOMING_ACTION(const std::vector<CIncomingAction *>& actions, uint16_t sendInterval)
+BYTEARRAY CGameProtocol::SEND_W3GS_INCOMING_ACTION(const CActionQueue &actions, uint32_t first, uint32_t last, uint16_t sendInterval)
 {
-	BYTEARRAY packet = { W3GS_HEADER_CONSTANT, W3GS_INCOMING_ACTION, 0, 0 };
-	AppendByteArray(packet, sendInterval);   // send int32_terval
-
-	// create subpacket
-
-	if (!actions.empty())
-	{
-		BYTEARRAY subpacket;
-
-		for (auto& act : actions)
-		{
-			subpacket.push_back(act->GetPID());
-			AppendByteArray(subpacket, (uint16_t)act->GetAction()->size());
-			AppendByteArray(subpacket, *act->GetAction());
-		}
-
-		// calculate crc (we only care about the first 2 bytes though)
-
-		BYTEARRAY crc32 = CreateByteArray(CRC32(subpacket.data(), subpacket.size()));
-		crc32.resize(2);
-
-		// finish subpacket
-
-		AppendByteArray(packet, crc32);   // crc
-		AppendByteArray(packet, subpacket);   // subpacket
-	}
-
-	AssignLength(packet);
+	BYTEARRAY packet(4 + 2 + GetActionsLength(actions, first, last));
+	CPacketWriter Writer(packet.data());
+	Writer.WriteHeader(W3GS_HEADER_CONSTANT, W3GS_INCOMING_ACTION, (uint16_t)packet.size());
+	Writer.Write(sendInterval);   // send interval
+	WriteActions(Writer, actions, first, last);
 	return packet;
 }
 
@@ -406,17 +351,19 @@ BYTEARRAY CGameProtocol::SEND_W3GS_CHAT_FROM_HOST(uint8_t fromPID, const BYTEARR
 {
 	if (!toPIDs.empty() && !message.empty() && message.size() < 255)
 	{
-		BYTEARRAY packet = { W3GS_HEADER_CONSTANT, W3GS_CHAT_FROM_HOST, 0, 0, (uint8_t)toPIDs.size() };
-		AppendByteArray(packet, toPIDs);      // receivers
-		packet.push_back(fromPID);                // sender
-		packet.push_back(flag);                   // flag
-		AppendByteArray(packet, flagExtra);   // extra flag
-		AppendByteArray(packet, message);     // message
-		AssignLength(packet);
+		BYTEARRAY packet(4 + 1 + toPIDs.size() + 2 + 4 + message.size() + 1);
+		CPacketWriter Writer(packet.data());
+		Writer.WriteHeader(W3GS_HEADER_CONSTANT, W3GS_CHAT_FROM_HOST, (uint16_t)packet.size());
+		Writer.Write((uint8_t)toPIDs.size());
+		Writer.Write(toPIDs);      // receivers
+		Writer.Write(fromPID);     // sender
+		Writer.Write(flag);        // flag
+		Writer.Write(flagExtra);   // extra flag
+		Writer.Write(message);     // message
 		return packet;
 	}
 
-	Print("[GAMEPROTO] invalid parameters passed to SEND_W3GS_CHAT_FROM_HOST");
+	LOG_WARNING(GAMEPROTO, "[GAMEPROTO] invalid parameters passed to SEND_W3GS_CHAT_FROM_HOST");
 	return BYTEARRAY();
 }
 
@@ -424,27 +371,27 @@ BYTEARRAY CGameProtocol::SEND_W3GS_START_LAG(const std::vector<std::pair<uint8_t
 {
 	if (!lags.empty())
 	{
-		BYTEARRAY packet = { W3GS_HEADER_CONSTANT, W3GS_START_LAG, 0, 0, (uint8_t)lags.size() };
+		BYTEARRAY packet(4 + 1 + lags.size() * 5);
+		CPacketWriter Writer(packet.data());
+		Writer.WriteHeader(W3GS_HEADER_CONSTANT, W3GS_START_LAG, (uint16_t)packet.size());
+		Writer.Write((uint8_t)lags.size());
 
 		for (auto& lag : lags)
 		{
-			packet.push_back(lag.first);
-			AppendByteArray(packet, lag.second);
+			Writer.Write(lag.first);
+			Writer.Write(lag.second);
 		}
 
-		AssignLength(packet);
 		return packet;
 	}
 
-	Print("[GAMEPROTO] no laggers passed to SEND_W3GS_START_LAG");
+	LOG_WARNING(GAMEPROTO, "[GAMEPROTO] no laggers passed to SEND_W3GS_START_LAG");
 	return BYTEARRAY();
 }
 
-BYTEARRAY CGameProtocol::SEND_W3GS_STOP_LAG(uint8_t pid, uint32_t time)
+CGameProtocol::STOP_LAG::Packet CGameProtocol::SEND_W3GS_STOP_LAG(uint8_t pid, uint32_t time)
 {
-	BYTEARRAY packet = { W3GS_HEADER_CONSTANT, W3GS_STOP_LAG, 9, 0, pid };
-	AppendByteArray(packet, time);
-	return packet;
+	return STOP_LAG::Encode(pid, time);
 }
 
 BYTEARRAY CGameProtocol::SEND_W3GS_GAMEINFO(uint8_t war3Version, uint32_t mapGameType, uint32_t mapFlags, uint16_t mapWidth, uint16_t mapHeight, const std::string &gameName, const std::string &hostName, uint32_t upTime, const std::string &mapPath, uint32_t mapCRC, uint32_t slotsTotal, uint32_t slotsOpen, uint16_t port, uint32_t hostCounter, uint32_t entryKey)
@@ -485,7 +432,7 @@ BYTEARRAY CGameProtocol::SEND_W3GS_GAMEINFO(uint8_t war3Version, uint32_t mapGam
 		return packet;
 	}
 
-	Print("[GAMEPROTO] invalid parameters passed to SEND_W3GS_GAMEINFO");
+	LOG_WARNING(GAMEPROTO, "[GAMEPROTO] invalid parameters passed to SEND_W3GS_GAMEINFO");
 	return BYTEARRAY();
 }
 
@@ -521,111 +468,136 @@ BYTEARRAY CGameProtocol::SEND_W3GS_MAPCHECK(const std::string &mapPath, uint32_t
 		return packet;
 	}
 
-	Print("[GAMEPROTO] invalid parameters passed to SEND_W3GS_MAPCHECK");
+	LOG_WARNING(GAMEPROTO, "[GAMEPROTO] invalid parameters passed to SEND_W3GS_MAPCHECK");
 	return BYTEARRAY();
 }
 
-BYTEARRAY CGameProtocol::SEND_W3GS_STARTDOWNLOAD(uint8_t fromPID)
+CGameProtocol::STARTDOWNLOAD::Packet CGameProtocol::SEND_W3GS_STARTDOWNLOAD(uint8_t fromPID)
 {
-	return BYTEARRAY{ W3GS_HEADER_CONSTANT, W3GS_STARTDOWNLOAD, 9, 0, 1, 0, 0, 0, fromPID };
+	return STARTDOWNLOAD::Encode(1, fromPID);
 }
 
-BYTEARRAY CGameProtocol::SEND_W3GS_MAPPART(uint8_t fromPID, uint8_t toPID, uint32_t start, const std::string *mapData)
+CGameProtocol::MAPPART_HEADER CGameProtocol::SEND_W3GS_MAPPART_HEADER(uint8_t fromPID, uint8_t toPID, uint32_t start, uint32_t partLength, uint32_t partCRC)
 {
-	if (start < mapData->size())
-	{
-		BYTEARRAY packet = { W3GS_HEADER_CONSTANT, W3GS_MAPPART, 0, 0, toPID, fromPID, 1, 0, 0, 0 };
-		AppendByteArray(packet, start);   // start position
+	// this is only the start of the packet, the part of the map data (no more than 1442 bytes) follows it on the wire
+	// the part isn't copied into the packet, it's sent straight from the mapped map file (see CSendQueue)
 
-		// calculate end position (don't send more than 1442 map bytes in one packet)
+	MAPPART_HEADER header;
+	CPacketWriter Writer(header.data());
+	Writer.WriteHeader(W3GS_HEADER_CONSTANT, W3GS_MAPPART, (uint16_t)(header.size() + partLength));
+	Writer.Write(toPID);
+	Writer.Write(fromPID);
+	Writer.Write((uint32_t)1);
+	Writer.Write(start);     // start position
+	Writer.Write(partCRC);   // crc
+	return header;
+}
 
-		uint32_t End = start + 1442;
+BYTEARRAY CGameProtocol::SEND_W3GS_INCOMING_ACTION2(const CActionQueue &actions, uint32_t first, uint32_t last)
+{
+	BYTEARRAY packet(4 + 2 + GetActionsLength(actions, first, last));
+	CPacketWriter Writer(packet.data());
+	Writer.WriteHeader(W3GS_HEADER_CONSTANT, W3GS_INCOMING_ACTION2, (uint16_t)packet.size());
+	Writer.Write((uint16_t)0);
+	WriteActions(Writer, actions, first, last);
+	return packet;
+}
 
-		if (End > mapData->size())
-			End = mapData->size();
+/////////////////////
+// OTHER FUNCTIONS //
+/////////////////////
 
-		// calculate crc
+uint32_t CGameProtocol::GetActionsLength(const CActionQueue &actions, uint32_t first, uint32_t last)
+{
+	if (first == last)
+		return 0;
 
-		const BYTEARRAY crc32 = CreateByteArray(CRC32((const uint8_t*)mapData->c_str() + start, End - start));
-		AppendByteArray(packet, crc32);
+	// the 2 byte crc followed by the subpacket
 
-		// map data
+	uint32_t Length = 2;
 
-		const BYTEARRAY data = CreateByteArray((const uint8_t *)mapData->c_str() + start, End - start);
-		AppendByteArray(packet, data);
-		AssignLength(packet);
-		return packet;
-	}
+	for (uint32_t i = first; i < last; ++i)
+		Length += CActionQueue::GetEncodedLength(actions.GetAction(i));
 
-	Print("[GAMEPROTO] invalid parameters passed to SEND_W3GS_MAPPART");
-	return BYTEARRAY();
+	return Length;
 }
 
-BYTEARRAY CGameProtocol::SEND_W3GS_INCOMING_ACTION2(const std::vector<CIncomingAction *>& actions)
+void CGameProtocol::WriteActions(CPacketWriter &writer, const CActionQueue &actions, uint32_t first, uint32_t last)
 {
-	BYTEARRAY packet = { W3GS_HEADER_CONSTANT, W3GS_INCOMING_ACTION2, 0, 0, 0, 0 };
+	if (first == last)
+		return;
 
-	// create subpacket
+	// the subpacket is encoded straight from the action queue after the 2 byte crc
+	// then the crc is filled in (we only care about the first 2 bytes of it though)
 
-	if (!actions.empty())
+	CPacketWriter CRCWriter(writer.GetData() + writer.GetLength());
+	writer.Write((uint16_t)0);
+
+	const uint8_t *SubPacket = writer.GetData() + writer.GetLength();
+
+	for (uint32_t i = first; i < last; ++i)
 	{
-		BYTEARRAY subpacket;
+		const CActionQueue::CAction &Action = actions.GetAction(i);
+		writer.Write(Action.PID);
+		writer.Write(Action.Length);
+		writer.Write(actions.GetPayload(Action));
+	}
 
-		for (auto& act : actions)
-		{
-			subpacket.push_back(act->GetPID());
-			AppendByteArray(subpacket, (uint16_t)act->GetAction()->size());
-			AppendByteArray(subpacket, *act->GetAction());
-		}
+	CRCWriter.Write((uint16_t)hash::crc32(SubPacket, writer.GetData() + writer.GetLength() - SubPacket));
+}
 
-		// calculate crc (we only care about the first 2 bytes though)
+int32_t CGameProtocol::FramePacket(const BYTEVIEW &buffer)
+{
+	// 1 byte                 -> Header (W3GS_HEADER_CONSTANT)
+	// 1 byte                 -> ID
+	// 2 bytes                -> Length (including these 4 bytes)
 
-		BYTEARRAY crc32 = CreateByteArray(CRC32(subpacket.data(), subpacket.size()));
-		crc32.resize(2);
+	if (buffer.size() < 4)
+		return 0;
 
-		// finish subpacket
+	const uint16_t Length = ByteArrayToUInt16(buffer, 2);
 
-		AppendByteArray(packet, crc32);     // crc
-		AppendByteArray(packet, subpacket); // subpacket
-	}
+	if (buffer[0] != W3GS_HEADER_CONSTANT || Length < 4)
+		return -1;
 
-	AssignLength(packet);
-	return packet;
-}
+	if (buffer.size() < Length)
+		return 0;
 
-/////////////////////
-// OTHER FUNCTIONS //
-/////////////////////
+	return Length;
+}
 
-bool CGameProtocol::ValidateLength(const BYTEARRAY &content)
+bool CGameProtocol::ValidateLength(const BYTEVIEW &content)
 {
 	// verify that bytes 3 and 4 (indices 2 and 3) of the content array describe the length
 
 	return ((uint16_t)(content[3] << 8 | content[2]) == content.size());
 }
 
-BYTEARRAY CGameProtocol::EncodeSlotInfo(const std::vector<CGameSlot> &slots, uint32_t randomSeed, uint8_t layoutStyle, uint8_t playerSlots)
+uint16_t CGameProtocol::GetSlotInfoLength(const std::vector<CGameSlot> &slots)
 {
-	BYTEARRAY SlotInfo;
-	SlotInfo.push_back((uint8_t)slots.size()); // number of slots
+	return (uint16_t)(1 + slots.size() * 9 + 4 + 1 + 1);
+}
+
+void CGameProtocol::WriteSlotInfo(CPacketWriter &writer, const std::vector<CGameSlot> &slots, uint32_t randomSeed, uint8_t layoutStyle, uint8_t playerSlots)
+{
+	writer.Write((uint8_t)slots.size()); // number of slots
 
 	for (auto & slot : slots)
 	{
-		AppendByteArray(SlotInfo, slot.GetPID());
-		AppendByteArray(SlotInfo, slot.GetDownloadStatus());
-		AppendByteArray(SlotInfo, slot.GetSlotStatus());
-		AppendByteArray(SlotInfo, slot.GetComputer());
-		AppendByteArray(SlotInfo, slot.GetTeam());
-		AppendByteArray(SlotInfo, slot.GetColour());
-		AppendByteArray(SlotInfo, slot.GetRace());
-		AppendByteArray(SlotInfo, slot.GetComputerType());
-		AppendByteArray(SlotInfo, slot.GetHandicap());
+		writer.Write(slot.GetPID());
+		writer.Write(slot.GetDownloadStatus());
+		writer.Write(slot.GetSlotStatus());
+		writer.Write(slot.GetComputer());
+		writer.Write(slot.GetTeam());
+		writer.Write(slot.GetColour());
+		writer.Write(slot.GetRace());
+		writer.Write(slot.GetComputerType());
+		writer.Write(slot.GetHandicap());
 	}
 
-	AppendByteArray(SlotInfo, randomSeed);     // random seed
-	SlotInfo.push_back(layoutStyle);                  // LayoutStyle (0 = melee, 1 = custom forces, 3 = custom forces + fixed player settings)
-	SlotInfo.push_back(playerSlots);                  // number of player slots (non observer)
-	return SlotInfo;
+	writer.Write(randomSeed);     // random seed
+	writer.Write(layoutStyle);    // LayoutStyle (0 = melee, 1 = custom forces, 3 = custom forces + fixed player settings)
+	writer.Write(playerSlots);    // number of player slots (non observer)
 }
 
 //
@@ -646,23 +618,6 @@ CIncomingJoinPlayer::~CIncomingJoinPlayer()
 
 }
 
-//
-// CIncomingAction
-//
-
-CIncomingAction::CIncomingAction(uint8_t nPID, const BYTEARRAY &nCRC, const BYTEARRAY &nAction)
-	: m_CRC(nCRC),
-	m_Action(nAction),
-	m_PID(nPID)
-{
-
-}
-
-CIncomingAction::~CIncomingAction()
-{
-
-}
-
 //
 // CIncomingChatPlayer
 //
@@ -21,10 +21,14 @@ CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
 #ifndef AURA_GAMEPROTOCOL_H_
 #define AURA_GAMEPROTOCOL_H_
 
+#include "packetwriter.h"
+#include "util.h"
+
 #include <array>
 #include <queue>
+#include <string>
+#include <vector>
 #include <stdint.h>
-typedef std::vector<uint8_t> BYTEARRAY;
 
 //
 // CGameProtocol
@@ -48,7 +52,7 @@ typedef std::vector<uint8_t> BYTEARRAY;
 #define REJECTJOIN_WRONGPASSWORD   27
 
 class CIncomingJoinPlayer;
-class CIncomingAction;
+class CActionQueue;
 class CIncomingChatPlayer;
 class CIncomingMapSize;
 class CGameSlot;
@@ -96,49 +100,71 @@ public:
 		W3GS_INCOMING_ACTION2 = 72  // 0x48 - received this packet when there are too many actions to fit in W3GS_INCOMING_ACTION
 	};
 
+	// the fixed size packets, these are encoded on the stack (see CPacketLayout)
+
+	typedef CPacketLayout<W3GS_HEADER_CONSTANT, W3GS_PING_FROM_HOST, uint32_t> PING_FROM_HOST;
+	typedef CPacketLayout<W3GS_HEADER_CONSTANT, W3GS_REJECTJOIN, uint32_t> REJECTJOIN;
+	typedef CPacketLayout<W3GS_HEADER_CONSTANT, W3GS_PLAYERLEAVE_OTHERS, uint8_t, uint32_t> PLAYERLEAVE_OTHERS;
+	typedef CPacketLayout<W3GS_HEADER_CONSTANT, W3GS_GAMELOADED_OTHERS, uint8_t> GAMELOADED_OTHERS;
+	typedef CPacketLayout<W3GS_HEADER_CONSTANT, W3GS_COUNTDOWN_START> COUNTDOWN_START;
+	typedef CPacketLayout<W3GS_HEADER_CONSTANT, W3GS_COUNTDOWN_END> COUNTDOWN_END;
+	typedef CPacketLayout<W3GS_HEADER_CONSTANT, W3GS_STOP_LAG, uint8_t, uint32_t> STOP_LAG;
+	typedef CPacketLayout<W3GS_HEADER_CONSTANT, W3GS_STARTDOWNLOAD, uint32_t, uint8_t> STARTDOWNLOAD;
+	typedef std::array<uint8_t, 18> MAPPART_HEADER;
+
 	explicit CGameProtocol();
 	~CGameProtocol();
 
 	// receive functions
+	// the data is a view of a single complete packet (see FramePacket), the handlers copy whatever they want to keep
 
-	CIncomingJoinPlayer *RECEIVE_W3GS_REQJOIN(const BYTEARRAY &data);
-	uint32_t RECEIVE_W3GS_LEAVEGAME(const BYTEARRAY &data);
-	bool RECEIVE_W3GS_GAMELOADED_SELF(const BYTEARRAY &data);
-	CIncomingAction *RECEIVE_W3GS_OUTGOING_ACTION(const BYTEARRAY &data, uint8_t PID);
-	uint32_t RECEIVE_W3GS_OUTGOING_KEEPALIVE(const BYTEARRAY &data);
-	CIncomingChatPlayer *RECEIVE_W3GS_CHAT_TO_HOST(const BYTEARRAY &data);
-	CIncomingMapSize *RECEIVE_W3GS_MAPSIZE(const BYTEARRAY &data);
-	uint32_t RECEIVE_W3GS_PONG_TO_HOST(const BYTEARRAY &data);
+	CIncomingJoinPlayer *RECEIVE_W3GS_REQJOIN(const BYTEVIEW &data);
+	uint32_t RECEIVE_W3GS_LEAVEGAME(const BYTEVIEW &data);
+	bool RECEIVE_W3GS_GAMELOADED_SELF(const BYTEVIEW &data);
+	bool RECEIVE_W3GS_OUTGOING_ACTION(const BYTEVIEW &data, uint8_t PID, BYTEVIEW &action);
+	uint32_t RECEIVE_W3GS_OUTGOING_KEEPALIVE(const BYTEVIEW &data);
+	CIncomingChatPlayer *RECEIVE_W3GS_CHAT_TO_HOST(const BYTEVIEW &data);
+	CIncomingMapSize *RECEIVE_W3GS_MAPSIZE(const BYTEVIEW &data);
+	uint32_t RECEIVE_W3GS_PONG_TO_HOST(const BYTEVIEW &data);
 
 	// send functions
 
-	BYTEARRAY SEND_W3GS_PING_FROM_HOST(uint32_t ticks);
+	PING_FROM_HOST::Packet SEND_W3GS_PING_FROM_HOST(uint32_t ticks);
 	BYTEARRAY SEND_W3GS_SLOTINFOJOIN(uint8_t PID, uint16_t port, uint32_t externalIP, const std::vector<CGameSlot> &slots, uint32_t randomSeed, uint8_t layoutStyle, uint8_t playerSlots);
-	BYTEARRAY SEND_W3GS_REJECTJOIN(uint32_t reason);
+	REJECTJOIN::Packet SEND_W3GS_REJECTJOIN(uint32_t reason);
 	BYTEARRAY SEND_W3GS_PLAYERINFO(uint8_t PID, const std::string &name, uint32_t externalIP, uint32_t internalIP);
-	BYTEARRAY SEND_W3GS_PLAYERLEAVE_OTHERS(uint8_t PID, uint32_t leftCode);
-	BYTEARRAY SEND_W3GS_GAMELOADED_OTHERS(uint8_t PID);
+	PLAYERLEAVE_OTHERS::Packet SEND_W3GS_PLAYERLEAVE_OTHERS(uint8_t PID, uint32_t leftCode);
+	GAMELOADED_OTHERS::Packet SEND_W3GS_GAMELOADED_OTHERS(uint8_t PID);
 	BYTEARRAY SEND_W3GS_SLOTINFO(const std::vector<CGameSlot> &slots, uint32_t randomSeed, uint8_t layoutStyle, uint8_t playerSlots);
-	BYTEARRAY SEND_W3GS_COUNTDOWN_START();
-	BYTEARRAY SEND_W3GS_COUNTDOWN_END();
-	BYTEARRAY SEND_W3GS_INCOMING_ACTION(const std::vector<CIncomingAction *>& actions, uint16_t sendInterval);
-	BYTEARRAY SEND_W3GS_INCOMING_ACTION2(const std::vector<CIncomingAction *>& actions);
+	COUNTDOWN_START::Packet SEND_W3GS_COUNTDOWN_START();
+	COUNTDOWN_END::Packet SEND_W3GS_COUNTDOWN_END();
+	BYTEARRAY SEND_W3GS_INCOMING_ACTION(const CActionQueue &actions, uint32_t first, uint32_t last, uint16_t sendInterval);
+	BYTEARRAY SEND_W3GS_INCOMING_ACTION2(const CActionQueue &actions, uint32_t first, uint32_t last);
 	BYTEARRAY SEND_W3GS_CHAT_FROM_HOST(uint8_t fromPID, const BYTEARRAY &toPIDs, uint8_t flag, uint32_t flagExtra, const std::string &message);
 	BYTEARRAY SEND_W3GS_START_LAG(const std::vector<std::pair<uint8_t, uint32_t>>& lags);
-	BYTEARRAY SEND_W3GS_STOP_LAG(uint8_t pid, uint32_t time);
+	STOP_LAG::Packet SEND_W3GS_STOP_LAG(uint8_t pid, uint32_t time);
 	BYTEARRAY SEND_W3GS_GAMEINFO(uint8_t war3Version, uint32_t mapGameType, uint32_t mapFlags, uint16_t mapWidth, uint16_t mapHeight, const std::string &gameName, const std::string &hostName, uint32_t upTime, const std::string &mapPath, uint32_t mapCRC, uint32_t slotsTotal, uint32_t slotsOpen, uint16_t port, uint32_t hostCounter, uint32_t entryKey);
 	BYTEARRAY SEND_W3GS_CREATEGAME(uint8_t war3Version);
 	BYTEARRAY SEND_W3GS_REFRESHGAME(uint32_t players, uint32_t playerSlots);
 	BYTEARRAY SEND_W3GS_DECREATEGAME();
 	BYTEARRAY SEND_W3GS_MAPCHECK(const std::string &mapPath, uint32_t mapSize, uint32_t mapInfo, uint32_t mapCRC, const std::array<uint8_t, 20>& mapSHA1);
-	BYTEARRAY SEND_W3GS_STARTDOWNLOAD(uint8_t fromPID);
-	BYTEARRAY SEND_W3GS_MAPPART(uint8_t fromPID, uint8_t toPID, uint32_t start, const std::string *mapData);
+	STARTDOWNLOAD::Packet SEND_W3GS_STARTDOWNLOAD(uint8_t fromPID);
+	MAPPART_HEADER SEND_W3GS_MAPPART_HEADER(uint8_t fromPID, uint8_t toPID, uint32_t start, uint32_t partLength, uint32_t partCRC);
 
 	// other functions
 
+	// find the W3GS packet at the front of a receive buffer
+	// returns its length if the buffer holds the complete packet, zero if more data is needed
+	// and -1 if the data isn't a W3GS packet at all (the stream can't be resynchronised so the connection has to be dropped)
+
+	static int32_t FramePacket(const BYTEVIEW &buffer);
+
 private:
-	bool ValidateLength(const BYTEARRAY &content);
-	BYTEARRAY EncodeSlotInfo(const std::vector<CGameSlot> &slots, uint32_t randomSeed, uint8_t layoutStyle, uint8_t playerSlots);
+	bool ValidateLength(const BYTEVIEW &content);
+	uint16_t GetSlotInfoLength(const std::vector<CGameSlot> &slots);
+	void WriteSlotInfo(CPacketWriter &writer, const std::vector<CGameSlot> &slots, uint32_t randomSeed, uint8_t layoutStyle, uint8_t playerSlots);
+	uint32_t GetActionsLength(const CActionQueue &actions, uint32_t first, uint32_t last);
+	void WriteActions(CPacketWriter &writer, const CActionQueue &actions, uint32_t first, uint32_t last);
 };
 
 //
@@ -159,31 +185,10 @@ public:
 
 	inline uint32_t GetHostCounter() const                     { return m_HostCounter; }
 	inline uint32_t GetEntryKey() const                        { return m_EntryKey; }
-	inline std::string GetName() const                         { return m_Name; }
+	inline const std::string &GetName() const                 { return m_Name; }
 	inline uint32_t GetInternalIP() const                      { return m_InternalIP; }
 };
 
-//
-// CIncomingAction
-//
-
-class CIncomingAction
-{
-private:
-	BYTEARRAY m_CRC;
-	BYTEARRAY m_Action;
-	uint8_t m_PID;
-
-public:
-	CIncomingAction(uint8_t nPID, const BYTEARRAY &nCRC, const BYTEARRAY &nAction);
-	~CIncomingAction();
-
-	inline uint8_t GetPID() const                              { return m_PID; }
-	inline BYTEARRAY GetCRC() const                            { return m_CRC; }
-	inline BYTEARRAY *GetAction()                              { return &m_Action; }
-	inline uint32_t GetLength() const                          { return m_Action.size() + 3; }
-};
-
 //
 // CIncomingChatPlayer
 //
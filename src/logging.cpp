@@ -12,10 +12,18 @@
 #endif
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <time.h>
 #include <string.h>
 #include <stdint.h>
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <iterator>
+#include <mutex>
+#include <thread>
+
 namespace logging {
 
 	namespace date {
@@ -68,20 +76,23 @@ namespace logging {
 #endif
 		}
 
-		struct tm now(long* usec = 0)
+		// microseconds since the epoch
+		int64_t now_usec()
 		{
-			struct tm tm_now;
 			struct timeval tv;
 			gettimeofday(&tv, 0);
-			time_t now = tv.tv_sec;
-			localtime(&now, &tm_now);
-			if (usec) *usec = tv.tv_usec;
-			return tm_now;
+			return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
 		}
 
-		int now_day()
+		struct tm at(time_t t)
+		{
+			struct tm tm_at;
+			localtime(&t, &tm_at);
+			return tm_at;
+		}
+
+		int day(const struct tm& t)
 		{
-			struct tm t = now();
 			return 10000 * (t.tm_year + 1900) + 100 * (t.tm_mon + 1) + t.tm_mday;
 		}
 	}
@@ -92,89 +103,450 @@ namespace logging {
 	const char separator = '/';
 #endif
 
-	class auto_logger_file
-	{
-	public:
-		auto_logger_file() { }
-		~auto_logger_file() { flush(); }
-		std::ostringstream& stream() { return m_oss; }
+	namespace {
+		// the queue is a bounded array of fixed size slots shared by any number of producers and the writer thread (Dmitry Vyukov's bounded queue)
+		// a producer claims a slot by advancing the tail with a CAS, fills it and then publishes it through the slot's sequence number
+		// nothing is allocated and nothing waits, when every slot is in use the line is dropped and counted instead
+		const size_t QUEUE_SLOTS = 2048;               // must be a power of two
+
+		struct slot
+		{
+			std::atomic<size_t> seq;                   // == position when free, position + 1 once filled
+			int64_t time;                              // when the line was queued, in microseconds since the epoch
+			const char* format;
+			uint16_t length;                           // the length of args
+			level lvl;
+			tag tg;
+			char args[detail::ARGS_SIZE];              // packed by detail::packer
+		};
+
+		class log_queue
+		{
+		public:
+			log_queue()
+				: m_tail(0)
+				, m_head(0)
+				, m_dropped(0)
+				, m_sleeping(false)
+				, m_stop(false)
+			{
+				for (size_t i = 0; i < QUEUE_SLOTS; ++i)
+					m_slots[i].seq.store(i, std::memory_order_relaxed);
+			}
+
+			bool push(level l, tag t, const char* format, const char* args, size_t length)
+			{
+				const int64_t time = date::now_usec();
+				size_t pos = m_tail.load(std::memory_order_relaxed);
+				slot* s;
+
+				for (;;)
+				{
+					s = &m_slots[pos & (QUEUE_SLOTS - 1)];
+					const intptr_t diff = (intptr_t)s->seq.load(std::memory_order_acquire) - (intptr_t)pos;
+
+					if (diff == 0)
+					{
+						if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+							break;
+					}
+					else if (diff < 0)
+					{
+						// the writer hasn't caught up with the slot from the last lap yet
+
+						m_dropped.fetch_add(1, std::memory_order_relaxed);
+						return false;
+					}
+					else
+						pos = m_tail.load(std::memory_order_relaxed);
+				}
+
+				s->time = time;
+				s->format = format;
+				s->lvl = l;
+				s->tg = t;
+				s->length = (uint16_t)length;
+				memcpy(s->args, args, length);
+				s->seq.store(pos + 1, std::memory_order_release);
+
+				// only the first line after the writer went idle has to wake it up
+				// the fence pairs with the one in wait: either the writer sees this line or we see that it's going to sleep
+				// the notify is sent under the mutex so it can't fall between the writer checking the queue and starting to wait
+
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+
+				if (m_sleeping.load(std::memory_order_relaxed) && m_sleeping.exchange(false))
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_wake.notify_one();
+				}
+
+				return true;
+			}
+
+			// the filled slot at the front or null, release it with pop once it's been read
+
+			const slot* front() const
+			{
+				const slot* s = &m_slots[m_head & (QUEUE_SLOTS - 1)];
+				return s->seq.load(std::memory_order_acquire) == m_head + 1 ? s : nullptr;
+			}
+
+			void pop()
+			{
+				m_slots[m_head & (QUEUE_SLOTS - 1)].seq.store(m_head + QUEUE_SLOTS, std::memory_order_release);
+				++m_head;
+			}
+
+			// block the writer until a line is queued or stop is called
 
-		void flush()
+			void wait()
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_sleeping.store(true, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+
+				while (!front() && !m_stop.load())
+					m_wake.wait(lock);
+
+				m_sleeping.store(false, std::memory_order_relaxed);
+			}
+
+			void stop()
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_stop.store(true);
+				m_wake.notify_one();
+			}
+
+			bool stopping() const                 { return m_stop.load(); }
+			uint64_t dropped() const              { return m_dropped.load(std::memory_order_relaxed); }
+
+		private:
+			slot m_slots[QUEUE_SLOTS];
+			std::atomic<size_t> m_tail;                // the next position a producer claims
+			size_t m_head;                             // the next position the writer reads, only the writer touches it
+			std::atomic<uint64_t> m_dropped;
+			std::atomic<bool> m_sleeping;
+			std::atomic<bool> m_stop;
+			std::mutex m_mutex;
+			std::condition_variable m_wake;
+		};
+
+		log_queue queue;
+
+		// the writer thread: drains the queue in batches and writes each batch to the console and the log file with one call each
+		// the log file stays open until the day changes
+
+		class log_writer
 		{
-			rotate("ydhost.log");
-			std::string tmp = m_oss.str();
-			m_oss.str("");
-			if (!tmp.empty())
+		public:
+			log_writer()
+				: m_file(nullptr)
+				, m_day(0)
+				, m_second(-1)
+				, m_reported(0)
+			{ }
+
+			log_writer(const log_writer&) = delete;
+
+			~log_writer()
+			{
+				if (m_file)
+					fclose(m_file);
+			}
+
+			void run()
 			{
-				FILE *f = fopen(m_last_filename.c_str(), "a");
-				if (f)
+				for (;;)
 				{
-#ifdef _WIN32
-					fputs(tmp.c_str(), f);
+					const bool stopping = queue.stopping();
+
+					for (const slot* s; (s = queue.front()) != nullptr; queue.pop())
+					{
+						format(s->format, s->args, s->length);
+						add(s->time, s->lvl, m_line);
+					}
+
+					const uint64_t dropped = queue.dropped();
+
+					if (dropped != m_reported)
+					{
+						if (enabled(LEVEL_WARNING, TAG_LOG))
+							add(date::now_usec(), LEVEL_WARNING, "[LOG] dropped " + std::to_string(dropped - m_reported) + " lines, the log queue was full");
+
+						m_reported = dropped;
+					}
+
+					flush();
+
+					if (stopping)
+						return;
+
+					queue.wait();
+				}
+			}
+
+		private:
+			// replace each {} in format with the next packed argument
+			// every read is checked against the end of the slot, a damaged argument ends the decoding and the rest of the {} are kept as they are
+
+			void format(const char* fmt, const char* args, size_t length)
+			{
+				const char* end = args + length;
+				m_line.clear();
+
+				for (const char* p = fmt; *p; ++p)
+				{
+					if (p[0] != '{' || p[1] != '}' || args == end)
+					{
+						m_line += *p;
+						continue;
+					}
+
+					const detail::arg_type type = (detail::arg_type)*args;
+					const size_t left = end - args - 1;
+					size_t size = 0;
+
+					if (type == detail::ARG_STRING)
+					{
+						uint16_t string_size = 0;
+						if (left >= 2)
+							memcpy(&string_size, args + 1, 2);
+						size = 2 + (size_t)string_size;
+					}
+					else if (type == detail::ARG_IPV4)
+						size = 4;
+					else if (type == detail::ARG_INT || type == detail::ARG_UINT || type == detail::ARG_DOUBLE)
+						size = 8;
+
+					if (size == 0 || size > left)
+					{
+						args = end;
+						m_line += *p;
+						continue;
+					}
+
+					++p;
+					++args;
+
+					if (type == detail::ARG_STRING)
+					{
+						m_line.append(args + 2, size - 2);
+					}
+					else if (type == detail::ARG_IPV4)
+					{
+						uint8_t ip[4];
+						memcpy(ip, args, 4);
+						char text[16];
+						sprintf(text, "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+						m_line += text;
+					}
+					else
+					{
+						// the 64 bit values
+
+						char text[64];
+
+						if (type == detail::ARG_INT)
+						{
+							int64_t v;
+							memcpy(&v, args, 8);
+							sprintf(text, "%lld", (long long)v);
+						}
+						else if (type == detail::ARG_UINT)
+						{
+							uint64_t v;
+							memcpy(&v, args, 8);
+							sprintf(text, "%llu", (unsigned long long)v);
+						}
+						else
+						{
+							double v;
+							memcpy(&v, args, 8);
+							snprintf(text, sizeof(text), "%f", v);
+						}
+
+						m_line += text;
+					}
+
+					args += size;
+				}
+			}
+
+			void add(int64_t time, level l, const std::string& line)
+			{
+				const time_t second = (time_t)(time / 1000000);
+
+				if (second != m_second)
+				{
+					// a new second, so there's a new timestamp prefix and maybe a new day
+
+					const struct tm t = date::at(second);
+					sprintf(m_stamp, "%04d-%02d-%02d %02d:%02d:%02d", t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec);
+					m_second = second;
+
+					if (date::day(t) != m_day)
+					{
+						flush();
+						rotate("ydhost.log", t);
+						m_day = date::day(t);
+					}
+				}
+
+				static const char letters[] = { 'D', 'I', 'W', 'E' };
+				char msec[16];
+				sprintf(msec, ".%03d %c ", (int)(time / 1000 % 1000), letters[l]);
+
+				m_console += line;
+				m_console += '\n';
+				m_text += m_stamp;
+				m_text += msec;
+				m_text += line;
+				m_text += '\n';
+			}
+
+			void flush()
+			{
+				if (!m_console.empty())
+				{
+					fwrite(m_console.data(), 1, m_console.size(), stdout);
+					fflush(stdout);
+					m_console.clear();
+				}
+
+				if (!m_text.empty())
+				{
+					if (m_file)
+					{
+#ifndef WIN32
+						// other hosts running from the same directory write to the same file
+
+						const int fd = fileno(m_file);
+						lockf(fd, F_LOCK, 0l);
+						fwrite(m_text.data(), 1, m_text.size(), m_file);
+						fflush(m_file);
+						lockf(fd, F_ULOCK, 0l);
 #else
-					int fd = fileno(f);
-					lockf(fd, F_LOCK, 0l);
-					fputs(tmp.c_str(), f);
-					lockf(fd, F_ULOCK, 0l);
+						fwrite(m_text.data(), 1, m_text.size(), m_file);
+						fflush(m_file);
 #endif
-					fclose(f);
+					}
+
+					m_text.clear();
 				}
 			}
-		}
 
-		void rotate(const std::string& log_name)
-		{
-			if (m_last_day != date::now_day())
+			void rotate(const std::string& log_name, const struct tm& t)
 			{
-				m_last_day = date::now_day();
-				m_last_filename = make_filename(log_name);
+				if (m_file)
+					fclose(m_file);
+
+				m_file = fopen(make_filename(log_name, t).c_str(), "a");
 			}
-		}
 
-		std::string make_filename(const std::string &p) const
-		{
-			char cwd[260] = { 0 };
+			std::string make_filename(const std::string &p, const struct tm& t) const
+			{
+				char cwd[260] = { 0 };
 #ifdef WIN32
-			_getcwd(cwd, sizeof(cwd));
+				_getcwd(cwd, sizeof(cwd));
 #else
-			getcwd(cwd, sizeof(cwd));
+				getcwd(cwd, sizeof(cwd));
 #endif
-			struct tm t = date::now();
-			char date[20] = { 0 };
-			sprintf(date, "%02d-%02d", t.tm_mon + 1, t.tm_mday);
-			return std::string(cwd) + separator + "log" + separator + p + "-" + date + ".log";
-		}
+				char date[20] = { 0 };
+				sprintf(date, "%02d-%02d", t.tm_mon + 1, t.tm_mday);
+				return std::string(cwd) + separator + "log" + separator + p + "-" + date + ".log";
+			}
 
-	private:
-		std::ostringstream m_oss;
-		std::string m_log_name;
-		mutable int m_last_day;
-		mutable std::string m_last_filename;
-	};								
+			FILE* m_file;
+			int m_day;                                 // the day m_file is for, as yyyymmdd
+			time_t m_second;                           // the second m_stamp is for
+			char m_stamp[80];
+			uint64_t m_reported;                       // the number of dropped lines already reported
+			std::string m_line;                        // the line being formatted
+			std::string m_console;                     // the batch for the console, without timestamps
+			std::string m_text;                        // the batch for the log file
+		};
 
-	template<class Writer>
-	Writer& writer_single()
+		std::thread writer;
+		std::mutex writer_mutex;
+	}
+
+	void start()
 	{
-		static Writer writer_instance;
-		return writer_instance;
+		std::lock_guard<std::mutex> lock(writer_mutex);
+
+		if (writer.joinable())
+			return;
+
+		writer = std::thread([] { log_writer().run(); });
+
+		// lines queued right before the process exits (e.g. when main returns early after a failed startup) still get written
+
+		atexit(stop);
 	}
 
-	static const char* time_now_string()
+	void stop()
 	{
-		static char str[64] = { 0 };
-		long usec = 0;
-		struct tm t = date::now(&usec);
-		sprintf(str, "%04d-%02d-%02d %02d:%02d:%02d.%3ld", t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec, usec / 1000);
-		return str;
+		std::lock_guard<std::mutex> lock(writer_mutex);
+
+		if (!writer.joinable())
+			return;
+
+		queue.stop();
+		writer.join();
 	}
 
-	logger::logger()
-	{ }
+	uint8_t levels[TAG_COUNT];
+
+	namespace
+	{
+		// every tag starts at info, filled in here rather than listed out so a new tag can't silently default to debug
+
+		struct default_levels
+		{
+			default_levels()
+			{
+				std::fill(std::begin(levels), std::end(levels), (uint8_t)LEVEL_INFO);
+			}
+		} default_levels_init;
+	}
+
+	void set_level(tag t, level l)
+	{
+		levels[t] = l;
+	}
+
+	const char* tag_name(tag t)
+	{
+		static const char* names[] = { "aura", "config", "game", "gameproto", "map", "mapcache", "poller", "profile", "shard", "socket", "stats", "log" };
+		static_assert(sizeof(names) / sizeof(names[0]) == TAG_COUNT, "every tag needs a name");
+		return names[t];
+	}
+
+	bool parse_level(const std::string& s, level& l)
+	{
+		static const char* names[] = { "debug", "info", "warning", "error", "none" };
+
+		for (int i = LEVEL_DEBUG; i <= LEVEL_NONE; ++i)
+		{
+			if (s == names[i])
+			{
+				l = (level)i;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool detail::submit(level l, tag t, const char* format, const packer& args)
+	{
+		return queue.push(l, t, format, args.data(), args.length());
+	}
 
-	logger::~logger()
+	uint64_t dropped()
 	{
-		auto_logger_file& lg = writer_single<auto_logger_file>();
-		lg.stream() << time_now_string() << oss_.str() << std::endl;
-		lg.flush();
+		return queue.dropped();
 	}
 }
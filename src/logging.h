@@ -1,18 +1,194 @@
 # pragma once
 
-#include <sstream>
+#include <string>
+#include <type_traits>
+#include <stdint.h>
+#include <string.h>
 
 namespace logging {
-	class logger
+	// lines are queued by any thread without blocking and written to the console and log/ydhost.log-MM-DD.log by a background thread
+	// the queue has a fixed size, when it's full the line is dropped and counted and the writer reports how many were lost
+	//
+	// a line is a format string plus its arguments, e.g.
+	//   LOG_INFO(GAME, "[GAME: {}] player [{}|{}] joined the game", GetGameName(), Player->GetName(), logging::ipv4(Player->GetExternalIP()));
+	// the arguments are copied into the queue as they are and only turned into text on the writer thread
+	// each {} in the format string is replaced by the next argument, the format string must be a literal since only the pointer is queued
+	// a line below the level set for its tag costs one branch and its arguments aren't even evaluated
+
+	enum level : uint8_t
 	{
-	public:
-		logger();
-		~logger();
-		template <class T>
-		logger& operator << (T const& v) { oss_ << v; return *this; }
-		std::ostringstream oss_;
-	private:
-		logger(logger&);
-		logger& operator=(logger&);
+		LEVEL_DEBUG,
+		LEVEL_INFO,
+		LEVEL_WARNING,
+		LEVEL_ERROR,
+		LEVEL_NONE                                  // only used to turn a tag off
+	};
+
+	enum tag : uint8_t
+	{
+		TAG_AURA,
+		TAG_CONFIG,
+		TAG_GAME,
+		TAG_GAMEPROTO,
+		TAG_MAP,
+		TAG_MAPCACHE,
+		TAG_POLLER,
+		TAG_PROFILE,
+		TAG_SHARD,
+		TAG_SOCKET,
+		TAG_STATS,
+		TAG_LOG,
+		TAG_COUNT
+	};
+
+	// the lowest level logged for each tag, only change it with set_level before the shards are started
+	extern uint8_t levels[TAG_COUNT];
+
+	inline bool enabled(level l, tag t)                 { return l >= levels[t]; }
+
+	void set_level(tag t, level l);
+
+	// the name of a tag in the config, e.g. bot_loglevel_game
+	const char* tag_name(tag t);
+
+	// debug, info, warning, error or none, returns false and leaves l alone for anything else
+	bool parse_level(const std::string& s, level& l);
+
+	// start the writer thread, lines queued before it runs are kept and written once it does
+	void start();
+
+	// write everything still queued and stop the writer thread
+	void stop();
+
+	// the number of lines dropped so far
+	uint64_t dropped();
+
+	// an IPv4 address in network byte order, queued as 4 bytes and formatted as a dotted quad by the writer
+	struct ipv4
+	{
+		uint32_t addr;
+		explicit ipv4(uint32_t nAddr) : addr(nAddr) { }
 	};
+
+	namespace detail {
+		// the room for the arguments of one line, a string that doesn't fit is cut short and arguments after it are left out
+		const size_t ARGS_SIZE = 472;
+
+		enum arg_type : uint8_t
+		{
+			ARG_INT,
+			ARG_UINT,
+			ARG_DOUBLE,
+			ARG_STRING,
+			ARG_IPV4
+		};
+
+		// packs the arguments of one line as a type byte followed by the value, strings get a 16 bit length
+		class packer
+		{
+		public:
+			packer() : m_length(0), m_full(false) { }
+
+			inline const char* data() const             { return m_data; }
+			inline size_t length() const                { return m_length; }
+
+			// once an argument doesn't fit the rest are left out too, length stays at the end of what was written
+			// so the writer runs out of arguments there and leaves the remaining {} as they are
+
+			inline void put(arg_type type, const void* value, size_t size)
+			{
+				if (m_full || ARGS_SIZE - m_length < 1 + size) {
+					m_full = true;
+					return;
+				}
+				m_data[m_length++] = (char)type;
+				memcpy(m_data + m_length, value, size);
+				m_length += size;
+			}
+
+			inline void put_string(const char* s, size_t size)
+			{
+				if (m_full || ARGS_SIZE - m_length < 3) {
+					m_full = true;
+					return;
+				}
+				const size_t room = ARGS_SIZE - m_length - 3;
+				if (size > room) {
+					size = room;
+					m_full = true;
+				}
+				const uint16_t length = (uint16_t)size;
+				m_data[m_length++] = (char)ARG_STRING;
+				memcpy(m_data + m_length, &length, 2);
+				memcpy(m_data + m_length + 2, s, length);
+				m_length += 2 + length;
+			}
+
+		private:
+			char m_data[ARGS_SIZE];
+			size_t m_length;
+			bool m_full;
+		};
+
+		template <class T>
+		inline typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type put(packer& p, T value)
+		{
+			const int64_t v = value;
+			p.put(ARG_INT, &v, sizeof(v));
+		}
+
+		template <class T>
+		inline typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type put(packer& p, T value)
+		{
+			const uint64_t v = value;
+			p.put(ARG_UINT, &v, sizeof(v));
+		}
+
+		template <class T>
+		inline typename std::enable_if<std::is_floating_point<T>::value>::type put(packer& p, T value)
+		{
+			const double v = value;
+			p.put(ARG_DOUBLE, &v, sizeof(v));
+		}
+
+		inline void put(packer& p, const std::string& s)    { p.put_string(s.data(), s.size()); }
+		inline void put(packer& p, const char* s)           { p.put_string(s, strlen(s)); }
+		inline void put(packer& p, const ipv4& ip)          { p.put(ARG_IPV4, &ip.addr, sizeof(ip.addr)); }
+
+		inline void pack(packer&)                           { }
+
+		template <class T, class... Rest>
+		inline void pack(packer& p, const T& value, const Rest&... rest)
+		{
+			put(p, value);
+			pack(p, rest...);
+		}
+
+		bool submit(level l, tag t, const char* format, const packer& args);
+	}
+
+	// queue a line, returns false if it was dropped
+	// this doesn't check the level, use the LOG_ macros
+
+	template <class... Args>
+	inline bool log(level l, tag t, const char* format, const Args&... args)
+	{
+		detail::packer packer;
+		detail::pack(packer, args...);
+		return detail::submit(l, t, format, packer);
+	}
 }
+
+// e.g. LOG_WARNING(MAP, "[MAP] invalid {} detected", key)
+// the level and the tag are pasted onto LEVEL_ and TAG_ so they're safe from macros like ERROR in the Windows headers
+
+#define LOG_AT(lvl, tg, ...) \
+	do { \
+		if (logging::enabled(logging::LEVEL_##lvl, logging::TAG_##tg)) \
+			logging::log(logging::LEVEL_##lvl, logging::TAG_##tg, __VA_ARGS__); \
+	} while (0)
+
+#define LOG_DEBUG(tg, ...)                                  LOG_AT(DEBUG, tg, __VA_ARGS__)
+#define LOG_INFO(tg, ...)                                   LOG_AT(INFO, tg, __VA_ARGS__)
+#define LOG_WARNING(tg, ...)                                LOG_AT(WARNING, tg, __VA_ARGS__)
+#define LOG_ERROR(tg, ...)                                  LOG_AT(ERROR, tg, __VA_ARGS__)
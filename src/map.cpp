@@ -21,10 +21,14 @@ CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
 #include "map.h"
 #include "config.h"
 #include "gameslot.h"
+#include "crc32.h"
+#include "maphash.h"
+#include "mapcache.h"
+#include "logging.h"
+#include <algorithm>
 #include <string>
 #include <sstream>
-
-void Print(const std::string &message);
+#include <thread>
 
 template <class T, size_t N>
 bool ExtractNumbers(const std::string &s, std::array<T, N>& result)
@@ -47,7 +51,7 @@ bool ExtractNumbers(const std::string &s, std::array<T, N>& result)
 template <class T>
 bool ExtractNumbers(const std::string &s, T& result, typename std::enable_if<std::is_integral<T>::value>::type* = 0)
 {
-	std::array<uint8_t, sizeof T> tmp;
+	std::array<uint8_t, sizeof(T)> tmp;
 	if (!ExtractNumbers(s, tmp))
 		return false;
 	result = 0;
@@ -63,10 +67,10 @@ template <class T>
 bool ConfigRead(CConfig* cfg, const std::string& key, T& result)
 {
 	if (!ExtractNumbers(cfg->GetString(key, std::string()), result)) {
-		Print("[MAP] invalid " + key + " detected");
+		LOG_WARNING(MAP, "[MAP] invalid {} detected", key);
 		return false;
 	}
-	Print("[MAP] " + key + " = " + std::to_string(result));
+	LOG_DEBUG(MAP, "[MAP] {} = {}", key, result);
 	return true;
 }
 
@@ -76,11 +80,11 @@ bool ConfigRead(CConfig* cfg, const std::string& key, std::array<T, N>& result,
 	std::string str = cfg->GetString(key, std::string());
 	if (!ExtractNumbers(str, result)) {
 		if (showerror) {
-			Print("[MAP] invalid " + key + " detected");
+			LOG_WARNING(MAP, "[MAP] invalid {} detected", key);
 		}
 		return false;
 	}
-	Print("[MAP] " + key + " = " + str);
+	LOG_DEBUG(MAP, "[MAP] {} = {}", key, str);
 	return true;
 }
 
@@ -88,9 +92,11 @@ bool ConfigRead(CConfig* cfg, const std::string& key, std::array<T, N>& result,
 // CMap
 //
 
-CMap::CMap(std::string const& MapPath, CConfig *MAP)
+const uint32_t CMap::MAPPART_SIZE;
+
+CMap::CMap(std::string const& MapPath, std::string const& MapLocalPath, std::string const& JassPath, CConfig *MAP, CMapCache *Cache)
 {
-	Load(MapPath, MAP);
+	Load(MapPath, MapLocalPath, JassPath, MAP, Cache);
 }
 
 CMap::~CMap()
@@ -167,29 +173,46 @@ uint8_t CMap::GetMapLayoutStyle() const
 	return 3;
 }
 
-void CMap::Load(std::string const& MapPath, CConfig *MAP)
+void CMap::Load(std::string const& MapPath, std::string const& MapLocalPath, std::string const& JassPath, CConfig *MAP, CMapCache *Cache)
 {
 	m_Valid = false;
 
 	m_MapPath = MapPath;
 
-	if (!ConfigRead(MAP, "map_size", m_MapSize)) { return; }
-	if (!ConfigRead(MAP, "map_info", m_MapInfo)) { return; }
-	if (!ConfigRead(MAP, "map_crc", m_MapCRC)) { return; }
-	if (!ConfigRead(MAP, "map_sha1", m_MapSHA1)) { return; }
-	if (!ConfigRead(MAP, "map_options", m_MapOptions)) { return; }
-	if (!ConfigRead(MAP, "map_width", m_MapWidth)) { return; }
-	if (!ConfigRead(MAP, "map_height", m_MapHeight)) { return; }
+	// map the map file so it can be sent to players who don't have it
+	// the mapping is read only and shared by every game so the map is never copied into memory
 
-	m_Slots.clear();
-	for (uint32_t Slot = 1; Slot <= 12; ++Slot)
+	if (m_MapData.Open(MapLocalPath))
+	{
+		LOG_INFO(MAP, "[MAP] loaded map file [{}] ({} bytes)", MapLocalPath, m_MapData.GetSize());
+		BuildMapPartCRCs();
+	}
+	else
+		LOG_WARNING(MAP, "[MAP] warning - unable to load map file [{}], map downloads will not be possible", MapLocalPath);
+
+	if (MAP)
 	{
-		std::array<uint8_t, 9> SlotData;
-		if (!ConfigRead(MAP, "map_slot" + std::to_string(Slot), SlotData, false)) { 
-			break;
+		if (!ConfigRead(MAP, "map_size", m_MapSize)) { return; }
+		if (!ConfigRead(MAP, "map_info", m_MapInfo)) { return; }
+		if (!ConfigRead(MAP, "map_crc", m_MapCRC)) { return; }
+		if (!ConfigRead(MAP, "map_sha1", m_MapSHA1)) { return; }
+		if (!ConfigRead(MAP, "map_options", m_MapOptions)) { return; }
+		if (!ConfigRead(MAP, "map_width", m_MapWidth)) { return; }
+		if (!ConfigRead(MAP, "map_height", m_MapHeight)) { return; }
+
+		m_Slots.clear();
+		for (uint32_t Slot = 1; Slot <= 12; ++Slot)
+		{
+			std::array<uint8_t, 9> SlotData;
+			if (!ConfigRead(MAP, "map_slot" + std::to_string(Slot), SlotData, false)) { 
+				break;
+			}
+			m_Slots.push_back(CGameSlot(SlotData[0], SlotData[1], SlotData[2], SlotData[3], SlotData[4], SlotData[5], SlotData[6], SlotData[7], SlotData[8]));
 		}
-		m_Slots.push_back(CGameSlot(SlotData[0], SlotData[1], SlotData[2], SlotData[3], SlotData[4], SlotData[5], SlotData[6], SlotData[7], SlotData[8]));
 	}
+	else if (!CalculateMapInfo(MapLocalPath, JassPath, Cache))
+		return;
+
 	m_MapNumPlayers = m_Slots.size();
 
 	m_MapSpeed = MAPSPEED::FAST;
@@ -220,7 +243,7 @@ void CMap::Load(std::string const& MapPath, CConfig *MAP)
 
 	if (m_MapFlags & MAPFLAG::RANDOMRACES)
 	{
-		Print("[MAP] forcing races to random");
+		LOG_INFO(MAP, "[MAP] forcing races to random");
 
 		for (auto & slot : m_Slots)
 			slot.SetRace(SLOTRACE_RANDOM);
@@ -230,7 +253,7 @@ void CMap::Load(std::string const& MapPath, CConfig *MAP)
 
 	if (m_MapObservers == MAPOBS::ALLOWED || m_MapObservers == MAPOBS::REFEREES)
 	{
-		Print("[MAP] adding " + std::to_string(12 - m_Slots.size()) + " observer slots");
+		LOG_INFO(MAP, "[MAP] adding {} observer slots", 12 - m_Slots.size());
 
 		while (m_Slots.size() < 12)
 			m_Slots.push_back(CGameSlot(0, 255, SLOTSTATUS_OPEN, 0, 12, 12, SLOTRACE_RANDOM));
@@ -239,42 +262,130 @@ void CMap::Load(std::string const& MapPath, CConfig *MAP)
 	CheckValid();
 }
 
+bool CMap::CalculateMapInfo(std::string const& MapLocalPath, std::string const& JassPath, CMapCache *Cache)
+{
+	// calculate what tools/mapdump would have written to the map cfg straight from the map file
+	// common.j and blizzard.j are taken from JassPath unless the map has its own copies
+
+	if (!m_MapData.IsOpen())
+	{
+		LOG_WARNING(MAP, "[MAP] no map cfg and no map file, unable to calculate the map info");
+		return false;
+	}
+
+	const BYTEVIEW Data = m_MapData.GetData();
+	hash::mapinfo Info;
+
+	if (Cache && Cache->Get(MapLocalPath, m_MapData.GetSize(), m_MapData.GetModifiedTime(), m_MapData.GetFileID(), Info))
+		LOG_INFO(MAP, "[MAP] using the cached map info, the map file hasn't changed");
+	else
+	{
+		std::string Error;
+
+		if (!hash::maphash(Data.data(), Data.size(), JassPath, Info, Error) || !hash::mapw3i(Data.data(), Data.size(), Info, Error))
+		{
+			LOG_WARNING(MAP, "[MAP] unable to calculate the map info - {}", Error);
+			return false;
+		}
+
+		LOG_INFO(MAP, "[MAP] calculated the map info from the map file");
+
+		if (Cache)
+		{
+			Cache->Put(MapLocalPath, m_MapData.GetSize(), m_MapData.GetModifiedTime(), m_MapData.GetFileID(), Info);
+			Cache->Save();
+		}
+	}
+
+	m_MapSize = Info.size;
+	m_MapInfo = Info.info;
+	m_MapCRC = Info.crc;
+	m_MapSHA1 = Info.sha1;
+	m_MapOptions = Info.options;
+	m_MapWidth = Info.width;
+	m_MapHeight = Info.height;
+
+	m_Slots.clear();
+	for (const auto & Slot : Info.slots)
+		m_Slots.push_back(CGameSlot(Slot.pid, Slot.download_status, Slot.slot_status, Slot.computer, Slot.team, Slot.colour, Slot.race, Slot.computer_type, Slot.handicap));
+
+	LOG_INFO(MAP, "[MAP] map_size = {}, map_info = {}, map_crc = {}", m_MapSize, m_MapInfo, m_MapCRC);
+	return true;
+}
+
+void CMap::BuildMapPartCRCs()
+{
+	// every player downloading the map is sent the same parts so the CRC32 of each part is calculated once here instead of once per MAPPART packet
+	// big maps are split between a few threads, each one fills its own range of the table
+
+	const BYTEVIEW Data = m_MapData.GetData();
+	const uint32_t NumParts = (Data.size() + MAPPART_SIZE - 1) / MAPPART_SIZE;
+	m_MapPartCRCs.resize(NumParts);
+
+	auto BuildRange = [this, Data](uint32_t First, uint32_t Last)
+	{
+		for (uint32_t i = First; i < Last; ++i)
+		{
+			const uint32_t Start = i * MAPPART_SIZE;
+			m_MapPartCRCs[i] = hash::crc32(Data.data() + Start, std::min(MAPPART_SIZE, Data.size() - Start));
+		}
+	};
+
+	// don't bother starting a thread for less than about a megabyte
+
+	const uint32_t NumThreads = std::max(1u, std::min(std::thread::hardware_concurrency(), NumParts / 1024));
+	const uint32_t PartsPerThread = (NumParts + NumThreads - 1) / NumThreads;
+	std::vector<std::thread> Threads;
+
+	for (uint32_t i = 1; i < NumThreads; ++i)
+		Threads.emplace_back(BuildRange, std::min(NumParts, i * PartsPerThread), std::min(NumParts, (i + 1) * PartsPerThread));
+
+	BuildRange(0, std::min(NumParts, PartsPerThread));
+
+	for (auto & Thread : Threads)
+		Thread.join();
+}
+
+BYTEVIEW CMap::GetMapPart(uint32_t Start) const
+{
+	const BYTEVIEW Data = m_MapData.GetData();
+
+	if (Start >= Data.size())
+		return BYTEVIEW();
+
+	return Data.substr(Start, std::min(MAPPART_SIZE, Data.size() - Start));
+}
+
 void CMap::CheckValid()
 {
 	// TODO: should this code fix any errors it sees rather than just warning the user?
 
 	if (m_MapPath.empty() || m_MapPath.length() > 53)
 	{
-		Print("[MAP] invalid map_path detected");
+		LOG_WARNING(MAP, "[MAP] invalid map_path detected");
 		return;
 	}
 
 	if (m_MapPath.find('/') != std::string::npos) {
-		Print("[MAP] warning - map_path contains forward slashes '/' but it must use Windows style back slashes '\\'");
+		LOG_WARNING(MAP, "[MAP] warning - map_path contains forward slashes '/' but it must use Windows style back slashes '\\'");
 	}
 
-	if (!m_MapData.empty() && m_MapData.size() != m_MapSize)
+	if (m_MapData.IsOpen() && m_MapData.GetSize() != m_MapSize)
 	{
-		Print("[MAP] invalid map_size detected - size mismatch with actual map data");
+		LOG_WARNING(MAP, "[MAP] invalid map_size detected - size mismatch with actual map data");
 		return;
 	}
 
 	if (m_MapNumPlayers == 0 || m_MapNumPlayers > 12)
 	{
-		Print("[MAP] invalid map_numplayers detected");
+		LOG_WARNING(MAP, "[MAP] invalid map_numplayers detected");
 		return;
 	}
 
 	if (m_Slots.empty() || m_Slots.size() > 12)
 	{
-		Print("[MAP] invalid map_slot<x> detected");
+		LOG_WARNING(MAP, "[MAP] invalid map_slot<x> detected");
 		return;
 	}
 	m_Valid = true;
 }
-
-const std::string* CMap::GetMapData() const
-{
-	// todo; صͼ֧
-	return &m_MapData;
-}
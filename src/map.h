@@ -25,13 +25,17 @@ CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
 // CMap
 //
 
+#include "mappedfile.h"
+
 #include <array>
+#include <string>
 #include <vector>
 #include <stdint.h>
 
 class CAura;
 class CGameSlot;
 class CConfig;
+class CMapCache;
 
 class CMap
 {
@@ -83,8 +87,12 @@ public:
 		//WATERWAVESONSLOPESHORES = 1 << 12,
 	};
 
+	// the map is sent to players in parts of this many bytes
+
+	static const uint32_t MAPPART_SIZE = 1442;
+
 public:
-	CMap(std::string const& MapPath, CConfig *MAP);
+	CMap(std::string const& MapPath, std::string const& MapLocalPath, std::string const& JassPath, CConfig *MAP, CMapCache *Cache);
 	~CMap();
 
 	inline bool GetValid() const                               { return m_Valid; }
@@ -103,12 +111,24 @@ public:
 
 	uint32_t GetMapGameFlags() const;
 	uint8_t GetMapLayoutStyle() const;
-	const std::string *GetMapData() const;
-	void Load(std::string const& MapPath, CConfig *MAP);
+	inline BYTEVIEW GetMapData() const                         { return m_MapData.GetData(); }
+
+	// the part of the map data starting at Start (a multiple of MAPPART_SIZE) and its CRC32 from the table built at load time
+
+	BYTEVIEW GetMapPart(uint32_t Start) const;
+	inline uint32_t GetMapPartCRC(uint32_t Start) const        { return m_MapPartCRCs[Start / MAPPART_SIZE]; }
+
+	// MAP can be null, the map info is then calculated from the map file (see tools/maphash)
+	// or taken from Cache (if not null) when the map file hasn't changed since it was last calculated
+
+	void Load(std::string const& MapPath, std::string const& MapLocalPath, std::string const& JassPath, CConfig *MAP, CMapCache *Cache);
 	void CheckValid();
 
 private:
-	std::string m_MapData;              // the map data itself, for sending the map to players
+	bool CalculateMapInfo(std::string const& MapLocalPath, std::string const& JassPath, CMapCache *Cache);
+
+	CMappedFile m_MapData;              // the map data itself, for sending the map to players (empty if the map file couldn't be loaded)
+	std::vector<uint32_t> m_MapPartCRCs; // the CRC32 of each MAPPART_SIZE part of the map data
 	std::array<uint8_t, 20> m_MapSHA1;  // config value: map sha1 (20 bytes)
 	uint32_t m_MapSize;                 // config value: map size (4 bytes)
 	uint32_t m_MapInfo;                 // config value: map info (4 bytes) -> this is the real CRC
@@ -124,6 +144,8 @@ private:
 	MAPOBS   m_MapObservers;
 	uint32_t m_MapFlags;
 	bool m_Valid;
+
+	void BuildMapPartCRCs();
 };
 
 inline uint32_t operator&(uint32_t a, CMap::MAPFLAG b)
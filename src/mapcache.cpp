@@ -0,0 +1,183 @@
+#include "mapcache.h"
+#include "logging.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+// bump this whenever the line format or the way the map info is calculated changes
+
+static const char *MAPCACHE_HEADER = "# ydhost map cache 1";
+
+// a map has at most 24 players (12 before war3map.w3i version 28), an entry with more than that is corrupt
+
+static const uint64_t MAPCACHE_MAX_SLOTS = 24;
+
+//
+// CMapCache
+//
+
+CMapCache::CMapCache(const std::string &nFileName)
+	: m_FileName(nFileName),
+	m_Changed(false)
+{
+	Load();
+}
+
+CMapCache::~CMapCache()
+{
+
+}
+
+void CMapCache::Load()
+{
+	std::ifstream in(m_FileName.c_str());
+
+	if (!in)
+		return;
+
+	std::string Line;
+
+	if (!std::getline(in, Line) || Line != MAPCACHE_HEADER)
+	{
+		LOG_INFO(MAPCACHE, "[MAPCACHE] ignoring [{}], it was written by a different version", m_FileName);
+		return;
+	}
+
+	// each line is: size mtime inode info crc sha1[20] options width height numslots slots[numslots * 9] path
+	// the path comes last so it can contain spaces
+
+	while (std::getline(in, Line))
+	{
+		std::istringstream SS(Line);
+		CEntry Entry;
+		uint64_t Values[5 + 20 + 4];
+
+		for (auto & Value : Values)
+			SS >> Value;
+
+		Entry.Size = Values[0];
+		Entry.ModifiedTime = Values[1];
+		Entry.FileID = Values[2];
+		Entry.Info.info = (uint32_t)Values[3];
+		Entry.Info.crc = (uint32_t)Values[4];
+
+		for (uint32_t i = 0; i < 20; ++i)
+			Entry.Info.sha1[i] = (uint8_t)Values[5 + i];
+
+		Entry.Info.size = (uint32_t)Entry.Size;
+		Entry.Info.options = (uint8_t)Values[25];
+		Entry.Info.width = (uint16_t)Values[26];
+		Entry.Info.height = (uint16_t)Values[27];
+
+		const uint64_t NumSlots = Values[28];
+
+		if (NumSlots > MAPCACHE_MAX_SLOTS)
+			continue;
+
+		for (uint64_t i = 0; i < NumSlots && SS; ++i)
+		{
+			uint32_t Slot[9];
+
+			for (auto & Value : Slot)
+				SS >> Value;
+
+			Entry.Info.slots.push_back(hash::mapslot{ (uint8_t)Slot[0], (uint8_t)Slot[1], (uint8_t)Slot[2], (uint8_t)Slot[3], (uint8_t)Slot[4], (uint8_t)Slot[5], (uint8_t)Slot[6], (uint8_t)Slot[7], (uint8_t)Slot[8] });
+		}
+
+		std::string Path;
+
+		if (!SS || SS.get() != ' ' || !std::getline(SS, Path) || Path.empty() || Entry.Info.slots.size() != NumSlots)
+			continue;
+
+		m_Entries[Path] = Entry;
+	}
+}
+
+bool CMapCache::Get(const std::string &Path, uint64_t Size, uint64_t ModifiedTime, uint64_t FileID, hash::mapinfo &Info) const
+{
+	auto it = m_Entries.find(Path);
+
+	if (it == m_Entries.end() || it->second.Size != Size || it->second.ModifiedTime != ModifiedTime || it->second.FileID != FileID)
+		return false;
+
+	Info = it->second.Info;
+	return true;
+}
+
+void CMapCache::Put(const std::string &Path, uint64_t Size, uint64_t ModifiedTime, uint64_t FileID, const hash::mapinfo &Info)
+{
+	CEntry &Entry = m_Entries[Path];
+	Entry.Size = Size;
+	Entry.ModifiedTime = ModifiedTime;
+	Entry.FileID = FileID;
+	Entry.Info = Info;
+	m_Changed = true;
+}
+
+bool CMapCache::Save()
+{
+	if (!m_Changed)
+		return true;
+
+	const std::string TempFileName = m_FileName + ".tmp";
+
+	{
+		std::ofstream out(TempFileName.c_str(), std::ios::trunc);
+
+		if (!out)
+		{
+			LOG_WARNING(MAPCACHE, "[MAPCACHE] unable to write [{}]", TempFileName);
+			return false;
+		}
+
+		out << MAPCACHE_HEADER << '\n';
+
+		for (const auto & it : m_Entries)
+		{
+			const CEntry &Entry = it.second;
+
+			if (Entry.Info.slots.size() > MAPCACHE_MAX_SLOTS)
+			{
+				LOG_WARNING(MAPCACHE, "[MAPCACHE] not caching [{}], it has {} slots", it.first, Entry.Info.slots.size());
+				continue;
+			}
+
+			out << Entry.Size << ' ' << Entry.ModifiedTime << ' ' << Entry.FileID << ' ' << Entry.Info.info << ' ' << Entry.Info.crc;
+
+			for (const auto & Byte : Entry.Info.sha1)
+				out << ' ' << (uint32_t)Byte;
+
+			out << ' ' << (uint32_t)Entry.Info.options << ' ' << Entry.Info.width << ' ' << Entry.Info.height << ' ' << Entry.Info.slots.size();
+
+			for (const auto & Slot : Entry.Info.slots)
+			{
+				for (uint8_t Value : { Slot.pid, Slot.download_status, Slot.slot_status, Slot.computer, Slot.team, Slot.colour, Slot.race, Slot.computer_type, Slot.handicap })
+					out << ' ' << (uint32_t)Value;
+			}
+
+			out << ' ' << it.first << '\n';
+		}
+
+		if (!out.flush())
+		{
+			LOG_WARNING(MAPCACHE, "[MAPCACHE] unable to write [{}]", TempFileName);
+			return false;
+		}
+	}
+
+	// rename doesn't replace an existing file on Windows
+
+#ifdef WIN32
+	std::remove(m_FileName.c_str());
+#endif
+
+	if (std::rename(TempFileName.c_str(), m_FileName.c_str()) != 0)
+	{
+		LOG_WARNING(MAPCACHE, "[MAPCACHE] unable to replace [{}]", m_FileName);
+		return false;
+	}
+
+	m_Changed = false;
+	return true;
+}
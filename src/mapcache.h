@@ -0,0 +1,48 @@
+#ifndef AURA_MAPCACHE_H_
+#define AURA_MAPCACHE_H_
+
+#include "maphash.h"
+
+#include <map>
+#include <string>
+#include <stdint.h>
+
+//
+// CMapCache
+//
+// remembers the map info calculated from each map file so restarting doesn't rehash maps which haven't changed
+// an entry is only used if the file's size, modification time and inode (file index on Windows) are all unchanged
+// the cache is a small text file with one line per map, it's read in one go and only rewritten when an entry was added or replaced
+//
+
+class CMapCache
+{
+private:
+	struct CEntry
+	{
+		uint64_t Size;
+		uint64_t ModifiedTime;
+		uint64_t FileID;
+		hash::mapinfo Info;
+	};
+
+	std::string m_FileName;
+	std::map<std::string, CEntry> m_Entries;      // map file path -> entry
+	bool m_Changed;                               // if the cache has to be written back
+
+	void Load();
+
+public:
+	explicit CMapCache(const std::string &nFileName);
+	~CMapCache();
+	CMapCache(CMapCache &) = delete;
+
+	bool Get(const std::string &Path, uint64_t Size, uint64_t ModifiedTime, uint64_t FileID, hash::mapinfo &Info) const;
+	void Put(const std::string &Path, uint64_t Size, uint64_t ModifiedTime, uint64_t FileID, const hash::mapinfo &Info);
+
+	// write the cache if anything changed, the new file replaces the old one only once it's complete
+
+	bool Save();
+};
+
+#endif  // AURA_MAPCACHE_H_
@@ -0,0 +1,138 @@
+#include "mappedfile.h"
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//
+// CMappedFile
+//
+
+CMappedFile::CMappedFile()
+	: m_Data(nullptr),
+	m_Size(0),
+	m_ModifiedTime(0),
+	m_FileID(0)
+#ifdef WIN32
+	, m_File(INVALID_HANDLE_VALUE),
+	m_Mapping(nullptr)
+#endif
+{
+
+}
+
+CMappedFile::~CMappedFile()
+{
+	Close();
+}
+
+bool CMappedFile::Open(const std::string &FileName)
+{
+	Close();
+
+#ifdef WIN32
+	m_File = CreateFileA(FileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (m_File == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER Size;
+
+	if (!GetFileSizeEx(m_File, &Size) || Size.QuadPart == 0 || Size.QuadPart > UINT32_MAX)
+	{
+		Close();
+		return false;
+	}
+
+	m_Mapping = CreateFileMappingA(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (!m_Mapping)
+	{
+		Close();
+		return false;
+	}
+
+	m_Data = (const uint8_t *)MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0);
+
+	if (!m_Data)
+	{
+		Close();
+		return false;
+	}
+
+	BY_HANDLE_FILE_INFORMATION Info;
+
+	if (GetFileInformationByHandle(m_File, &Info))
+	{
+		m_ModifiedTime = ((uint64_t)Info.ftLastWriteTime.dwHighDateTime << 32) | Info.ftLastWriteTime.dwLowDateTime;
+		m_FileID = ((uint64_t)Info.nFileIndexHigh << 32) | Info.nFileIndexLow;
+	}
+
+	m_Size = (uint32_t)Size.QuadPart;
+#else
+	const int File = open(FileName.c_str(), O_RDONLY);
+
+	if (File == -1)
+		return false;
+
+	struct stat Info;
+
+	if (fstat(File, &Info) == -1 || !S_ISREG(Info.st_mode) || Info.st_size == 0 || (uint64_t)Info.st_size > UINT32_MAX)
+	{
+		close(File);
+		return false;
+	}
+
+	// the mapping stays valid after the descriptor is closed
+
+	void *Data = mmap(nullptr, (size_t)Info.st_size, PROT_READ, MAP_SHARED, File, 0);
+	close(File);
+
+	if (Data == MAP_FAILED)
+		return false;
+
+	m_Data = (const uint8_t *)Data;
+	m_Size = (uint32_t)Info.st_size;
+	m_FileID = (uint64_t)Info.st_ino;
+
+	// nanoseconds where the platform has them so a map rewritten within the same second is still noticed
+
+#if defined(__APPLE__)
+	m_ModifiedTime = (uint64_t)Info.st_mtimespec.tv_sec * 1000000000 + Info.st_mtimespec.tv_nsec;
+#else
+	m_ModifiedTime = (uint64_t)Info.st_mtim.tv_sec * 1000000000 + Info.st_mtim.tv_nsec;
+#endif
+#endif
+
+	return true;
+}
+
+void CMappedFile::Close()
+{
+#ifdef WIN32
+	if (m_Data)
+		UnmapViewOfFile(m_Data);
+
+	if (m_Mapping)
+		CloseHandle(m_Mapping);
+
+	if (m_File != INVALID_HANDLE_VALUE)
+		CloseHandle(m_File);
+
+	m_File = INVALID_HANDLE_VALUE;
+	m_Mapping = nullptr;
+#else
+	if (m_Data)
+		munmap((void *)m_Data, m_Size);
+#endif
+
+	m_Data = nullptr;
+	m_Size = 0;
+	m_ModifiedTime = 0;
+	m_FileID = 0;
+}
@@ -0,0 +1,49 @@
+#ifndef AURA_MAPPEDFILE_H_
+#define AURA_MAPPEDFILE_H_
+
+#include "util.h"
+
+#include <string>
+#include <stdint.h>
+
+//
+// CMappedFile
+//
+// a read only memory mapping of a whole file
+// the pages are loaded by the OS on demand and shared with every other mapping of the same file
+// so serving a file to many players from many games costs no more memory than the page cache already uses
+//
+
+class CMappedFile
+{
+private:
+	const uint8_t *m_Data;
+	uint32_t m_Size;
+	uint64_t m_ModifiedTime;                      // the last write time of the file when it was opened (in OS specific units)
+	uint64_t m_FileID;                            // the inode (or NTFS file index) of the file
+#ifdef WIN32
+	void *m_File;                                 // HANDLE of the file
+	void *m_Mapping;                              // HANDLE of the file mapping object
+#endif
+
+public:
+	CMappedFile();
+	~CMappedFile();
+	CMappedFile(CMappedFile &) = delete;
+
+	inline bool IsOpen() const                              { return m_Data != nullptr; }
+	inline uint32_t GetSize() const                         { return m_Size; }
+	inline BYTEVIEW GetData() const                         { return BYTEVIEW(m_Data, m_Size); }
+
+	// these identify the version of the file that was mapped, if any of them changes the file was modified or replaced
+
+	inline uint64_t GetModifiedTime() const                 { return m_ModifiedTime; }
+	inline uint64_t GetFileID() const                       { return m_FileID; }
+
+	// returns false if the file doesn't exist, is empty or can't be mapped
+
+	bool Open(const std::string &FileName);
+	void Close();
+};
+
+#endif  // AURA_MAPPEDFILE_H_
@@ -0,0 +1,111 @@
+#ifndef AURA_PACKETWRITER_H_
+#define AURA_PACKETWRITER_H_
+
+#include "util.h"
+
+#include <array>
+#include <string>
+#include <cstring>
+#include <stdint.h>
+
+//
+// CPacketWriter
+//
+// writes little endian fields one after the other into a buffer provided by the caller
+// nothing is allocated and nothing is bounds checked, the caller works out the size of the packet first
+//
+
+class CPacketWriter
+{
+private:
+	uint8_t *m_Data;
+	uint32_t m_Length;                            // the number of bytes written so far
+
+public:
+	explicit CPacketWriter(uint8_t *nData)                  : m_Data(nData), m_Length(0) { }
+
+	inline uint8_t *GetData() const                         { return m_Data; }
+	inline uint32_t GetLength() const                       { return m_Length; }
+
+	inline void Write(uint8_t i)                            { m_Data[m_Length++] = i; }
+	inline void Write(uint16_t i)                           { Write((uint8_t)i); Write((uint8_t)(i >> 8)); }
+	inline void Write(uint32_t i)                           { Write((uint16_t)i); Write((uint16_t)(i >> 16)); }
+
+	inline void Write(const uint8_t *Data, uint32_t Length)
+	{
+		if (Length > 0)
+			memcpy(m_Data + m_Length, Data, Length);
+
+		m_Length += Length;
+	}
+
+	inline void Write(const BYTEVIEW &b)                    { Write(b.data(), b.size()); }
+
+	// strings are written with their null terminator
+
+	inline void Write(const std::string &s)                 { Write((const uint8_t *)s.c_str(), (uint32_t)s.size() + 1); }
+
+	// the header of a W3GS style packet, Length includes the header itself
+
+	inline void WriteHeader(uint8_t Header, uint8_t ID, uint16_t Length)
+	{
+		Write(Header);
+		Write(ID);
+		Write(Length);
+	}
+};
+
+//
+// CPacketLayout
+//
+// the layout of a packet which always has the same size: the header and ID followed by a fixed list of integer fields
+// the size is known at compile time so the packet is encoded straight into a std::array on the stack
+// e.g. CPacketLayout<W3GS_HEADER_CONSTANT, W3GS_STOP_LAG, uint8_t, uint32_t>::Encode(PID, Time)
+//
+
+template <typename... Fields>
+struct CFieldsSize;
+
+template <>
+struct CFieldsSize<>
+{
+	static const uint16_t Value = 0;
+};
+
+template <typename T, typename... Rest>
+struct CFieldsSize<T, Rest...>
+{
+	static const uint16_t Value = sizeof(T) + CFieldsSize<Rest...>::Value;
+};
+
+template <uint8_t Header, uint8_t ID, typename... Fields>
+class CPacketLayout
+{
+public:
+	static const uint16_t Length = 4 + CFieldsSize<Fields...>::Value;
+
+	typedef std::array<uint8_t, Length> Packet;
+
+	static Packet Encode(Fields... Values)
+	{
+		Packet packet;
+		CPacketWriter Writer(packet.data());
+		Writer.WriteHeader(Header, ID, Length);
+		WriteFields(Writer, Values...);
+		return packet;
+	}
+
+private:
+	// this ends the recursion over the fields
+
+	static inline void WriteFields(CPacketWriter &)         { }
+
+	template <typename T, typename... Rest>
+	static inline void WriteFields(CPacketWriter &Writer, T Value, Rest... Values)
+	{
+		Writer.Write(Value);
+		WriteFields(Writer, Values...);
+	}
+};
+
+#endif  // AURA_PACKETWRITER_H_
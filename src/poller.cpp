@@ -0,0 +1,382 @@
+#include "poller.h"
+#include "socket.h"
+#include "logging.h"
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
+#ifdef WIN32
+#define MILLISLEEP( x ) Sleep( x )
+#else
+#define MILLISLEEP( x ) usleep( ( x ) * 1000 )
+#endif
+
+#ifndef WIN32
+int32_t GetLastError();
+#endif
+
+namespace
+{
+	void SetNonBlocking(SOCKET Socket)
+	{
+#ifdef WIN32
+		u_long Mode = 1;
+		ioctlsocket(Socket, FIONBIO, &Mode);
+#else
+		fcntl(Socket, F_SETFL, fcntl(Socket, F_GETFL) | O_NONBLOCK);
+#endif
+	}
+
+	// a connected pair of non blocking sockets for CSelectPoller's wakeups
+
+	bool CreateSocketPair(SOCKET Pair[2])
+	{
+#ifdef WIN32
+		// there's no socketpair on Windows so connect two TCP sockets over the loopback interface
+
+		SOCKET Listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+		if (Listener == INVALID_SOCKET)
+			return false;
+
+		struct sockaddr_in Addr;
+		memset(&Addr, 0, sizeof(Addr));
+		Addr.sin_family = AF_INET;
+		Addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		Addr.sin_port = 0;
+		int AddrLen = sizeof(Addr);
+
+		Pair[0] = INVALID_SOCKET;
+		Pair[1] = INVALID_SOCKET;
+
+		if (::bind(Listener, (struct sockaddr *)&Addr, sizeof(Addr)) != SOCKET_ERROR && getsockname(Listener, (struct sockaddr *)&Addr, &AddrLen) != SOCKET_ERROR && listen(Listener, 1) != SOCKET_ERROR)
+		{
+			Pair[1] = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+			if (Pair[1] != INVALID_SOCKET && connect(Pair[1], (struct sockaddr *)&Addr, sizeof(Addr)) != SOCKET_ERROR)
+				Pair[0] = accept(Listener, nullptr, nullptr);
+		}
+
+		closesocket(Listener);
+
+		if (Pair[0] == INVALID_SOCKET)
+		{
+			if (Pair[1] != INVALID_SOCKET)
+				closesocket(Pair[1]);
+
+			Pair[1] = INVALID_SOCKET;
+			return false;
+		}
+
+		// the wakeup byte shouldn't wait for Nagle
+
+		int32_t NoDelay = 1;
+		setsockopt(Pair[1], IPPROTO_TCP, TCP_NODELAY, (const char *)&NoDelay, sizeof(NoDelay));
+#else
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, Pair) == -1)
+		{
+			Pair[0] = INVALID_SOCKET;
+			Pair[1] = INVALID_SOCKET;
+			return false;
+		}
+#endif
+
+		SetNonBlocking(Pair[0]);
+		SetNonBlocking(Pair[1]);
+		return true;
+	}
+}
+
+//
+// CPoller
+//
+
+CPoller::CPoller()
+	: m_NumSockets(0),
+	m_Pending(false),
+	m_CanWake(true)
+{
+
+}
+
+CPoller::~CPoller()
+{
+
+}
+
+uint32_t CPoller::GetTimeout(uint32_t timeout)
+{
+	if (m_Pending)
+	{
+		m_Pending = false;
+		return 0;
+	}
+
+	// nothing can interrupt the wait so come back once a second to notice new games and shutdown requests
+
+	if (!m_CanWake)
+		return std::min<uint32_t>(timeout, 1000);
+
+	return timeout;
+}
+
+CPoller *CPoller::Create()
+{
+#ifdef __linux__
+	return new CEPollPoller();
+#else
+	return new CSelectPoller();
+#endif
+}
+
+#ifdef __linux__
+
+//
+// CEPollPoller
+//
+
+CEPollPoller::CEPollPoller()
+	: CPoller(),
+	m_EPoll(epoll_create1(EPOLL_CLOEXEC)),
+	m_WakeFD(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+	m_Events(256)
+{
+	if (m_EPoll == -1)
+		LOG_ERROR(POLLER, "[POLLER] error (epoll_create1) - {}", errno);
+
+	// the wakeup eventfd is the only entry without a socket
+
+	struct epoll_event Event;
+	Event.events = EPOLLIN | EPOLLET;
+	Event.data.ptr = nullptr;
+
+	if (m_WakeFD == -1 || epoll_ctl(m_EPoll, EPOLL_CTL_ADD, m_WakeFD, &Event) == -1)
+	{
+		LOG_ERROR(POLLER, "[POLLER] error (eventfd) - {}", errno);
+		m_CanWake = false;
+	}
+}
+
+CEPollPoller::~CEPollPoller()
+{
+	if (m_WakeFD != -1)
+		close(m_WakeFD);
+
+	if (m_EPoll != -1)
+		close(m_EPoll);
+}
+
+void CEPollPoller::Add(CSocket *socket)
+{
+	// register for both directions once, edge triggered so we only hear about changes
+
+	struct epoll_event Event;
+	Event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+	Event.data.ptr = socket;
+
+	if (epoll_ctl(m_EPoll, EPOLL_CTL_ADD, socket->GetFD(), &Event) == -1)
+	{
+		LOG_ERROR(POLLER, "[POLLER] error (epoll_ctl add) - {}", errno);
+		return;
+	}
+
+	++m_NumSockets;
+}
+
+void CEPollPoller::Remove(CSocket *socket)
+{
+	if (epoll_ctl(m_EPoll, EPOLL_CTL_DEL, socket->GetFD(), nullptr) == 0)
+		--m_NumSockets;
+}
+
+uint32_t CEPollPoller::Wait(uint32_t timeout)
+{
+	timeout = GetTimeout(timeout);
+
+	const int NumEvents = epoll_wait(m_EPoll, m_Events.data(), (int)m_Events.size(), timeout == WAIT_FOREVER ? -1 : (int)std::min<uint32_t>(timeout, INT32_MAX));
+
+	if (NumEvents <= 0)
+		return 0;
+
+	uint32_t NumReady = 0;
+
+	for (int i = 0; i < NumEvents; ++i)
+	{
+		CSocket *Socket = (CSocket *)m_Events[i].data.ptr;
+		const uint32_t Events = m_Events[i].events;
+
+		if (!Socket)
+		{
+			// reset the eventfd so the next Wake reports a new edge
+
+			uint64_t Count;
+
+			if (read(m_WakeFD, &Count, sizeof(Count)) == -1 && errno != EAGAIN)
+				LOG_ERROR(POLLER, "[POLLER] error (eventfd read) - {}", errno);
+
+			continue;
+		}
+
+		++NumReady;
+
+		// errors and hangups are reported as readable so the next recv picks them up
+
+		if (Events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+			Socket->SetReadable(true);
+
+		if (Events & (EPOLLOUT | EPOLLHUP | EPOLLERR))
+			Socket->SetWritable(true);
+	}
+
+	// the event list was full, there might be more waiting so make room for next time
+
+	if ((size_t)NumEvents == m_Events.size())
+		m_Events.resize(m_Events.size() * 2);
+
+	return NumReady;
+}
+
+void CEPollPoller::Wake()
+{
+	// write is async signal safe, a full counter (EAGAIN) means a wakeup is already pending
+
+	const uint64_t One = 1;
+
+	if (m_WakeFD != -1 && write(m_WakeFD, &One, sizeof(One)) == -1)
+		return;
+}
+
+#endif
+
+//
+// CSelectPoller
+//
+
+CSelectPoller::CSelectPoller()
+	: CPoller()
+{
+	if (!CreateSocketPair(m_Wake))
+	{
+		LOG_ERROR(POLLER, "[POLLER] error creating the wakeup socket pair - {}", GetLastError());
+		m_CanWake = false;
+	}
+}
+
+CSelectPoller::~CSelectPoller()
+{
+	if (m_Wake[0] != INVALID_SOCKET)
+	{
+		closesocket(m_Wake[0]);
+		closesocket(m_Wake[1]);
+	}
+}
+
+void CSelectPoller::Add(CSocket *socket)
+{
+	m_Sockets.push_back(socket);
+	++m_NumSockets;
+}
+
+void CSelectPoller::Remove(CSocket *socket)
+{
+	auto i = std::find(begin(m_Sockets), end(m_Sockets), socket);
+
+	if (i != end(m_Sockets))
+	{
+		m_Sockets.erase(i);
+		--m_NumSockets;
+	}
+}
+
+uint32_t CSelectPoller::Wait(uint32_t timeout)
+{
+	timeout = GetTimeout(timeout);
+
+	if (m_Sockets.empty() && !m_CanWake)
+	{
+		// select returns immediately without any sockets on some platforms so just sleep instead
+
+		MILLISLEEP(timeout);
+		return 0;
+	}
+
+	// select is level triggered, so to emulate the edge style flags we only ask about writability for sockets that are blocked on send
+
+	int32_t nfds = 0;
+	fd_set fd, send_fd;
+	FD_ZERO(&fd);
+	FD_ZERO(&send_fd);
+
+	if (m_CanWake)
+	{
+		FD_SET(m_Wake[0], &fd);
+#ifndef WIN32
+		nfds = m_Wake[0];
+#endif
+	}
+
+	for (auto & socket : m_Sockets)
+	{
+		FD_SET(socket->GetFD(), &fd);
+
+		if (!socket->IsWritable())
+			FD_SET(socket->GetFD(), &send_fd);
+
+#ifndef WIN32
+		if (socket->GetFD() > nfds)
+			nfds = socket->GetFD();
+#endif
+	}
+
+	struct timeval tv;
+	tv.tv_sec = timeout / 1000;
+	tv.tv_usec = (timeout % 1000) * 1000;
+
+	if (select(nfds + 1, &fd, &send_fd, nullptr, timeout == WAIT_FOREVER ? nullptr : &tv) <= 0)
+		return 0;
+
+	if (m_CanWake && FD_ISSET(m_Wake[0], &fd))
+	{
+		// throw away the wakeup bytes, one Wait handles every Wake since the last one
+
+		char Buffer[64];
+
+		while (recv(m_Wake[0], Buffer, sizeof(Buffer), 0) > 0)
+			;
+	}
+
+	uint32_t NumReady = 0;
+
+	for (auto & socket : m_Sockets)
+	{
+		bool Ready = false;
+
+		if (FD_ISSET(socket->GetFD(), &fd))
+		{
+			socket->SetReadable(true);
+			Ready = true;
+		}
+
+		if (FD_ISSET(socket->GetFD(), &send_fd))
+		{
+			socket->SetWritable(true);
+			Ready = true;
+		}
+
+		if (Ready)
+			++NumReady;
+	}
+
+	return NumReady;
+}
+
+void CSelectPoller::Wake()
+{
+	// send is async signal safe, a full buffer means a wakeup is already pending
+
+	if (m_CanWake)
+		send(m_Wake[1], "", 1, 0);
+}
@@ -0,0 +1,110 @@
+#ifndef AURA_POLLER_H_
+#define AURA_POLLER_H_
+
+#include "socket.h"
+
+#include <vector>
+#include <stdint.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+class CSocket;
+
+//
+// CPoller
+//
+// sockets register themselves once when they are created and unregister when they are closed
+// Wait blocks until at least one socket becomes ready (or the timeout expires) and marks the ready sockets
+// the readiness flags are edge style on every backend: a socket stays readable/writable until recv/send returns EWOULDBLOCK
+// another thread wakes a blocked Wait with Wake, e.g. when it hands the shard a new game or asks it to stop
+//
+
+class CPoller
+{
+public:
+	virtual ~CPoller();
+
+	virtual void Add(CSocket *socket) = 0;
+	virtual void Remove(CSocket *socket) = 0;
+
+	// wait at most timeout milliseconds (WAIT_FOREVER = until a socket is ready or Wake is called) and return the number of sockets that became ready
+
+	static const uint32_t WAIT_FOREVER = UINT32_MAX;
+
+	virtual uint32_t Wait(uint32_t timeout) = 0;
+
+	// make the current or the next Wait return right away, this can be called from any thread and from a signal handler
+
+	virtual void Wake() = 0;
+
+	inline uint32_t GetNumSockets() const                       { return m_NumSockets; }
+
+	// a socket stopped reading before it ran dry (see CTCPSocket::DoRecv)
+	// since the poller won't report it again the next Wait doesn't block so it gets another turn right away
+
+	inline void SetPending()                                    { m_Pending = true; }
+
+	// create the best backend available on this platform (epoll on linux, select everywhere else)
+
+	static CPoller *Create();
+
+protected:
+	CPoller();
+
+	uint32_t m_NumSockets;
+	bool m_Pending;
+	bool m_CanWake;                                             // false if the wakeup descriptor couldn't be created
+
+	// the timeout to actually use for this Wait (zero if a socket is pending)
+
+	uint32_t GetTimeout(uint32_t timeout);
+};
+
+#ifdef __linux__
+
+//
+// CEPollPoller
+//
+
+class CEPollPoller final : public CPoller
+{
+private:
+	int m_EPoll;
+	int m_WakeFD;                                               // an eventfd registered with a null pointer, written by Wake
+	std::vector<struct epoll_event> m_Events;
+
+public:
+	CEPollPoller();
+	~CEPollPoller();
+
+	void Add(CSocket *socket) override;
+	void Remove(CSocket *socket) override;
+	uint32_t Wait(uint32_t timeout) override;
+	void Wake() override;
+};
+
+#endif
+
+//
+// CSelectPoller
+//
+
+class CSelectPoller final : public CPoller
+{
+private:
+	std::vector<CSocket *> m_Sockets;
+	SOCKET m_Wake[2];                                           // a connected pair, Wake sends a byte to [1] and Wait selects on [0]
+
+public:
+	CSelectPoller();
+	~CSelectPoller();
+
+	void Add(CSocket *socket) override;
+	void Remove(CSocket *socket) override;
+	uint32_t Wait(uint32_t timeout) override;
+	void Wake() override;
+};
+
+#endif  // AURA_POLLER_H_
@@ -0,0 +1,336 @@
+#include "profiler.h"
+#include "logging.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+namespace
+{
+	const char *PhaseNames[PHASE_COUNT] = { "wait", "busy", "timers", "send_actions", "game_update", "recv", "parse", "send" };
+
+#ifdef WIN32
+	LARGE_INTEGER GetFrequency()
+	{
+		LARGE_INTEGER Frequency;
+		QueryPerformanceFrequency(&Frequency);
+		return Frequency;
+	}
+
+	const LARGE_INTEGER Frequency = GetFrequency();
+#endif
+
+	uint32_t GetHighestBit(uint64_t Value)
+	{
+#ifdef _MSC_VER
+		unsigned long Bit;
+
+		if (_BitScanReverse(&Bit, (unsigned long)(Value >> 32)))
+			return Bit + 32;
+
+		_BitScanReverse(&Bit, (unsigned long)Value);
+		return Bit;
+#else
+		return 63 - __builtin_clzll(Value);
+#endif
+	}
+
+	// microseconds with three decimals, which is what the trace format expects
+
+	std::string FormatMicroseconds(uint64_t Nanoseconds)
+	{
+		char Text[32];
+		sprintf(Text, "%llu.%03u", (unsigned long long)(Nanoseconds / 1000), (uint32_t)(Nanoseconds % 1000));
+		return Text;
+	}
+}
+
+uint64_t GetProfileTime()
+{
+#ifdef WIN32
+	LARGE_INTEGER Counter;
+	QueryPerformanceCounter(&Counter);
+
+	// split so the multiplication doesn't overflow
+
+	return (uint64_t)(Counter.QuadPart / Frequency.QuadPart) * 1000000000 + (uint64_t)(Counter.QuadPart % Frequency.QuadPart) * 1000000000 / Frequency.QuadPart;
+#else
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+#endif
+}
+
+//
+// CProfileHistogram
+//
+
+CProfileHistogram::CProfileHistogram()
+	: m_Count(0),
+	m_Sum(0),
+	m_Max(0)
+{
+	for (auto & bucket : m_Buckets)
+		bucket = 0;
+}
+
+uint32_t CProfileHistogram::GetBucket(uint64_t Value)
+{
+	if (Value < 16)
+		return (uint32_t)Value;
+
+	// the highest bit picks the power of two and the next 4 bits the bucket within it
+
+	const uint32_t Bit = GetHighestBit(Value);
+	return (Bit - 3) * 16 + (uint32_t)((Value >> (Bit - 4)) & 15);
+}
+
+uint64_t CProfileHistogram::GetBucketValue(uint32_t Bucket)
+{
+	if (Bucket < 16)
+		return Bucket;
+
+	const uint32_t Shift = Bucket / 16 - 1;
+	return ((uint64_t)(16 + Bucket % 16 + 1) << Shift) - 1;
+}
+
+void CProfileHistogram::Merge(uint64_t *Counts, uint64_t &Count, uint64_t &Sum, uint64_t &Max) const
+{
+	for (uint32_t i = 0; i < NUM_BUCKETS; ++i)
+		Counts[i] += m_Buckets[i].load(std::memory_order_relaxed);
+
+	Count += m_Count.load(std::memory_order_relaxed);
+	Sum += m_Sum.load(std::memory_order_relaxed);
+	Max = std::max(Max, m_Max.load(std::memory_order_relaxed));
+}
+
+//
+// CHistogramSnapshot
+//
+
+uint64_t CHistogramSnapshot::GetPercentile(double Quantile) const
+{
+	const uint64_t Rank = std::max<uint64_t>(1, (uint64_t)(Quantile * Count + 0.5));
+	uint64_t Seen = 0;
+
+	for (uint32_t i = 0; i < CProfileHistogram::NUM_BUCKETS; ++i)
+	{
+		Seen += Counts[i];
+
+		if (Seen >= Rank)
+			return std::min(Max, CProfileHistogram::GetBucketValue(i));
+	}
+
+	return Max;
+}
+
+//
+// CThreadProfile
+//
+
+CThreadProfile::CThreadProfile(const std::string &nName, uint32_t nID)
+	: m_Name(nName),
+	m_ID(nID),
+	m_Trace(TRACE_SIZE),
+	m_TraceHead(0)
+{
+	for (auto & event : m_Trace)
+	{
+		event.Start = 0;
+		event.Info = 0;
+	}
+}
+
+bool CThreadProfile::CopyTrace(uint64_t Since, std::vector<std::pair<uint64_t, uint64_t>> &Events) const
+{
+	// the newest event might still be being written so it's left out
+
+	const uint64_t Head = m_TraceHead.load(std::memory_order_acquire);
+	const uint64_t First = Head > TRACE_SIZE ? Head - TRACE_SIZE : 0;
+	const size_t Copied = Events.size();
+
+	for (uint64_t i = First; i + 1 < Head; ++i)
+	{
+		const CTraceEvent &Event = m_Trace[i & (TRACE_SIZE - 1)];
+		Events.push_back(std::make_pair(Event.Start.load(std::memory_order_relaxed), Event.Info.load(std::memory_order_relaxed)));
+	}
+
+	// the thread kept going while we copied, drop the events it might have overwritten by now
+
+	std::atomic_thread_fence(std::memory_order_acquire);
+	const uint64_t NewHead = m_TraceHead.load(std::memory_order_relaxed);
+	const uint64_t Overwritten = NewHead > TRACE_SIZE + First ? std::min<uint64_t>(NewHead - TRACE_SIZE - First, Events.size() - Copied) : 0;
+
+	Events.erase(Events.begin() + Copied, Events.begin() + Copied + (size_t)Overwritten);
+
+	// the ones that started too long ago
+
+	auto Start = std::find_if(Events.begin() + Copied, Events.end(), [Since](const std::pair<uint64_t, uint64_t> &Event) { return Event.first >= Since; });
+	Events.erase(Events.begin() + Copied, Start);
+	return NewHead <= TRACE_SIZE;
+}
+
+//
+// CProfiler
+//
+
+CProfiler::CProfiler(const std::string &nDirectory, uint32_t nTraceSeconds)
+	: m_Directory(nDirectory),
+	m_TraceSeconds(nTraceSeconds),
+	m_Dumping(false),
+	m_NextID(0)
+{
+	if (!m_Directory.empty() && m_Directory.back() != '/' && m_Directory.back() != '\\')
+		m_Directory += '/';
+}
+
+CProfiler::~CProfiler()
+{
+	if (m_DumpThread.joinable())
+		m_DumpThread.join();
+
+	for (auto & profile : m_Profiles)
+		delete profile;
+}
+
+CThreadProfile *CProfiler::CreateProfile(const std::string &Name)
+{
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	CThreadProfile *Profile = new CThreadProfile(Name, m_NextID++);
+	m_Profiles.push_back(Profile);
+	return Profile;
+}
+
+void CProfiler::DeleteProfile(CThreadProfile *Profile)
+{
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	m_Profiles.erase(std::remove(m_Profiles.begin(), m_Profiles.end(), Profile), m_Profiles.end());
+	delete Profile;
+}
+
+void CProfiler::Dump()
+{
+	if (m_Dumping)
+	{
+		LOG_WARNING(PROFILE, "[PROFILE] a dump is already in progress");
+		return;
+	}
+
+	if (m_DumpThread.joinable())
+		m_DumpThread.join();
+
+	m_Dumping = true;
+	const uint64_t Now = GetProfileTime();
+
+	m_DumpThread = std::thread([this, Now]() {
+		std::lock_guard<std::mutex> Lock(m_Mutex);
+		LogSummary();
+		WriteTrace(Now);
+		m_Dumping = false;
+	});
+}
+
+void CProfiler::LogSummary()
+{
+	LOG_INFO(PROFILE, "[PROFILE] timings since startup in microseconds");
+
+	for (const auto & profile : m_Profiles)
+	{
+		// how much of its time the thread spent doing something rather than waiting
+
+		const uint64_t Busy = profile->GetHistogram(PHASE_BUSY).GetSum();
+		const uint64_t Wait = profile->GetHistogram(PHASE_WAIT).GetSum();
+
+		if (Busy + Wait > 0)
+		{
+			char Share[16];
+			sprintf(Share, "%.1f%%", (double)Busy * 100 / (Busy + Wait));
+			LOG_INFO(PROFILE, "[PROFILE] {} was busy {} of the time", profile->GetName(), Share);
+		}
+	}
+
+	for (uint8_t Phase = 0; Phase < PHASE_COUNT; ++Phase)
+	{
+		CHistogramSnapshot Snapshot;
+
+		for (const auto & profile : m_Profiles)
+			Snapshot.Add(profile->GetHistogram(Phase));
+
+		if (Snapshot.Count == 0)
+			continue;
+
+		char Line[256];
+		sprintf(Line, "%-13s count %10llu  mean %10.1f  p50 %10.1f  p90 %10.1f  p99 %10.1f  p99.9 %10.1f  max %10.1f  total %.3f s", PhaseNames[Phase], (unsigned long long)Snapshot.Count, (double)Snapshot.Sum / Snapshot.Count / 1000,
+			(double)Snapshot.GetPercentile(0.5) / 1000, (double)Snapshot.GetPercentile(0.9) / 1000, (double)Snapshot.GetPercentile(0.99) / 1000, (double)Snapshot.GetPercentile(0.999) / 1000, (double)Snapshot.Max / 1000, (double)Snapshot.Sum / 1000000000);
+		LOG_INFO(PROFILE, "[PROFILE] {}", Line);
+	}
+}
+
+void CProfiler::WriteTrace(uint64_t Now)
+{
+	time_t Time = time(nullptr);
+	struct tm Local;
+#ifdef WIN32
+	localtime_s(&Local, &Time);
+#else
+	localtime_r(&Time, &Local);
+#endif
+	char Name[96];
+	sprintf(Name, "profile-%04d-%02d-%02d-%02d%02d%02d.json", Local.tm_year + 1900, Local.tm_mon + 1, Local.tm_mday, Local.tm_hour, Local.tm_min, Local.tm_sec);
+	const std::string FileName = m_Directory + Name;
+
+	std::ofstream out(FileName.c_str(), std::ios::trunc);
+
+	if (out.fail())
+	{
+		LOG_ERROR(PROFILE, "[PROFILE] unable to write the trace to [{}]", FileName);
+		return;
+	}
+
+	const uint64_t Since = Now - std::min<uint64_t>(Now, (uint64_t)m_TraceSeconds * 1000000000);
+	std::vector<std::pair<uint64_t, uint64_t>> Events;
+	uint64_t NumEvents = 0;
+
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << '\n';
+	out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"ydhost\"}}";
+
+	for (const auto & profile : m_Profiles)
+	{
+		const std::string Thread = "\"pid\":1,\"tid\":" + std::to_string(profile->GetID());
+		out << "," << '\n' << "{\"name\":\"thread_name\",\"ph\":\"M\"," << Thread << ",\"args\":{\"name\":\"" << profile->GetName() << "\"}}";
+
+		Events.clear();
+		const bool Complete = profile->CopyTrace(Since, Events);
+
+		if (!Complete && !Events.empty() && Events.front().first > Since + 1000000000)
+			LOG_INFO(PROFILE, "[PROFILE] the trace of {} only goes back {} seconds, it doesn't have room for more", profile->GetName(), (Now - Events.front().first) / 1000000000);
+
+		for (const auto & event : Events)
+		{
+			const uint8_t Phase = (uint8_t)(event.second >> 56);
+			const uint32_t HostCounter = (uint32_t)(event.second >> 32) & 0xFFFFFF;
+
+			if (Phase >= PHASE_COUNT)
+				continue;
+
+			out << "," << '\n' << "{\"name\":\"" << PhaseNames[Phase] << "\",\"ph\":\"X\"," << Thread << ",\"ts\":" << FormatMicroseconds(event.first) << ",\"dur\":" << FormatMicroseconds((uint32_t)event.second);
+
+			if (HostCounter != 0)
+				out << ",\"args\":{\"game\":" << HostCounter << "}";
+
+			out << "}";
+		}
+
+		NumEvents += Events.size();
+	}
+
+	out << '\n' << "]}" << '\n';
+	out.close();
+
+	LOG_INFO(PROFILE, "[PROFILE] wrote {} events from the last {} seconds to [{}]", NumEvents, m_TraceSeconds, FileName);
+}
@@ -0,0 +1,219 @@
+#ifndef AURA_PROFILER_H_
+#define AURA_PROFILER_H_
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+// the parts of an event loop iteration that are timed, nested phases are also counted in the phases around them
+
+enum ProfilePhase : uint8_t
+{
+	PHASE_WAIT,                                   // blocked in the poller waiting for a socket or the next timer
+	PHASE_BUSY,                                   // everything else in the iteration
+	PHASE_TIMERS,                                 // running the expired timers
+	PHASE_SEND_ACTIONS,                           // encoding and queueing an action batch (CGame::SendAllActions)
+	PHASE_GAME_UPDATE,                            // CGame::Update
+	PHASE_RECV,                                   // reading a socket (DoRecv)
+	PHASE_PARSE,                                  // framing and handling the received packets of a player
+	PHASE_SEND,                                   // flushing the players' send queues (CGame::UpdatePost)
+	PHASE_COUNT
+};
+
+// a monotonic clock in nanoseconds
+
+uint64_t GetProfileTime();
+
+//
+// CProfileHistogram
+//
+// a latency histogram with HDR style log linear buckets: values below 16 ns have their own bucket
+// and every power of two above that is split into 16 buckets so a bucket is at most 6.25% wide
+// only the owning thread adds values, other threads may read it at any time
+//
+
+class CProfileHistogram
+{
+public:
+	static const uint32_t NUM_BUCKETS = 61 * 16;
+
+private:
+	std::atomic<uint64_t> m_Buckets[NUM_BUCKETS];
+	std::atomic<uint64_t> m_Count;
+	std::atomic<uint64_t> m_Sum;
+	std::atomic<uint64_t> m_Max;
+
+	static uint32_t GetBucket(uint64_t Value);
+
+	// the owner is the only writer so an increment doesn't need a locked instruction
+
+	static inline void Add(std::atomic<uint64_t> &Counter, uint64_t Value)    { Counter.store(Counter.load(std::memory_order_relaxed) + Value, std::memory_order_relaxed); }
+
+public:
+	CProfileHistogram();
+
+	// the highest value that falls in a bucket
+
+	static uint64_t GetBucketValue(uint32_t Bucket);
+
+	inline uint64_t GetSum() const                          { return m_Sum.load(std::memory_order_relaxed); }
+
+	inline void Record(uint64_t Value)
+	{
+		Add(m_Buckets[GetBucket(Value)], 1);
+		Add(m_Count, 1);
+		Add(m_Sum, Value);
+
+		if (Value > m_Max.load(std::memory_order_relaxed))
+			m_Max.store(Value, std::memory_order_relaxed);
+	}
+
+	// add this histogram's values to Counts (NUM_BUCKETS entries) and the totals
+
+	void Merge(uint64_t *Counts, uint64_t &Count, uint64_t &Sum, uint64_t &Max) const;
+};
+
+//
+// CHistogramSnapshot
+//
+// a copy of one or more CProfileHistograms to compute percentiles from
+//
+
+struct CHistogramSnapshot
+{
+	std::vector<uint64_t> Counts;
+	uint64_t Count;
+	uint64_t Sum;
+	uint64_t Max;
+
+	CHistogramSnapshot() : Counts(CProfileHistogram::NUM_BUCKETS), Count(0), Sum(0), Max(0) { }
+
+	inline void Add(const CProfileHistogram &Histogram)     { Histogram.Merge(Counts.data(), Count, Sum, Max); }
+
+	// the highest value in the bucket the percentile falls in, so it's at most 6.25% too high
+
+	uint64_t GetPercentile(double Quantile) const;
+};
+
+//
+// CThreadProfile
+//
+// the phase timings of one event loop thread: a histogram per phase and a ring buffer of the most recent timed phases for the trace
+//
+
+class CThreadProfile
+{
+public:
+	static const uint32_t TRACE_SIZE = 1 << 17;   // 2 MB of trace per thread
+
+	struct CTraceEvent
+	{
+		std::atomic<uint64_t> Start;
+		std::atomic<uint64_t> Info;                 // the phase, the host counter and the duration (see Record)
+	};
+
+private:
+	std::string m_Name;
+	uint32_t m_ID;                                // the thread ID in the trace
+	CProfileHistogram m_Histograms[PHASE_COUNT];
+	std::vector<CTraceEvent> m_Trace;
+	std::atomic<uint64_t> m_TraceHead;            // the number of events ever added to m_Trace
+
+public:
+	CThreadProfile(const std::string &nName, uint32_t nID);
+	CThreadProfile(CThreadProfile &) = delete;
+
+	inline const std::string &GetName() const               { return m_Name; }
+	inline uint32_t GetID() const                           { return m_ID; }
+	inline const CProfileHistogram &GetHistogram(uint8_t Phase) const    { return m_Histograms[Phase]; }
+
+	inline void Record(uint8_t Phase, uint32_t HostCounter, uint64_t Start, uint64_t End)
+	{
+		const uint64_t Duration = End - Start;
+		m_Histograms[Phase].Record(Duration);
+
+		// the head moves before the event is written so a reader can tell which events might have been overwritten while it copied them
+
+		const uint64_t Head = m_TraceHead.load(std::memory_order_relaxed);
+		m_TraceHead.store(Head + 1, std::memory_order_release);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		CTraceEvent &Event = m_Trace[Head & (TRACE_SIZE - 1)];
+		Event.Start.store(Start, std::memory_order_relaxed);
+		Event.Info.store((uint64_t)Phase << 56 | (uint64_t)(HostCounter & 0xFFFFFF) << 32 | (Duration < 0xFFFFFFFF ? Duration : 0xFFFFFFFF), std::memory_order_relaxed);
+	}
+
+	// copy the events that started at or after Since, oldest first, each as Start and Info
+	// returns false if older events were already overwritten
+
+	bool CopyTrace(uint64_t Since, std::vector<std::pair<uint64_t, uint64_t>> &Events) const;
+};
+
+//
+// CProfileScope
+//
+// times the scope it's declared in as Phase, it does nothing when the profile is null (bot_profile = 0)
+//
+
+class CProfileScope
+{
+private:
+	CThreadProfile *m_Profile;
+	uint64_t m_Start;
+	uint32_t m_HostCounter;
+	uint8_t m_Phase;
+
+public:
+	CProfileScope(CThreadProfile *nProfile, uint8_t nPhase, uint32_t nHostCounter = 0)
+		: m_Profile(nProfile), m_Start(nProfile ? GetProfileTime() : 0), m_HostCounter(nHostCounter), m_Phase(nPhase) { }
+
+	~CProfileScope()
+	{
+		if (m_Profile)
+			m_Profile->Record(m_Phase, m_HostCounter, m_Start, GetProfileTime());
+	}
+
+	CProfileScope(CProfileScope &) = delete;
+};
+
+//
+// CProfiler
+//
+// keeps track of the profile of every event loop thread and dumps them on request (SIGUSR1, or SIGBREAK on Windows)
+// a dump logs a summary of each phase since startup and writes the last bot_profiletrace seconds as a Chrome trace (chrome://tracing or ui.perfetto.dev)
+// the dump runs on its own thread so the event loops don't stall while the trace is written
+//
+
+class CProfiler
+{
+private:
+	std::string m_Directory;                      // where the traces are written
+	uint32_t m_TraceSeconds;
+	std::mutex m_Mutex;                           // guards m_Profiles, held for the whole dump so a profile can't be deleted while it's read
+	std::vector<CThreadProfile *> m_Profiles;
+	std::thread m_DumpThread;
+	std::atomic<bool> m_Dumping;
+	uint32_t m_NextID;
+
+	void LogSummary();
+	void WriteTrace(uint64_t Now);
+
+public:
+	CProfiler(const std::string &nDirectory, uint32_t nTraceSeconds);
+	~CProfiler();
+	CProfiler(CProfiler &) = delete;
+
+	// a profile for each event loop, it's owned by the profiler
+
+	CThreadProfile *CreateProfile(const std::string &Name);
+	void DeleteProfile(CThreadProfile *Profile);
+
+	// start a dump unless one is already running, only call this from the main thread
+
+	void Dump();
+};
+
+#endif  // AURA_PROFILER_H_
@@ -0,0 +1,96 @@
+#include "relaystats.h"
+#include "logging.h"
+
+#include <cstdio>
+
+namespace
+{
+	// count, p50, p99, p99.9 and max in milliseconds
+
+	void FormatSnapshot(const CHistogramSnapshot &Snapshot, const char *Format, char *Text)
+	{
+		sprintf(Text, Format, (unsigned long long)Snapshot.Count, (double)Snapshot.GetPercentile(0.5) / 1000000, (double)Snapshot.GetPercentile(0.99) / 1000000,
+			(double)Snapshot.GetPercentile(0.999) / 1000000, (double)Snapshot.Max / 1000000);
+	}
+
+	std::string EscapeJSON(const std::string &Text)
+	{
+		std::string Escaped;
+
+		for (const auto & c : Text)
+		{
+			if (c == '"' || c == '\\')
+			{
+				Escaped += '\\';
+				Escaped += c;
+			}
+			else if ((unsigned char)c < 0x20)
+			{
+				char Code[8];
+				sprintf(Code, "\\u%04x", (unsigned char)c);
+				Escaped += Code;
+			}
+			else
+				Escaped += c;
+		}
+
+		return Escaped;
+	}
+}
+
+//
+// CRelayStats
+//
+
+CRelayStats::CRelayStats(const std::string &nGameName, uint32_t nHostCounter, uint32_t nLatency)
+	: m_GameName(nGameName),
+	m_HostCounter(nHostCounter),
+	m_Latency(nLatency),
+	m_LastSent(0)
+{
+
+}
+
+CRelayStats::~CRelayStats()
+{
+
+}
+
+void CRelayStats::LogSummary() const
+{
+	CHistogramSnapshot Intervals, Delays;
+	Intervals.Add(m_Intervals);
+	Delays.Add(m_Delays);
+
+	// the lobbies that never started have nothing to report
+
+	if (Intervals.Count == 0)
+		return;
+
+	const char *Format = "%llu, p50 %.2f ms, p99 %.2f ms, p99.9 %.2f ms, max %.2f ms";
+	char Text[160];
+
+	FormatSnapshot(Intervals, Format, Text);
+	LOG_INFO(GAME, "[GAME: {}] action batch intervals (bot_latency {} ms): {}", m_GameName, m_Latency, Text);
+
+	if (Delays.Count > 0)
+	{
+		FormatSnapshot(Delays, Format, Text);
+		LOG_INFO(GAME, "[GAME: {}] action queueing delays: {}", m_GameName, Text);
+	}
+}
+
+std::string CRelayStats::GetJSON() const
+{
+	CHistogramSnapshot Intervals, Delays;
+	Intervals.Add(m_Intervals);
+	Delays.Add(m_Delays);
+
+	const char *Format = "{\"count\":%llu,\"p50\":%.3f,\"p99\":%.3f,\"p99.9\":%.3f,\"max\":%.3f}";
+	char Interval[160], Delay[160];
+	FormatSnapshot(Intervals, Format, Interval);
+	FormatSnapshot(Delays, Format, Delay);
+
+	return "{\"game\":" + std::to_string(m_HostCounter) + ",\"name\":\"" + EscapeJSON(m_GameName) + "\",\"latency\":" + std::to_string(m_Latency) +
+		",\"action_interval_ms\":" + Interval + ",\"action_delay_ms\":" + Delay + "}";
+}
@@ -0,0 +1,59 @@
+#ifndef AURA_RELAYSTATS_H_
+#define AURA_RELAYSTATS_H_
+
+#include "profiler.h"
+
+#include <string>
+#include <stdint.h>
+
+//
+// CRelayStats
+//
+// how evenly a game relays the players' actions, to tune bot_latency with
+// the intervals are the time between two action batches, ideally always bot_latency
+// the delays are how long each action waited in the queue between arriving and being relayed, at most bot_latency plus however late the batch was
+// only the game's shard records values, the stats server reads them from the main thread while the game is running
+//
+
+class CRelayStats
+{
+private:
+	std::string m_GameName;
+	uint32_t m_HostCounter;
+	uint32_t m_Latency;                           // bot_latency in milliseconds
+	uint64_t m_LastSent;                          // GetProfileTime when the last batch was sent, 0 after the lag screen
+	CProfileHistogram m_Intervals;                // nanoseconds between two action batches
+	CProfileHistogram m_Delays;                   // nanoseconds each action waited in the queue
+
+public:
+	CRelayStats(const std::string &nGameName, uint32_t nHostCounter, uint32_t nLatency);
+	~CRelayStats();
+	CRelayStats(CRelayStats &) = delete;
+
+	inline const std::string &GetGameName() const           { return m_GameName; }
+	inline uint32_t GetHostCounter() const                  { return m_HostCounter; }
+
+	inline void RecordBatch(uint64_t Now)
+	{
+		if (m_LastSent != 0)
+			m_Intervals.Record(Now - m_LastSent);
+
+		m_LastSent = Now;
+	}
+
+	inline void RecordDelay(uint64_t Delay)                 { m_Delays.Record(Delay); }
+
+	// the batches stop while the lag screen is up, that pause isn't an interval
+
+	inline void ResetInterval()                             { m_LastSent = 0; }
+
+	// the summary logged when the game ends
+
+	void LogSummary() const;
+
+	// a JSON object with the game and both histograms in milliseconds
+
+	std::string GetJSON() const;
+};
+
+#endif  // AURA_RELAYSTATS_H_
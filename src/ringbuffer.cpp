@@ -0,0 +1,106 @@
+#include "ringbuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+//
+// CRingBuffer
+//
+
+CRingBuffer::CRingBuffer(uint32_t nCapacity)
+	: m_Data(nullptr),
+	m_Capacity(1),
+	m_Head(0),
+	m_Size(0)
+{
+	while (m_Capacity < nCapacity)
+		m_Capacity <<= 1;
+
+	m_Data = new uint8_t[m_Capacity];
+}
+
+CRingBuffer::~CRingBuffer()
+{
+	delete[] m_Data;
+}
+
+void CRingBuffer::Grow(uint32_t MinCapacity)
+{
+	uint32_t NewCapacity = m_Capacity;
+
+	while (NewCapacity < MinCapacity)
+		NewCapacity <<= 1;
+
+	// copy both halves to the front of the new storage
+
+	uint8_t *NewData = new uint8_t[NewCapacity];
+	const uint32_t First = ReadSize();
+	memcpy(NewData, m_Data + m_Head, First);
+	memcpy(NewData + First, m_Data, m_Size - First);
+
+	delete[] m_Data;
+	m_Data = NewData;
+	m_Capacity = NewCapacity;
+	m_Head = 0;
+}
+
+void CRingBuffer::Reserve(uint32_t Length)
+{
+	if (m_Capacity - m_Size < Length)
+		Grow(m_Size + Length);
+}
+
+void CRingBuffer::Commit(uint32_t Length)
+{
+	m_Size += Length;
+}
+
+void CRingBuffer::Consume(uint32_t Length)
+{
+	if (Length >= m_Size)
+	{
+		// start over at the front so the next write gets the longest possible span
+
+		m_Head = 0;
+		m_Size = 0;
+		return;
+	}
+
+	m_Head = (m_Head + Length) & (m_Capacity - 1);
+	m_Size -= Length;
+}
+
+void CRingBuffer::Append(const void *Data, uint32_t Length)
+{
+	Reserve(Length);
+
+	// this takes at most two copies, the second one for the part that wraps around
+
+	const uint8_t *Bytes = (const uint8_t *)Data;
+
+	while (Length > 0)
+	{
+		const uint32_t Chunk = std::min(Length, WriteSize());
+		memcpy(WritePtr(), Bytes, Chunk);
+		Commit(Chunk);
+		Bytes += Chunk;
+		Length -= Chunk;
+	}
+}
+
+const uint8_t *CRingBuffer::Linearize()
+{
+	if (m_Head + m_Size > m_Capacity)
+	{
+		std::rotate(m_Data, m_Data + m_Head, m_Data + m_Capacity);
+		m_Head = 0;
+	}
+
+	return m_Data + m_Head;
+}
+
+void CRingBuffer::Clear()
+{
+	m_Head = 0;
+	m_Size = 0;
+}
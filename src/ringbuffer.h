@@ -0,0 +1,79 @@
+#ifndef AURA_RINGBUFFER_H_
+#define AURA_RINGBUFFER_H_
+
+#include <stdint.h>
+
+//
+// CRingBuffer
+//
+// a byte FIFO used for the socket buffers
+// data is written at the back and consumed from the front without moving anything, the storage only moves when it has to grow
+// the capacity is always a power of two so wrapping around is a mask
+// the readable and writable regions are exposed as contiguous spans so recv/send can work on the storage directly:
+// at most two spans are needed to cover everything (the part up to the end of the storage and the part that wrapped around)
+//
+
+class CRingBuffer
+{
+private:
+	uint8_t *m_Data;
+	uint32_t m_Capacity;
+	uint32_t m_Head;                              // the offset of the first readable byte
+	uint32_t m_Size;                              // the number of readable bytes
+
+	void Grow(uint32_t MinCapacity);
+
+public:
+	explicit CRingBuffer(uint32_t nCapacity = 4096);
+	~CRingBuffer();
+	CRingBuffer(CRingBuffer &) = delete;
+
+	inline uint32_t GetSize() const                         { return m_Size; }
+	inline uint32_t GetCapacity() const                     { return m_Capacity; }
+	inline bool IsEmpty() const                             { return m_Size == 0; }
+
+	// the first contiguous readable span, there's more behind it when it's shorter than GetSize
+
+	inline const uint8_t *ReadPtr() const                   { return m_Data + m_Head; }
+	inline uint32_t ReadSize() const                        { return m_Head + m_Size <= m_Capacity ? m_Size : m_Capacity - m_Head; }
+
+	// the first contiguous writable span, call Reserve first to make sure there's enough room
+
+	inline uint8_t *WritePtr()                              { return m_Data + ((m_Head + m_Size) & (m_Capacity - 1)); }
+	inline uint32_t WriteSize() const
+	{
+		// the free space either runs from the tail to the end of the storage or (when the data wraps) from the tail to the head
+
+		const uint32_t Tail = m_Head + m_Size;
+		return Tail < m_Capacity ? m_Capacity - Tail : m_Capacity - m_Size;
+	}
+
+	// the byte at the given offset from the front
+
+	inline uint8_t operator[](uint32_t i) const             { return m_Data[(m_Head + i) & (m_Capacity - 1)]; }
+
+	// make sure at least Length bytes can be written without growing
+
+	void Reserve(uint32_t Length);
+
+	// mark Length bytes written to WritePtr as readable
+
+	void Commit(uint32_t Length);
+
+	// drop Length bytes from the front
+
+	void Consume(uint32_t Length);
+
+	// copy Length bytes to the back, growing if necessary
+
+	void Append(const void *Data, uint32_t Length);
+
+	// move the readable bytes so they're contiguous and return a pointer to them
+	// this only moves anything when the data currently wraps around
+
+	const uint8_t *Linearize();
+
+	void Clear();
+};
+
+#endif  // AURA_RINGBUFFER_H_
@@ -0,0 +1,137 @@
+#include "sendqueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+//
+// CSendQueue
+//
+
+CSendQueue::CSendQueue()
+	: m_Offset(0),
+	m_Size(0)
+{
+
+}
+
+CSendQueue::~CSendQueue()
+{
+
+}
+
+void CSendQueue::Push(const SHAREDBYTEARRAY &Packet)
+{
+	if (!Packet || Packet->empty())
+		return;
+
+	if (Packet->size() <= INLINE_SIZE)
+	{
+		// it's cheaper to copy a small packet than to keep a reference to it
+
+		Push(BYTEVIEW(*Packet));
+		return;
+	}
+
+	m_Packets.emplace_back();
+	m_Packets.back().Packet = Packet;
+	m_Packets.back().Length = (uint32_t)Packet->size();
+	m_Packets.back().Tail = nullptr;
+	m_Packets.back().TailLength = 0;
+	m_Size += (uint32_t)Packet->size();
+}
+
+void CSendQueue::Push(const BYTEVIEW &Data)
+{
+	if (Data.empty())
+		return;
+
+	if (Data.size() > INLINE_SIZE)
+	{
+		Push(std::make_shared<const BYTEARRAY>(begin(Data), end(Data)));
+		return;
+	}
+
+	Push(Data, BYTEVIEW());
+}
+
+void CSendQueue::Push(const BYTEVIEW &Header, const BYTEVIEW &Tail)
+{
+	if (Header.empty() && Tail.empty())
+		return;
+
+	m_Packets.emplace_back();
+	CEntry &Entry = m_Packets.back();
+
+	if (Header.size() <= INLINE_SIZE)
+		memcpy(Entry.Inline, Header.data(), Header.size());
+	else
+	{
+		// too big to be stored inline, the header gets a packet of its own so the tail still follows it on the wire
+
+		Entry.Packet = std::make_shared<const BYTEARRAY>(begin(Header), end(Header));
+	}
+
+	Entry.Length = Header.size();
+	Entry.Tail = Tail.data();
+	Entry.TailLength = Tail.size();
+	m_Size += Header.size() + Tail.size();
+}
+
+uint32_t CSendQueue::Gather(CSpan *Spans, uint32_t MaxSpans) const
+{
+	uint32_t NumSpans = 0;
+	uint32_t Offset = m_Offset;
+
+	for (auto i = begin(m_Packets); i != end(m_Packets) && NumSpans < MaxSpans; ++i)
+	{
+		if (Offset < i->Length)
+		{
+			Spans[NumSpans].Data = i->GetData() + Offset;
+			Spans[NumSpans].Length = i->Length - Offset;
+			++NumSpans;
+			Offset = 0;
+		}
+		else
+			Offset -= i->Length;
+
+		if (i->TailLength > 0 && NumSpans < MaxSpans)
+		{
+			Spans[NumSpans].Data = i->Tail + Offset;
+			Spans[NumSpans].Length = i->TailLength - Offset;
+			++NumSpans;
+		}
+
+		Offset = 0;
+	}
+
+	return NumSpans;
+}
+
+void CSendQueue::Consume(uint32_t Length)
+{
+	m_Size -= std::min(Length, m_Size);
+
+	while (Length > 0 && !m_Packets.empty())
+	{
+		const uint32_t Remaining = m_Packets.front().GetTotalLength() - m_Offset;
+
+		if (Length < Remaining)
+		{
+			m_Offset += Length;
+			return;
+		}
+
+		// the front packet is done, release it
+
+		Length -= Remaining;
+		m_Packets.pop_front();
+		m_Offset = 0;
+	}
+}
+
+void CSendQueue::Clear()
+{
+	m_Packets.clear();
+	m_Offset = 0;
+	m_Size = 0;
+}
@@ -0,0 +1,75 @@
+#ifndef AURA_SENDQUEUE_H_
+#define AURA_SENDQUEUE_H_
+
+#include "util.h"
+
+#include <deque>
+#include <stdint.h>
+
+//
+// CSendQueue
+//
+// the queue of packets waiting to be sent on a socket
+// packets are shared rather than copied so a packet sent to every player in a game is encoded and stored once
+// small packets are copied into the queue entry itself instead so queueing them doesn't allocate
+// an entry can also be followed by a tail which is sent straight from memory the queue doesn't own (e.g. a part of the mapped map file)
+// Gather exposes the queued bytes as a list of spans so they can go out in a single writev/WSASend call
+//
+
+class CSendQueue
+{
+public:
+	struct CSpan
+	{
+		const uint8_t *Data;
+		uint32_t Length;
+	};
+
+	static const uint32_t INLINE_SIZE = 32;     // packets up to this size are stored inline
+
+private:
+	struct CEntry
+	{
+		SHAREDBYTEARRAY Packet;                     // null when the data is stored inline
+		uint8_t Inline[INLINE_SIZE];
+		uint32_t Length;                            // the length of the packet or the inline data
+		const uint8_t *Tail;                        // sent after the packet without being copied, it must outlive the queue
+		uint32_t TailLength;
+
+		inline const uint8_t *GetData() const             { return Packet ? Packet->data() : Inline; }
+		inline uint32_t GetTotalLength() const            { return Length + TailLength; }
+	};
+
+	std::deque<CEntry> m_Packets;
+	uint32_t m_Offset;                            // the number of bytes of the front packet that have already been sent
+	uint32_t m_Size;                              // the number of bytes waiting to be sent
+
+public:
+	CSendQueue();
+	~CSendQueue();
+	CSendQueue(CSendQueue &) = delete;
+
+	inline uint32_t GetSize() const                         { return m_Size; }
+	inline bool IsEmpty() const                             { return m_Size == 0; }
+
+	void Push(const SHAREDBYTEARRAY &Packet);
+	void Push(const BYTEVIEW &Data);
+
+	// queue a copy of Header followed by Tail which is only referenced
+	// a Header of up to INLINE_SIZE bytes is stored inline, a longer one costs an allocation
+
+	void Push(const BYTEVIEW &Header, const BYTEVIEW &Tail);
+
+	// fill Spans with up to MaxSpans spans of unsent data in order and return how many were filled
+	// each entry needs up to two spans, one for the packet and one for the tail
+
+	uint32_t Gather(CSpan *Spans, uint32_t MaxSpans) const;
+
+	// drop Length sent bytes from the front
+
+	void Consume(uint32_t Length);
+
+	void Clear();
+};
+
+#endif  // AURA_SENDQUEUE_H_
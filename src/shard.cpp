@@ -0,0 +1,168 @@
+#include "shard.h"
+#include "socket.h"
+#include "poller.h"
+#include "timerwheel.h"
+#include "game.h"
+#include "profiler.h"
+#include "statsserver.h"
+#include "logging.h"
+
+#ifndef WIN32
+#include <csignal>
+#include <pthread.h>
+#endif
+
+uint32_t GetTicks();
+//
+// CShard
+//
+
+CShard::CShard(uint32_t nID, CBandwidthManager *nBandwidth, CEventLog *nEventLog, CProfiler *nProfiler, CStatsServer *nStats)
+	: m_ID(nID),
+	m_UDPSocket(new CUDPSocket()),
+	m_Poller(CPoller::Create()),
+	m_Timers(new CTimerWheel(GetTicks())),
+	m_Bandwidth(nBandwidth),
+	m_EventLog(nEventLog),
+	m_Profiler(nProfiler),
+	m_Profile(nProfiler ? nProfiler->CreateProfile("shard " + std::to_string(nID)) : nullptr),
+	m_Stats(nStats),
+	m_NumGames(0),
+	m_Exiting(false)
+{
+	m_UDPSocket->SetBroadcastTarget(std::string());
+	m_UDPSocket->SetDontRoute(false);
+}
+
+CShard::~CShard()
+{
+	Stop();
+
+	// the games' sockets and timers unregister themselves from the poller and the timer wheel so delete those last
+
+	for (auto & game : m_Games)
+	{
+		if (m_Stats)
+			m_Stats->Unregister(game->GetRelayStats());
+
+		delete game;
+	}
+
+	delete m_Timers;
+	delete m_Poller;
+	delete m_UDPSocket;
+
+	if (m_Profiler)
+		m_Profiler->DeleteProfile(m_Profile);
+}
+
+void CShard::AddGame(const CMap *Map, const CGameConfig *Config, uint32_t HostCounter)
+{
+	std::lock_guard<std::mutex> Lock(m_PendingMutex);
+	m_PendingGames.push_back(CPendingGame{ Map, Config, HostCounter });
+	++m_NumGames;
+	Wake();
+}
+
+void CShard::Start()
+{
+	LOG_INFO(SHARD, "[SHARD {}] starting event loop thread", m_ID);
+
+#ifndef WIN32
+	// the thread inherits our signal mask so block the signals aura catches while creating it
+	// that way they're always delivered to the main thread and never interrupt a shard in the middle of an update
+
+	sigset_t Signals, OldSignals;
+	sigemptyset(&Signals);
+	sigaddset(&Signals, SIGINT);
+	sigaddset(&Signals, SIGUSR1);
+	pthread_sigmask(SIG_BLOCK, &Signals, &OldSignals);
+	m_Thread = std::thread(&CShard::Run, this);
+	pthread_sigmask(SIG_SETMASK, &OldSignals, nullptr);
+#else
+	m_Thread = std::thread(&CShard::Run, this);
+#endif
+}
+
+void CShard::Stop()
+{
+	m_Exiting = true;
+	Wake();
+
+	if (m_Thread.joinable())
+		m_Thread.join();
+}
+
+void CShard::Wake()
+{
+	m_Poller->Wake();
+}
+
+void CShard::Run()
+{
+	while (!m_Exiting)
+		Update();
+}
+
+void CShard::Update()
+{
+	// create the games that were queued since the last update
+
+	std::vector<CPendingGame> PendingGames;
+
+	{
+		std::lock_guard<std::mutex> Lock(m_PendingMutex);
+		PendingGames.swap(m_PendingGames);
+	}
+
+	for (auto & pending : PendingGames)
+	{
+		CGame *Game = new CGame(pending.Map, pending.Config, m_UDPSocket, m_Poller, m_Timers, m_Bandwidth, m_EventLog, m_Profile, pending.HostCounter);
+		m_Games.push_back(Game);
+
+		if (m_Stats)
+			m_Stats->Register(Game->GetRelayStats());
+	}
+
+	// block until any of our sockets becomes ready, the next timer (e.g. the next action batch) is due or AddGame or Stop wakes us
+	// the poller marks the ready sockets so the games only touch those
+
+	{
+		CProfileScope WaitScope(m_Profile, PHASE_WAIT);
+		m_Poller->Wait(m_Timers->GetNextTimeout(GetTicks(), CPoller::WAIT_FOREVER));
+	}
+
+	CProfileScope BusyScope(m_Profile, PHASE_BUSY);
+
+	// run the timers that expired while we were waiting
+
+	{
+		CProfileScope TimersScope(m_Profile, PHASE_TIMERS);
+		m_Timers->Advance(GetTicks());
+	}
+
+	// update running games
+
+	for (auto i = begin(m_Games); i != end(m_Games);)
+	{
+		if ((*i)->Update())
+		{
+			LOG_INFO(AURA, "[AURA] deleting game [{}]", (*i)->GetGameName());
+
+			if (m_Stats)
+				m_Stats->Unregister((*i)->GetRelayStats());
+
+			delete *i;
+			i = m_Games.erase(i);
+			--m_NumGames;
+
+			if (m_OnGameDeleted)
+				m_OnGameDeleted();
+		}
+		else
+		{
+			(*i)->UpdatePost();
+			++i;
+		}
+	}
+}
@@ -0,0 +1,90 @@
+#ifndef AURA_SHARD_H_
+#define AURA_SHARD_H_
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+//
+// CShard
+//
+// an event loop with its own poller, timer wheel, UDP socket and games
+// nothing a shard owns is touched by any other thread, the only shared state is the read only CMap and the thread safe CBandwidthManager, CEventLog and CStatsServer
+// new games are handed over through a queue and constructed on the shard's own thread so their sockets end up in its poller
+// the shard sleeps in its poller until a socket or a timer is ready, AddGame and Stop wake it up
+//
+
+class CUDPSocket;
+class CPoller;
+class CTimerWheel;
+class CGame;
+class CMap;
+class CBandwidthManager;
+class CEventLog;
+class CProfiler;
+class CThreadProfile;
+class CStatsServer;
+struct CGameConfig;
+
+class CShard
+{
+private:
+	struct CPendingGame
+	{
+		const CMap *Map;
+		const CGameConfig *Config;
+		uint32_t HostCounter;
+	};
+
+	uint32_t m_ID;
+	CUDPSocket *m_UDPSocket;                      // a UDP socket for sending broadcasts
+	CPoller *m_Poller;                            // every TCP socket of this shard's games is registered here
+	CTimerWheel *m_Timers;                        // every timer of this shard's games is registered here
+	CBandwidthManager *m_Bandwidth;               // the global map upload budget (owned by CAura)
+	CEventLog *m_EventLog;                        // the binary event log, null if it's off (owned by CAura)
+	CProfiler *m_Profiler;                        // null if it's off (owned by CAura)
+	CThreadProfile *m_Profile;                    // the timings of this shard's event loop, null if the profiler is off
+	CStatsServer *m_Stats;                        // every game's relay stats are registered here, null if bot_statsport isn't set (owned by CAura)
+	std::vector<CGame *> m_Games;                 // these games are in progress
+	std::mutex m_PendingMutex;
+	std::vector<CPendingGame> m_PendingGames;     // games queued by AddGame that haven't been created yet
+	std::atomic<uint32_t> m_NumGames;             // the number of games in progress or pending (for placing new games)
+	std::atomic<bool> m_Exiting;
+	std::function<void()> m_OnGameDeleted;        // called on our thread after a game was deleted
+	std::thread m_Thread;
+
+	void Run();
+
+public:
+	CShard(uint32_t nID, CBandwidthManager *nBandwidth, CEventLog *nEventLog, CProfiler *nProfiler, CStatsServer *nStats);
+	~CShard();
+	CShard(CShard &) = delete;
+
+	inline uint32_t GetID() const                 { return m_ID; }
+	inline uint32_t GetNumGames() const           { return m_NumGames; }
+	inline CPoller *GetPoller() const             { return m_Poller; }
+	inline CTimerWheel *GetTimers() const         { return m_Timers; }
+
+	// set this before Start
+
+	inline void SetOnGameDeleted(const std::function<void()> &nOnGameDeleted)    { m_OnGameDeleted = nOnGameDeleted; }
+
+	// these can be called from any thread
+
+	void AddGame(const CMap *Map, const CGameConfig *Config, uint32_t HostCounter);
+	void Start();
+	void Stop();
+
+	// interrupt the poller wait, this is async signal safe
+
+	void Wake();
+
+	// run one iteration of the event loop, either from our own thread (after Start) or from the main thread
+
+	void Update();
+};
+
+#endif  // AURA_SHARD_H_
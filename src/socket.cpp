@@ -18,7 +18,10 @@ CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
 */
 
 #include "socket.h"
+#include "poller.h"
+#include "logging.h"
 
+#include <algorithm>
 #include <string.h>
 
 #ifndef WIN32
@@ -29,33 +32,37 @@ int32_t GetLastError()
 #endif
 
 uint32_t GetTicks();
-void Print(const std::string &message);
-
 //
 // CSocket
 //
 
-CSocket::CSocket()
+CSocket::CSocket(CPoller *nPoller)
 	: m_Socket(INVALID_SOCKET),
+	m_Poller(nPoller),
 	m_HasError(false),
+	m_Readable(false),
+	m_Writable(true),
 	m_Error(0)
 {
 	memset(&m_SIN, 0, sizeof(m_SIN));
 }
 
-CSocket::CSocket(SOCKET nSocket, struct sockaddr_in nSIN)
+CSocket::CSocket(SOCKET nSocket, struct sockaddr_in nSIN, CPoller *nPoller)
 	: m_Socket(nSocket),
 	m_SIN(nSIN),
+	m_Poller(nPoller),
 	m_HasError(false),
+	m_Readable(false),
+	m_Writable(true),
 	m_Error(0)
 {
-
+	if (m_Poller && m_Socket != INVALID_SOCKET)
+		m_Poller->Add(this);
 }
 
 CSocket::~CSocket()
 {
-	if (m_Socket != INVALID_SOCKET)
-		closesocket(m_Socket);
+	Close();
 }
 
 std::string CSocket::GetErrorString() const
@@ -63,7 +70,12 @@ std::string CSocket::GetErrorString() const
 	if (!m_HasError)
 		return "NO ERROR";
 
-	switch (m_Error)
+	return GetErrorString(m_Error);
+}
+
+std::string CSocket::GetErrorString(int Error)
+{
+	switch (Error)
 	{
 	case EWOULDBLOCK: return "EWOULDBLOCK";
 	case EINPROGRESS: return "EINPROGRESS";
@@ -101,23 +113,13 @@ std::string CSocket::GetErrorString() const
 	case ESTALE: return "ESTALE";
 	case EREMOTE: return "EREMOTE";
 	case ECONNRESET: return "Connection reset by peer";
-	}
-
-	return "UNKNOWN ERROR (" + std::to_string(m_Error) + ")";
-}
-
-void CSocket::SetFD(fd_set *fd, fd_set *send_fd, int *nfds)
-{
-	if (m_Socket == INVALID_SOCKET)
-		return;
-
-	FD_SET(m_Socket, fd);
-	FD_SET(m_Socket, send_fd);
-
+	case EMFILE: return "EMFILE";
 #ifndef WIN32
-	if (m_Socket > *nfds)
-		*nfds = m_Socket;
+	case ENFILE: return "ENFILE";
 #endif
+	}
+
+	return "UNKNOWN ERROR (" + std::to_string(Error) + ")";
 }
 
 void CSocket::Allocate(int type)
@@ -128,17 +130,34 @@ void CSocket::Allocate(int type)
 	{
 		m_HasError = true;
 		m_Error = GetLastError();
-		Print("[SOCKET] error (socket) - " + GetErrorString());
+		LOG_ERROR(SOCKET, "[SOCKET] error (socket) - {}", GetErrorString());
 		return;
 	}
+
+	if (m_Poller)
+		m_Poller->Add(this);
 }
 
-void CSocket::Reset()
+void CSocket::Close()
 {
-	if (m_Socket != INVALID_SOCKET)
-		closesocket(m_Socket);
+	if (m_Socket == INVALID_SOCKET)
+		return;
+
+	// unregister before closing because the descriptor number may be reused right away
 
+	if (m_Poller)
+		m_Poller->Remove(this);
+
+	closesocket(m_Socket);
 	m_Socket = INVALID_SOCKET;
+	m_Readable = false;
+	m_Writable = true;
+}
+
+void CSocket::Reset()
+{
+	Close();
+
 	memset(&m_SIN, 0, sizeof(m_SIN));
 	m_HasError = false;
 	m_Error = 0;
@@ -148,8 +167,11 @@ void CSocket::Reset()
 // CTCPSocket
 //
 
-CTCPSocket::CTCPSocket()
-	: CSocket(),
+uint32_t CTCPSocket::m_RecvChunkSize = 16384;
+uint32_t CTCPSocket::m_RecvBudget = 65536;
+
+CTCPSocket::CTCPSocket(CPoller *nPoller)
+	: CSocket(nPoller),
 	m_LastRecv(GetTicks()),
 	m_Connected(false)
 {
@@ -170,8 +192,8 @@ CTCPSocket::CTCPSocket()
 	setsockopt(m_Socket, IPPROTO_TCP, TCP_NODELAY, (const char *)&OptVal, sizeof(int32_t));
 }
 
-CTCPSocket::CTCPSocket(SOCKET nSocket, struct sockaddr_in nSIN)
-	: CSocket(nSocket, nSIN),
+CTCPSocket::CTCPSocket(SOCKET nSocket, struct sockaddr_in nSIN, CPoller *nPoller)
+	: CSocket(nSocket, nSIN, nPoller),
 	m_LastRecv(GetTicks()),
 	m_Connected(true)
 {
@@ -187,8 +209,13 @@ CTCPSocket::CTCPSocket(SOCKET nSocket, struct sockaddr_in nSIN)
 
 CTCPSocket::~CTCPSocket()
 {
-	if (m_Socket != INVALID_SOCKET)
-		closesocket(m_Socket);
+
+}
+
+void CTCPSocket::SetRecvLimits(uint32_t ChunkSize, uint32_t Budget)
+{
+	m_RecvChunkSize = std::max(ChunkSize, 512u);
+	m_RecvBudget = std::max(Budget, m_RecvChunkSize);
 }
 
 void CTCPSocket::Reset()
@@ -197,8 +224,8 @@ void CTCPSocket::Reset()
 	Allocate(SOCK_STREAM);
 
 	m_Connected = false;
-	m_RecvBuffer.clear();
-	m_SendBuffer.clear();
+	m_RecvBuffer.Clear();
+	m_SendBuffer.Clear();
 	m_LastRecv = GetTicks();
 
 	// make socket non blocking
@@ -211,68 +238,131 @@ void CTCPSocket::Reset()
 #endif
 }
 
-void CTCPSocket::DoRecv(fd_set *fd)
+void CTCPSocket::DoRecv()
 {
-	if (m_Socket == INVALID_SOCKET || m_HasError || !m_Connected)
+	if (m_Socket == INVALID_SOCKET || m_HasError || !m_Connected || !m_Readable)
 		return;
 
-	if (FD_ISSET(m_Socket, fd))
+	// the poller only reports new data once so keep reading until the socket runs dry
+	// we receive straight into the free space of the buffer so there's no intermediate copy
+	// a single socket may only read m_RecvBudget bytes per call so a flooding client can't starve everyone else
+	// when the budget runs out the socket stays readable and the poller is told not to block so we come back to it next loop
+
+	uint32_t Budget = m_RecvBudget;
+
+	while (true)
 	{
-		// data is waiting, receive it
+		if (Budget == 0)
+		{
+			if (m_Poller)
+				m_Poller->SetPending();
+
+			return;
+		}
 
-		char buffer[1024];
-		int32_t c = recv(m_Socket, buffer, 1024, 0);
+		m_RecvBuffer.Reserve(std::min(m_RecvChunkSize, Budget));
+		int32_t c = recv(m_Socket, (char *)m_RecvBuffer.WritePtr(), (int32_t)std::min(m_RecvBuffer.WriteSize(), Budget), 0);
 
 		if (c > 0)
 		{
 			// success! add the received data to the buffer
 
-			m_RecvBuffer += std::string(buffer, c);
+			m_RecvBuffer.Commit(c);
 			m_LastRecv = GetTicks();
+			Budget -= c;
 		}
-		else if (c == SOCKET_ERROR && GetLastError() != EWOULDBLOCK)
+		else if (c == SOCKET_ERROR && GetLastError() == EINTR)
+			continue;
+		else if (c == SOCKET_ERROR && GetLastError() == EWOULDBLOCK)
+		{
+			// nothing left to read, wait for the poller to tell us about more data
+
+			m_Readable = false;
+			return;
+		}
+		else if (c == SOCKET_ERROR)
 		{
 			// receive error
 
 			m_HasError = true;
 			m_Error = GetLastError();
-			Print("[TCPSOCKET] error (recv) - " + GetErrorString());
+			LOG_ERROR(SOCKET, "[TCPSOCKET] error (recv) - {}", GetErrorString());
 			return;
 		}
-		else if (c == 0)
+		else
 		{
 			// the other end closed the connection
 
-			Print("[TCPSOCKET] closed by remote host");
+			LOG_INFO(SOCKET, "[TCPSOCKET] closed by remote host");
 			m_Connected = false;
+			return;
 		}
 	}
 }
 
-void CTCPSocket::DoSend(fd_set *send_fd)
+void CTCPSocket::DoSend()
 {
-	if (m_Socket == INVALID_SOCKET || m_HasError || !m_Connected || m_SendBuffer.empty())
+	if (m_Socket == INVALID_SOCKET || m_HasError || !m_Connected || m_SendBuffer.IsEmpty() || !m_Writable)
 		return;
 
-	if (FD_ISSET(m_Socket, send_fd))
+	// hand as many queued packets as possible to the kernel in one call instead of copying them into a contiguous buffer first
+
+	CSendQueue::CSpan Spans[64];
+
+	while (!m_SendBuffer.IsEmpty())
 	{
-		// socket is ready, send it
+		const uint32_t NumSpans = m_SendBuffer.Gather(Spans, 64);
+
+#ifdef WIN32
+		WSABUF Buffers[64];
 
-		int32_t s = send(m_Socket, m_SendBuffer.c_str(), (int32_t)m_SendBuffer.size(), MSG_NOSIGNAL);
+		for (uint32_t i = 0; i < NumSpans; ++i)
+		{
+			Buffers[i].buf = (char *)Spans[i].Data;
+			Buffers[i].len = Spans[i].Length;
+		}
+
+		DWORD Sent = 0;
+		int32_t s = WSASend(m_Socket, Buffers, NumSpans, &Sent, 0, nullptr, nullptr) == 0 ? (int32_t)Sent : SOCKET_ERROR;
+#else
+		struct iovec Buffers[64];
+
+		for (uint32_t i = 0; i < NumSpans; ++i)
+		{
+			Buffers[i].iov_base = (void *)Spans[i].Data;
+			Buffers[i].iov_len = Spans[i].Length;
+		}
+
+		struct msghdr Message;
+		memset(&Message, 0, sizeof(Message));
+		Message.msg_iov = Buffers;
+		Message.msg_iovlen = NumSpans;
+
+		int32_t s = sendmsg(m_Socket, &Message, MSG_NOSIGNAL);
+#endif
 
 		if (s > 0)
 		{
-			// success! only some of the data may have been sent, remove it from the buffer
+			// success! only some of the data may have been sent, drop it from the front of the queue
+
+			m_SendBuffer.Consume(s);
+		}
+		else if (s == SOCKET_ERROR && GetLastError() == EINTR)
+			continue;
+		else if (s == SOCKET_ERROR && GetLastError() == EWOULDBLOCK)
+		{
+			// the kernel buffer is full, wait for the poller to tell us when it drains
 
-			m_SendBuffer = m_SendBuffer.substr(s);
+			m_Writable = false;
+			return;
 		}
-		else if (s == SOCKET_ERROR && GetLastError() != EWOULDBLOCK)
+		else
 		{
 			// send error
 
 			m_HasError = true;
 			m_Error = GetLastError();
-			Print("[TCPSOCKET] error (send) - " + GetErrorString());
+			LOG_ERROR(SOCKET, "[TCPSOCKET] error (send) - {}", GetErrorString());
 			return;
 		}
 	}
@@ -291,7 +381,7 @@ void CTCPSocket::Disconnect()
 //
 
 CTCPClient::CTCPClient()
-	: CTCPSocket(),
+	: CTCPSocket(nullptr),
 	m_Connecting(false)
 {
 
@@ -299,8 +389,7 @@ CTCPClient::CTCPClient()
 
 CTCPClient::~CTCPClient()
 {
-	if (m_Socket != INVALID_SOCKET)
-		closesocket(m_Socket);
+
 }
 
 void CTCPClient::Reset()
@@ -338,7 +427,7 @@ void CTCPClient::Connect(const std::string &localaddress, const std::string &add
 		{
 			m_HasError = true;
 			m_Error = GetLastError();
-			Print("[TCPCLIENT] error (bind) - " + GetErrorString());
+			LOG_ERROR(SOCKET, "[TCPCLIENT] error (bind) - {}", GetErrorString());
 			return;
 		}
 	}
@@ -353,7 +442,7 @@ void CTCPClient::Connect(const std::string &localaddress, const std::string &add
 	{
 		m_HasError = true;
 		// m_Error = h_error;
-		Print("[TCPCLIENT] error (gethostbyname)");
+		LOG_ERROR(SOCKET, "[TCPCLIENT] error (gethostbyname)");
 		return;
 	}
 
@@ -373,7 +462,7 @@ void CTCPClient::Connect(const std::string &localaddress, const std::string &add
 
 			m_HasError = true;
 			m_Error = GetLastError();
-			Print("[TCPCLIENT] error (connect) - " + GetErrorString());
+			LOG_ERROR(SOCKET, "[TCPCLIENT] error (connect) - {}", GetErrorString());
 			return;
 		}
 	}
@@ -417,22 +506,26 @@ bool CTCPClient::CheckConnect()
 	return false;
 }
 
-void CTCPClient::DoRecv(fd_set *fd)
+void CTCPClient::DoRecv()
 {
-	CTCPSocket::DoRecv(fd);
+	CTCPSocket::DoRecv();
 }
 
-void CTCPClient::DoSend(fd_set *send_fd)
+void CTCPClient::DoSend()
 {
-	CTCPSocket::DoSend(send_fd);
+	CTCPSocket::DoSend();
 }
 
 //
 // CTCPServer
 //
 
-CTCPServer::CTCPServer()
-	: CTCPSocket()
+CTCPServer::CTCPServer(CPoller *nPoller)
+	: CTCPSocket(nPoller),
+#ifndef WIN32
+	m_SpareFD(open("/dev/null", O_RDONLY)),
+#endif
+	m_AcceptFailing(false)
 {
 	// make socket non blocking
 
@@ -456,8 +549,10 @@ CTCPServer::CTCPServer()
 
 CTCPServer::~CTCPServer()
 {
-	if (m_Socket != INVALID_SOCKET)
-		closesocket(m_Socket);
+#ifndef WIN32
+	if (m_SpareFD != -1)
+		close(m_SpareFD);
+#endif
 }
 
 bool CTCPServer::Listen(const std::string &address, uint16_t& port)
@@ -481,12 +576,16 @@ bool CTCPServer::Listen(const std::string &address, uint16_t& port)
 	{
 		m_HasError = true;
 		m_Error = GetLastError();
-		Print("[TCPSERVER] error (bind) - " + GetErrorString());
+		LOG_ERROR(SOCKET, "[TCPSERVER] error (bind) - {}", GetErrorString());
 		return false;
 	}
 
 	sockaddr_in addr;
+#ifdef WIN32
 	int addrlen = sizeof(sockaddr_in);
+#else
+	socklen_t addrlen = sizeof(sockaddr_in);
+#endif
 	::getsockname(m_Socket, (sockaddr*)&addr, &addrlen);
 	port = ::ntohs(addr.sin_port);
 
@@ -496,22 +595,23 @@ bool CTCPServer::Listen(const std::string &address, uint16_t& port)
 	{
 		m_HasError = true;
 		m_Error = GetLastError();
-		Print("[TCPSERVER] error (listen) - " + GetErrorString());
+		LOG_ERROR(SOCKET, "[TCPSERVER] error (listen) - {}", GetErrorString());
 		return false;
 	}
 
 	return true;
 }
 
-CTCPSocket *CTCPServer::Accept(fd_set *fd)
+CTCPSocket *CTCPServer::Accept()
 {
-	if (m_Socket == INVALID_SOCKET || m_HasError)
+	if (m_Socket == INVALID_SOCKET || m_HasError || !m_Readable)
 		return nullptr;
 
-	if (FD_ISSET(m_Socket, fd))
-	{
-		// a connection is waiting, accept it
+	// a connection may be waiting, accept it
+	// the caller keeps calling this until it returns nullptr since the poller only reports new connections once
 
+	while (true)
+	{
 		struct sockaddr_in Addr;
 		int32_t AddrLen = sizeof(Addr);
 		SOCKET NewSocket;
@@ -524,11 +624,57 @@ CTCPSocket *CTCPServer::Accept(fd_set *fd)
 		{
 			// success! return the new socket
 
-			return new CTCPSocket(NewSocket, Addr);
+			m_AcceptFailing = false;
+			return new CTCPSocket(NewSocket, Addr, m_Poller);
 		}
-	}
 
-	return nullptr;
+		const int32_t Error = GetLastError();
+
+		// the client gave up before we got to it, there may be more connections behind it
+
+		if (Error == EINTR || Error == ECONNABORTED)
+			continue;
+
+		if (Error == EWOULDBLOCK || Error == EAGAIN)
+		{
+			// nothing left to accept, wait for the poller to tell us about the next connection
+
+			m_Readable = false;
+			return nullptr;
+		}
+
+		// e.g. out of file descriptors (EMFILE, ENFILE) or buffers (ENOBUFS), only logged once until a connection gets through again
+
+		if (!m_AcceptFailing)
+		{
+			m_AcceptFailing = true;
+			LOG_ERROR(SOCKET, "[TCPSERVER] error (accept) - {}, new connections are dropped until it clears", GetErrorString(Error));
+		}
+
+#ifndef WIN32
+		if ((Error == EMFILE || Error == ENFILE) && m_SpareFD != -1)
+		{
+			// give up the spare descriptor to take the connection off the queue and close it right away
+			// otherwise it stays at the front of the queue, the socket stays readable and every loop would retry it without waiting
+
+			close(m_SpareFD);
+			const SOCKET Dropped = accept(m_Socket, nullptr, nullptr);
+
+			if (Dropped != INVALID_SOCKET)
+				close(Dropped);
+
+			m_SpareFD = open("/dev/null", O_RDONLY);
+
+			if (Dropped != INVALID_SOCKET)
+				continue;
+		}
+#endif
+
+		// nothing more can be done for the connection now, try again when the poller reports the socket instead of spinning on it
+
+		m_Readable = false;
+		return nullptr;
+	}
 }
 
 //
@@ -536,7 +682,7 @@ CTCPSocket *CTCPServer::Accept(fd_set *fd)
 //
 
 CUDPSocket::CUDPSocket()
-	: CSocket()
+	: CSocket(nullptr)
 {
 	Allocate(SOCK_DGRAM);
 
@@ -552,8 +698,7 @@ CUDPSocket::CUDPSocket()
 
 CUDPSocket::~CUDPSocket()
 {
-	if (m_Socket != INVALID_SOCKET)
-		closesocket(m_Socket);
+
 }
 
 bool CUDPSocket::SendTo(struct sockaddr_in sin, const BYTEARRAY &message)
@@ -580,7 +725,7 @@ bool CUDPSocket::SendTo(const std::string &address, uint16_t port, const BYTEARR
 	{
 		m_HasError = true;
 		// m_Error = h_error;
-		Print("[UDPSOCKET] error (gethostbyname)");
+		LOG_ERROR(SOCKET, "[UDPSOCKET] error (gethostbyname)");
 		return false;
 	}
 
@@ -603,7 +748,7 @@ bool CUDPSocket::Broadcast(uint16_t port, const BYTEARRAY &message)
 	sin.sin_port = htons(port);
 	if (sendto(m_Socket, (const char*)message.data(), message.size(), 0, (struct sockaddr *) &sin, sizeof(sin)) == -1)
 	{
-		Print("[UDPSOCKET] failed to broadcast packet (port " + std::to_string(port) + ", size " + std::to_string(message.size()) + " bytes)");
+		LOG_WARNING(SOCKET, "[UDPSOCKET] failed to broadcast packet (port {}, size {} bytes)", port, message.size());
 		return false;
 	}
 	return true;
@@ -613,7 +758,7 @@ void CUDPSocket::SetBroadcastTarget(const std::string &subnet)
 {
 	if (subnet.empty())
 	{
-		Print("[UDPSOCKET] using default broadcast target");
+		LOG_INFO(SOCKET, "[UDPSOCKET] using default broadcast target");
 		m_BroadcastTarget.s_addr = INADDR_BROADCAST;
 	}
 	else
@@ -621,14 +766,14 @@ void CUDPSocket::SetBroadcastTarget(const std::string &subnet)
 		// this function does not check whether the given subnet is a valid subnet the user is on
 		// convert string representation of ip/subnet to in_addr
 
-		Print("[UDPSOCKET] using broadcast target [" + subnet + "]");
+		LOG_INFO(SOCKET, "[UDPSOCKET] using broadcast target [{}]", subnet);
 		m_BroadcastTarget.s_addr = inet_addr(subnet.c_str());
 
 		// if conversion fails, inet_addr( ) returns INADDR_NONE
 
 		if (m_BroadcastTarget.s_addr == INADDR_NONE)
 		{
-			Print("[UDPSOCKET] invalid broadcast target, using default broadcast target");
+			LOG_WARNING(SOCKET, "[UDPSOCKET] invalid broadcast target, using default broadcast target");
 			m_BroadcastTarget.s_addr = INADDR_BROADCAST;
 		}
 	}
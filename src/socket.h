@@ -21,6 +21,9 @@ CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
 #ifndef AURA_SOCKET_H_
 #define AURA_SOCKET_H_
 
+#include "ringbuffer.h"
+#include "sendqueue.h"
+
 #include <string>
 #include <vector>
 #include <stdint.h>
@@ -76,6 +79,8 @@ typedef std::vector<uint8_t> BYTEARRAY;
 #define ECONNRESET       WSAECONNRESET
 #undef  ENOBUFS          /* override definition in errno.h */
 #define ENOBUFS          WSAENOBUFS
+#undef  EMFILE           /* override definition in errno.h */
+#define EMFILE           WSAEMFILE
 #undef  EISCONN          /* override definition in errno.h */
 #define EISCONN          WSAEISCONN
 #undef  ENOTCONN         /* override definition in errno.h */
@@ -112,6 +117,7 @@ typedef std::vector<uint8_t> BYTEARRAY;
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 typedef int32_t SOCKET;
@@ -136,6 +142,8 @@ typedef int32_t SOCKET;
 #define SHUT_RDWR 2
 #endif
 
+class CPoller;
+
 //
 // CSocket
 //
@@ -145,23 +153,33 @@ class CSocket
 protected:
 	SOCKET m_Socket;
 	struct sockaddr_in m_SIN;
+	CPoller *m_Poller;                           // the poller this socket is registered with (may be nullptr)
 	bool m_HasError;
+	bool m_Readable;                             // set by the poller, cleared when recv returns EWOULDBLOCK
+	bool m_Writable;                             // set by the poller, cleared when send returns EWOULDBLOCK
 	int m_Error;
 
-	CSocket();
-	CSocket(SOCKET nSocket, struct sockaddr_in nSIN);
+	CSocket(CPoller *nPoller);
+	CSocket(SOCKET nSocket, struct sockaddr_in nSIN, CPoller *nPoller);
 
 public:
 	~CSocket();
 
 	std::string GetErrorString() const;
+	static std::string GetErrorString(int Error);
+	inline SOCKET GetFD() const                            { return m_Socket; }
 	inline uint16_t GetPort() const                        { return m_SIN.sin_port; }
 	inline uint32_t GetIP() const                          { return (uint32_t)m_SIN.sin_addr.s_addr; }
 	inline std::string GetIPString() const                       { return inet_ntoa(m_SIN.sin_addr); }
 	inline int32_t GetError() const                             { return m_Error; }
 	inline bool HasError() const                            { return m_HasError; }
+	inline bool IsReadable() const                          { return m_Readable; }
+	inline bool IsWritable() const                          { return m_Writable; }
 
-	void SetFD(fd_set *fd, fd_set *send_fd, int32_t *nfds);
+	inline void SetReadable(bool nReadable)                 { m_Readable = nReadable; }
+	inline void SetWritable(bool nWritable)                 { m_Writable = nWritable; }
+
+	void Close();
 	void Reset();
 	void Allocate(int type);
 };
@@ -173,30 +191,38 @@ public:
 class CTCPSocket : public CSocket
 {
 protected:
-	std::string m_RecvBuffer;
-	std::string m_SendBuffer;
+	CRingBuffer m_RecvBuffer;
+	CSendQueue m_SendBuffer;
 	uint32_t m_LastRecv;
 	bool m_Connected;
 
+	static uint32_t m_RecvChunkSize;              // the minimum free space we ask recv to fill each call
+	static uint32_t m_RecvBudget;                 // the maximum number of bytes read from one socket per DoRecv (for fairness between sockets)
+
 public:
-	CTCPSocket();
-	CTCPSocket(SOCKET nSocket, struct sockaddr_in nSIN);
+	CTCPSocket(CPoller *nPoller = nullptr);
+	CTCPSocket(SOCKET nSocket, struct sockaddr_in nSIN, CPoller *nPoller);
 	~CTCPSocket();
 
 
-	inline std::string *GetBytes()                               { return &m_RecvBuffer; }
+	inline CRingBuffer *GetBytes()                               { return &m_RecvBuffer; }
 	inline uint32_t GetLastRecv() const                     { return m_LastRecv; }
 	inline bool GetConnected() const                        { return m_Connected; }
 
-	inline void PutBytes(const std::string &bytes)              { m_SendBuffer += bytes; }
-	inline void PutBytes(const BYTEARRAY &bytes)           { m_SendBuffer += std::string(begin(bytes), end(bytes)); }
+	// this must be called before any shard starts since the limits are shared by every socket
 
-	inline void ClearRecvBuffer()                           { m_RecvBuffer.clear(); }
-	inline void SubstrRecvBuffer(uint32_t i)           { m_RecvBuffer = m_RecvBuffer.substr(i); }
-	inline void ClearSendBuffer()                           { m_SendBuffer.clear(); }
+	static void SetRecvLimits(uint32_t ChunkSize, uint32_t Budget);
 
-	void DoRecv(fd_set *fd);
-	void DoSend(fd_set *send_fd);
+	inline void PutBytes(const BYTEVIEW &bytes)            { m_SendBuffer.Push(bytes); }
+	inline void PutBytes(const SHAREDBYTEARRAY &bytes)     { m_SendBuffer.Push(bytes); }
+	inline void PutBytes(const BYTEVIEW &header, const BYTEVIEW &tail)   { m_SendBuffer.Push(header, tail); }
+	inline uint32_t GetSendQueued() const                  { return m_SendBuffer.GetSize(); }
+
+	inline void ClearRecvBuffer()                           { m_RecvBuffer.Clear(); }
+	inline void ClearSendBuffer()                           { m_SendBuffer.Clear(); }
+
+	void DoRecv();
+	void DoSend();
 	void Disconnect();
 
 	void Reset();
@@ -215,20 +241,21 @@ public:
 	CTCPClient();
 	~CTCPClient();
 
-	inline std::string *GetBytes()                               { return &m_RecvBuffer; }
+	inline CRingBuffer *GetBytes()                               { return &m_RecvBuffer; }
 	inline bool GetConnected() const                        { return m_Connected; }
 	inline bool GetConnecting() const                       { return m_Connecting; }
 
 	void Reset();
-	inline void PutBytes(const std::string &bytes)              { m_SendBuffer += bytes; }
-	inline void PutBytes(const BYTEARRAY &bytes)           { m_SendBuffer += std::string(begin(bytes), end(bytes)); }
+	inline void PutBytes(const BYTEVIEW &bytes)            { m_SendBuffer.Push(bytes); }
+	inline void PutBytes(const SHAREDBYTEARRAY &bytes)     { m_SendBuffer.Push(bytes); }
+	inline void PutBytes(const BYTEVIEW &header, const BYTEVIEW &tail)   { m_SendBuffer.Push(header, tail); }
+	inline uint32_t GetSendQueued() const                  { return m_SendBuffer.GetSize(); }
 
 	bool CheckConnect();
-	inline void ClearRecvBuffer()                           { m_RecvBuffer.clear(); }
-	inline void SubstrRecvBuffer(uint32_t i)           { m_RecvBuffer = m_RecvBuffer.substr(i); }
-	inline void ClearSendBuffer()                           { m_SendBuffer.clear(); }
-	void DoRecv(fd_set *fd);
-	void DoSend(fd_set *send_fd);
+	inline void ClearRecvBuffer()                           { m_RecvBuffer.Clear(); }
+	inline void ClearSendBuffer()                           { m_SendBuffer.Clear(); }
+	void DoRecv();
+	void DoSend();
 	void Disconnect();
 	void Connect(const std::string &localaddress, const std::string &address, uint16_t port);
 };
@@ -239,12 +266,18 @@ public:
 
 class CTCPServer final : public CTCPSocket
 {
+private:
+#ifndef WIN32
+	int m_SpareFD;                                // held open so a connection can still be taken off the queue and closed when the process is out of descriptors (-1 if it couldn't be opened)
+#endif
+	bool m_AcceptFailing;                         // accept failed with an error other than EWOULDBLOCK and it was logged, cleared by the next accepted connection
+
 public:
-	CTCPServer();
+	CTCPServer(CPoller *nPoller);
 	~CTCPServer();
 
 	bool Listen(const std::string &address, uint16_t& port);
-	CTCPSocket *Accept(fd_set *fd);
+	CTCPSocket *Accept();
 };
 
 //
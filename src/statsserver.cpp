@@ -0,0 +1,117 @@
+#include "statsserver.h"
+#include "relaystats.h"
+#include "socket.h"
+#include "logging.h"
+
+#include <algorithm>
+
+uint32_t GetTicks();
+
+//
+// CStatsServer
+//
+
+CStatsServer::CStatsServer()
+	: m_Socket(nullptr)
+{
+
+}
+
+CStatsServer::~CStatsServer()
+{
+	Stop();
+}
+
+void CStatsServer::Register(const CRelayStats *Stats)
+{
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	m_Games.push_back(Stats);
+}
+
+void CStatsServer::Unregister(const CRelayStats *Stats)
+{
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	m_Games.erase(std::remove(m_Games.begin(), m_Games.end(), Stats), m_Games.end());
+}
+
+bool CStatsServer::Listen(CPoller *Poller, const std::string &Address, uint16_t Port)
+{
+	m_Socket = new CTCPServer(Poller);
+
+	if (!m_Socket->Listen(Address, Port))
+	{
+		LOG_ERROR(STATS, "[STATS] error listening on {}:{}", Address, Port);
+		Stop();
+		return false;
+	}
+
+	LOG_INFO(STATS, "[STATS] listening on {}:{}", Address, Port);
+	return true;
+}
+
+void CStatsServer::Stop()
+{
+	for (auto & connection : m_Connections)
+		delete connection.Socket;
+
+	m_Connections.clear();
+	delete m_Socket;
+	m_Socket = nullptr;
+}
+
+std::string CStatsServer::GetJSON()
+{
+	// the games can't be deleted while we hold the mutex so their stats stay valid
+
+	std::lock_guard<std::mutex> Lock(m_Mutex);
+	std::string JSON = "{\"games\":[";
+
+	for (auto i = begin(m_Games); i != end(m_Games); ++i)
+	{
+		if (i != begin(m_Games))
+			JSON += ",";
+
+		JSON += (*i)->GetJSON();
+	}
+
+	return JSON + "]}\n";
+}
+
+void CStatsServer::Update()
+{
+	if (!m_Socket)
+		return;
+
+	const uint32_t Ticks = GetTicks();
+	CTCPSocket *NewSocket;
+
+	while ((NewSocket = m_Socket->Accept()))
+	{
+		// a request sent right after connecting may already be waiting but the poller hasn't reported it yet
+		// it has to be read before the socket is closed or the client gets a reset instead of its stats
+
+		const std::string JSON = GetJSON();
+		NewSocket->SetReadable(true);
+		NewSocket->PutBytes(BYTEVIEW((const uint8_t *)JSON.data(), (uint32_t)JSON.size()));
+		m_Connections.push_back(CConnection{ NewSocket, Ticks });
+	}
+
+	// the request itself doesn't matter, anything the client sends is thrown away
+	// a client that doesn't read its stats within 5 seconds is dropped
+
+	for (auto i = begin(m_Connections); i != end(m_Connections);)
+	{
+		CTCPSocket *Socket = i->Socket;
+		Socket->DoRecv();
+		Socket->ClearRecvBuffer();
+		Socket->DoSend();
+
+		if (Socket->HasError() || !Socket->GetConnected() || Socket->GetSendQueued() == 0 || Ticks - i->Ticks > 5000)
+		{
+			delete Socket;
+			i = m_Connections.erase(i);
+		}
+		else
+			++i;
+	}
+}
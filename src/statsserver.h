@@ -0,0 +1,55 @@
+#ifndef AURA_STATSSERVER_H_
+#define AURA_STATSSERVER_H_
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+//
+// CStatsServer
+//
+// answers every connection to bot_statsport with the relay stats of the running games as one line of JSON and closes it
+// e.g. nc 127.0.0.1 <port> | jq
+// the shards register their games from their own threads, the connections are handled on the main thread through the first shard's poller
+//
+
+class CPoller;
+class CTCPServer;
+class CTCPSocket;
+class CRelayStats;
+
+class CStatsServer
+{
+private:
+	struct CConnection
+	{
+		CTCPSocket *Socket;
+		uint32_t Ticks;                             // GetTicks when it was accepted
+	};
+
+	std::mutex m_Mutex;                           // guards m_Games
+	std::vector<const CRelayStats *> m_Games;     // the stats of every running game (owned by the games)
+	CTCPServer *m_Socket;                         // listening socket, null until Listen
+	std::vector<CConnection> m_Connections;       // these are still being sent their stats
+
+	std::string GetJSON();
+
+public:
+	CStatsServer();
+	~CStatsServer();
+	CStatsServer(CStatsServer &) = delete;
+
+	// these can be called from any thread
+
+	void Register(const CRelayStats *Stats);
+	void Unregister(const CRelayStats *Stats);
+
+	// these are only called from the main thread, Stop closes every socket so call it before the poller is deleted
+
+	bool Listen(CPoller *Poller, const std::string &Address, uint16_t Port);
+	void Stop();
+	void Update();
+};
+
+#endif  // AURA_STATSSERVER_H_
@@ -0,0 +1,266 @@
+#include "timerwheel.h"
+
+#include <algorithm>
+#include <iterator>
+
+//
+// CTimer
+//
+
+CTimer::CTimer()
+	: m_Wheel(nullptr),
+	m_Next(nullptr),
+	m_PPrev(nullptr),
+	m_Expiry(0)
+{
+
+}
+
+CTimer::~CTimer()
+{
+	Cancel();
+}
+
+void CTimer::Init(CTimerWheel *nWheel, const Callback &nCallback)
+{
+	Cancel();
+	m_Wheel = nWheel;
+	m_Callback = nCallback;
+}
+
+void CTimer::Schedule(uint32_t Expiry)
+{
+	Cancel();
+	m_Expiry = Expiry;
+	m_Wheel->Add(this);
+}
+
+void CTimer::ScheduleNext(uint32_t Ticks, uint32_t Period)
+{
+	// keep the cadence relative to the last expiry so the period doesn't drift
+	// but if we fell a whole period behind (e.g. the process was suspended) start over from now instead of firing a burst to catch up
+
+	uint32_t Expiry = m_Expiry + Period;
+
+	if ((int32_t)(Ticks - Expiry) >= (int32_t)Period)
+		Expiry = Ticks + Period;
+
+	Schedule(Expiry);
+}
+
+void CTimer::Cancel()
+{
+	if (m_PPrev)
+		m_Wheel->Remove(this);
+}
+
+//
+// CTimerWheel
+//
+
+CTimerWheel::CTimerWheel(uint32_t Ticks)
+	: m_Current(Ticks),
+	m_NumTimers(0)
+{
+	std::fill(std::begin(m_Root), std::end(m_Root), nullptr);
+
+	for (auto & Level : m_Levels)
+		std::fill(std::begin(Level), std::end(Level), nullptr);
+}
+
+CTimerWheel::~CTimerWheel()
+{
+	// detach any timers still scheduled so they don't touch the wheel after it's gone
+
+	auto Detach = [](CTimer *timer)
+	{
+		while (timer)
+		{
+			CTimer *Next = timer->m_Next;
+			timer->m_Next = nullptr;
+			timer->m_PPrev = nullptr;
+			timer = Next;
+		}
+	};
+
+	for (auto & Slot : m_Root)
+		Detach(Slot);
+
+	for (auto & Level : m_Levels)
+	{
+		for (auto & Slot : Level)
+			Detach(Slot);
+	}
+}
+
+void CTimerWheel::Add(CTimer *timer)
+{
+	const uint32_t Expiry = timer->m_Expiry;
+	const uint32_t Delta = Expiry - m_Current;
+	CTimer **Slot;
+
+	if ((int32_t)Delta < 0)
+	{
+		// already expired, run it on the next tick we process
+
+		Slot = &m_Root[m_Current & ROOT_MASK];
+	}
+	else if (Delta < (1u << ROOT_BITS))
+		Slot = &m_Root[Expiry & ROOT_MASK];
+	else if (Delta < (1u << (ROOT_BITS + LEVEL_BITS)))
+		Slot = &m_Levels[0][(Expiry >> ROOT_BITS) & LEVEL_MASK];
+	else if (Delta < (1u << (ROOT_BITS + 2 * LEVEL_BITS)))
+		Slot = &m_Levels[1][(Expiry >> (ROOT_BITS + LEVEL_BITS)) & LEVEL_MASK];
+	else if (Delta < (1u << (ROOT_BITS + 3 * LEVEL_BITS)))
+		Slot = &m_Levels[2][(Expiry >> (ROOT_BITS + 2 * LEVEL_BITS)) & LEVEL_MASK];
+	else
+		Slot = &m_Levels[3][(Expiry >> (ROOT_BITS + 3 * LEVEL_BITS)) & LEVEL_MASK];
+
+	timer->m_Next = *Slot;
+
+	if (timer->m_Next)
+		timer->m_Next->m_PPrev = &timer->m_Next;
+
+	*Slot = timer;
+	timer->m_PPrev = Slot;
+	++m_NumTimers;
+}
+
+void CTimerWheel::Remove(CTimer *timer)
+{
+	*timer->m_PPrev = timer->m_Next;
+
+	if (timer->m_Next)
+		timer->m_Next->m_PPrev = timer->m_PPrev;
+
+	timer->m_Next = nullptr;
+	timer->m_PPrev = nullptr;
+	--m_NumTimers;
+}
+
+uint32_t CTimerWheel::Cascade(uint32_t Level)
+{
+	// move every timer in the current slot of this level down to where it belongs now that it's closer
+
+	const uint32_t Index = (m_Current >> (ROOT_BITS + Level * LEVEL_BITS)) & LEVEL_MASK;
+	CTimer *timer = m_Levels[Level][Index];
+	m_Levels[Level][Index] = nullptr;
+
+	while (timer)
+	{
+		CTimer *Next = timer->m_Next;
+		timer->m_Next = nullptr;
+		timer->m_PPrev = nullptr;
+		--m_NumTimers;
+		Add(timer);
+		timer = Next;
+	}
+
+	return Index;
+}
+
+void CTimerWheel::Advance(uint32_t Ticks)
+{
+	// nothing to do, just jump ahead instead of walking every empty slot
+
+	if (m_NumTimers == 0)
+	{
+		if ((int32_t)(Ticks - m_Current) >= 0)
+			m_Current = Ticks + 1;
+
+		return;
+	}
+
+	while ((int32_t)(Ticks - m_Current) >= 0)
+	{
+		const uint32_t Index = m_Current & ROOT_MASK;
+
+		// the first level wrapped around, pull the next block of timers down from the higher levels
+
+		if (Index == 0)
+		{
+			for (uint32_t Level = 0; Level < NUM_LEVELS; ++Level)
+			{
+				if (Cascade(Level) != 0)
+					break;
+			}
+		}
+
+		// detach the expired slot into a local list first so callbacks can safely add and cancel timers (including ones in this list)
+
+		CTimer *Expired = m_Root[Index];
+		m_Root[Index] = nullptr;
+
+		if (Expired)
+			Expired->m_PPrev = &Expired;
+
+		++m_Current;
+
+		while (Expired)
+		{
+			CTimer *timer = Expired;
+			Remove(timer);
+			timer->m_Callback(Ticks);
+		}
+	}
+}
+
+uint32_t CTimerWheel::GetNextTimeout(uint32_t Ticks, uint32_t Max) const
+{
+	if (m_NumTimers == 0)
+		return Max;
+
+	// everything before m_Current has been processed so the deltas below are relative to it
+	// the first level is exact, on the higher levels the first non empty slot after the current one holds the earliest timers of that level
+
+	uint32_t Next = UINT32_MAX;
+
+	for (uint32_t i = 0; i < ROOT_SIZE; ++i)
+	{
+		if (m_Root[(m_Current + i) & ROOT_MASK])
+		{
+			Next = i;
+			break;
+		}
+	}
+
+	for (uint32_t Level = 0; Level < NUM_LEVELS; ++Level)
+	{
+		const uint32_t Shift = ROOT_BITS + Level * LEVEL_BITS;
+		const uint32_t Index = (m_Current >> Shift) & LEVEL_MASK;
+
+		// the current slot has already been cascaded unless we're sitting exactly on the boundary where Advance will do it next
+
+		const uint32_t First = (m_Current & ((1u << Shift) - 1)) == 0 ? 0 : 1;
+
+		for (uint32_t i = First; i <= LEVEL_SIZE; ++i)
+		{
+			const CTimer *timer = m_Levels[Level][(Index + i) & LEVEL_MASK];
+
+			if (!timer)
+				continue;
+
+			// nothing in this slot expires before the start of its range, only walk it when that's earlier than what we already have
+			// with thousands of games a slot up here holds thousands of timers and this runs on every wakeup
+
+			const uint64_t Start = ((uint64_t)i << Shift) - (m_Current & ((1u << Shift) - 1));
+
+			if (Start < Next)
+			{
+				for (; timer; timer = timer->m_Next)
+					Next = std::min(Next, timer->m_Expiry - m_Current);
+			}
+
+			break;
+		}
+	}
+
+	// m_Current is one past the last tick we processed
+
+	const uint32_t Expiry = m_Current + Next;
+
+	if ((int32_t)(Expiry - Ticks) <= 0)
+		return 0;
+
+	return std::min(Expiry - Ticks, Max);
+}
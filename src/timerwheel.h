@@ -0,0 +1,90 @@
+#ifndef AURA_TIMERWHEEL_H_
+#define AURA_TIMERWHEEL_H_
+
+#include <functional>
+#include <stdint.h>
+
+class CTimerWheel;
+
+//
+// CTimer
+//
+// a one shot timer registered in a CTimerWheel, periodic timers simply schedule themselves again from their callback
+// the timer unregisters itself when it's destroyed so the owner doesn't have to
+//
+
+class CTimer
+{
+	friend class CTimerWheel;
+
+public:
+	typedef std::function<void(uint32_t)> Callback;
+
+	CTimer();
+	~CTimer();
+	CTimer(CTimer &) = delete;
+
+	void Init(CTimerWheel *nWheel, const Callback &nCallback);
+	void Schedule(uint32_t Expiry);
+	void ScheduleNext(uint32_t Ticks, uint32_t Period);
+	void Cancel();
+
+	inline bool IsScheduled() const                         { return m_PPrev != nullptr; }
+	inline uint32_t GetExpiry() const                       { return m_Expiry; }
+
+private:
+	CTimerWheel *m_Wheel;
+	Callback m_Callback;
+	CTimer *m_Next;                               // next timer in the same slot
+	CTimer **m_PPrev;                             // the pointer that points to us (nullptr if we aren't scheduled)
+	uint32_t m_Expiry;                            // GetTicks when the timer fires
+};
+
+//
+// CTimerWheel
+//
+// a hierarchical timing wheel with a resolution of one millisecond (the same layout as the classic Linux kernel timers)
+// the first level has one slot per millisecond for the next 256 ms, each further level covers 64 times the range of the previous one
+// timers far in the future are moved down a level each time the level below wraps around, so adding, cancelling and expiring a timer is O(1)
+// and only the timers that actually expire are ever touched
+//
+
+class CTimerWheel
+{
+	friend class CTimer;
+
+public:
+	explicit CTimerWheel(uint32_t Ticks);
+	~CTimerWheel();
+	CTimerWheel(CTimerWheel &) = delete;
+
+	inline uint32_t GetNumTimers() const                    { return m_NumTimers; }
+
+	// run every timer that expired up to and including Ticks
+
+	void Advance(uint32_t Ticks);
+
+	// the number of milliseconds until the next timer expires (at most Max)
+
+	uint32_t GetNextTimeout(uint32_t Ticks, uint32_t Max) const;
+
+private:
+	static const uint32_t ROOT_BITS = 8;
+	static const uint32_t ROOT_SIZE = 1 << ROOT_BITS;
+	static const uint32_t ROOT_MASK = ROOT_SIZE - 1;
+	static const uint32_t LEVEL_BITS = 6;
+	static const uint32_t LEVEL_SIZE = 1 << LEVEL_BITS;
+	static const uint32_t LEVEL_MASK = LEVEL_SIZE - 1;
+	static const uint32_t NUM_LEVELS = 4;
+
+	CTimer *m_Root[ROOT_SIZE];
+	CTimer *m_Levels[NUM_LEVELS][LEVEL_SIZE];
+	uint32_t m_Current;                           // the next tick to be processed
+	uint32_t m_NumTimers;
+
+	void Add(CTimer *timer);
+	void Remove(CTimer *timer);
+	uint32_t Cascade(uint32_t Level);
+};
+
+#endif  // AURA_TIMERWHEEL_H_
@@ -21,10 +21,52 @@ CODE PORTED FROM THE ORIGINAL GHOST PROJECT: http://ghost.pwner.org/
 #ifndef AURA_UTIL_H_
 #define AURA_UTIL_H_
 
+#include <array>
+#include <memory>
+#include <string>
 #include <vector>
 #include <stdint.h>
 typedef std::vector<uint8_t> BYTEARRAY;
 
+// an encoded packet that is never modified again so any number of send queues can share it instead of copying it
+
+typedef std::shared_ptr<const BYTEARRAY> SHAREDBYTEARRAY;
+
+//
+// BYTEVIEW
+//
+// a non owning view of a range of bytes, e.g. a packet inside a socket's receive buffer
+// it has the same read only interface as BYTEARRAY so the parsing code works with either
+// the view is only valid until the underlying storage is modified
+//
+
+class BYTEVIEW
+{
+private:
+	const uint8_t *m_Data;
+	uint32_t m_Size;
+
+public:
+	BYTEVIEW()                                              : m_Data(nullptr), m_Size(0) { }
+	BYTEVIEW(const uint8_t *nData, uint32_t nSize)          : m_Data(nData), m_Size(nSize) { }
+	BYTEVIEW(const BYTEARRAY &b)                            : m_Data(b.data()), m_Size((uint32_t)b.size()) { }
+
+	template <size_t N>
+	BYTEVIEW(const std::array<uint8_t, N> &a)               : m_Data(a.data()), m_Size((uint32_t)N) { }
+
+	inline const uint8_t *data() const                      { return m_Data; }
+	inline uint32_t size() const                            { return m_Size; }
+	inline bool empty() const                               { return m_Size == 0; }
+	inline const uint8_t *begin() const                     { return m_Data; }
+	inline const uint8_t *end() const                       { return m_Data + m_Size; }
+	inline uint8_t operator[](uint32_t i) const             { return m_Data[i]; }
+
+	inline BYTEVIEW substr(uint32_t start, uint32_t length) const     { return BYTEVIEW(m_Data + start, length); }
+};
+
+inline const uint8_t *begin(const BYTEVIEW &b)              { return b.begin(); }
+inline const uint8_t *end(const BYTEVIEW &b)                { return b.end(); }
+
 inline BYTEARRAY CreateByteArray(const uint8_t *a, int32_t size)
 {
 	if (size < 1)
@@ -47,14 +89,14 @@ inline BYTEARRAY CreateByteArray(uint32_t i)
 	return BYTEARRAY{ (uint8_t)i, (uint8_t)(i >> 8), (uint8_t)(i >> 16), (uint8_t)(i >> 24) };
 }
 
-inline uint16_t ByteArrayToUInt16(const BYTEARRAY &b, uint32_t start)
+inline uint16_t ByteArrayToUInt16(const BYTEVIEW &b, uint32_t start)
 {
 	if (b.size() < start + 2)
 		return 0;
 	return (uint16_t)(b[start + 1] << 8 | b[start]);
 }
 
-inline uint32_t ByteArrayToUInt32(const BYTEARRAY &b, uint32_t start)
+inline uint32_t ByteArrayToUInt32(const BYTEVIEW &b, uint32_t start)
 {
 	if (b.size() < start + 4)
 		return 0;
@@ -73,7 +115,8 @@ inline void AppendByteArray(BYTEARRAY &b, uint8_t i)
 
 inline void AppendByteArray(BYTEARRAY &b, const uint8_t *a, int32_t size)
 {
-	AppendByteArray(b, CreateByteArray(a, size));
+	if (size > 0)
+		b.insert(end(b), a, a + size);
 }
 
 inline void AppendByteArray(BYTEARRAY &b, const std::string &append)
@@ -84,15 +127,17 @@ inline void AppendByteArray(BYTEARRAY &b, const std::string &append)
 
 inline void AppendByteArray(BYTEARRAY &b, uint16_t i)
 {
-	AppendByteArray(b, CreateByteArray(i));
+	b.push_back((uint8_t)i);
+	b.push_back((uint8_t)(i >> 8));
 }
 
 inline void AppendByteArray(BYTEARRAY &b, uint32_t i)
 {
-	AppendByteArray(b, CreateByteArray(i));
+	AppendByteArray(b, (uint16_t)i);
+	AppendByteArray(b, (uint16_t)(i >> 16));
 }
 
-inline std::string ExtractCString(const BYTEARRAY &b, uint32_t start)
+inline std::string ExtractCString(const BYTEVIEW &b, uint32_t start)
 {
 	// start searching the byte array at position 'start' for the first null value
 	// if found, return the subarray from 'start' to the null value but not including the null value
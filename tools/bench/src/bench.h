@@ -0,0 +1,47 @@
+#pragma once
+
+#include <chrono>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace bench
+{
+	inline uint64_t now_ns()
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// calls fn(n) with a growing n until one call takes at least min_ns and returns the nanoseconds per iteration
+	// fn runs its hot loop n times, that way the loop and the timer calls don't end up in the measurement
+	template <class F>
+	double per_iteration(F fn, uint64_t min_ns = 200000000)
+	{
+		for (uint64_t n = 1;; n *= 2) {
+			const uint64_t start = now_ns();
+			fn(n);
+			const uint64_t elapsed = now_ns() - start;
+			if (elapsed >= min_ns) {
+				return (double)elapsed / n;
+			}
+		}
+	}
+
+	// keeps the compiler from throwing away a result that isn't used otherwise
+	void keep(uint64_t v);
+
+	// the number of times operator new has been called so far in the process
+	uint64_t allocations();
+
+	// the byte at a time table CRC32 the host and maphash used before the slicing-by-8 and PCLMULQDQ kernels
+	uint32_t crc32_bytewise(const unsigned char* buf, size_t len);
+
+	// the benchmarks, each gets the arguments after its name and returns the exit code
+	int timers(int argc, char** argv);
+	int buffers(int argc, char** argv);
+	int framing(int argc, char** argv);
+	int encoders(int argc, char** argv);
+	int mapparts(int argc, char** argv);
+	int hashing(int argc, char** argv);
+	int checksums(int argc, char** argv);
+	int logcalls(int argc, char** argv);
+}
@@ -0,0 +1,148 @@
+#include "bench.h"
+#include "ringbuffer.h"
+#include "sendqueue.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// the send side of a map download, through each of the buffers the socket has used for it
+// the player's window is kept full of MAPPART packets (18 byte header and 1442 bytes of map) while the socket takes a few KB per send
+// std::string is the old CTCPSocket buffer (append, then substr after every partial send)
+// CRingBuffer replaced it, CSendQueue is what the socket uses now (the header is copied, the map part is only referenced)
+
+namespace
+{
+	const uint32_t map_size = 8 * 1024 * 1024;
+	const uint32_t part_size = 1442;
+	const uint32_t header_size = 18;
+	const uint32_t window = 140 * 1024;
+
+	// a send takes this much, like a socket that only has that much room left in its buffer every time it becomes writable
+	uint8_t sink[64 * 1024];
+
+	template <class Buffer>
+	uint64_t download(Buffer& buffer, const std::vector<uint8_t>& map, uint32_t chunk)
+	{
+		const uint8_t header[header_size] = { 247, 67 };
+		uint32_t start = 0;
+		uint64_t sent = 0;
+		while (start < map.size() || buffer.size() > 0) {
+			while (start < map.size() && buffer.size() < window) {
+				const uint32_t length = std::min(part_size, (uint32_t)map.size() - start);
+				buffer.push(header, &map[start], length);
+				start += length;
+			}
+			sent += buffer.send(chunk);
+		}
+		return sent;
+	}
+
+	struct string_buffer
+	{
+		std::string data;
+
+		uint32_t size() const { return (uint32_t)data.size(); }
+
+		void push(const uint8_t* header, const uint8_t* part, uint32_t length)
+		{
+			data += std::string((const char*)header, header_size);
+			data += std::string((const char*)part, length);
+		}
+
+		uint32_t send(uint32_t chunk)
+		{
+			const uint32_t length = std::min(chunk, size());
+			memcpy(sink, data.data(), length);
+			data = data.substr(length);
+			return length;
+		}
+	};
+
+	struct ring_buffer
+	{
+		CRingBuffer data;
+
+		uint32_t size() const { return data.GetSize(); }
+
+		void push(const uint8_t* header, const uint8_t* part, uint32_t length)
+		{
+			data.Append(header, header_size);
+			data.Append(part, length);
+		}
+
+		uint32_t send(uint32_t chunk)
+		{
+			// the readable data can wrap around, that's two spans like a writev
+			uint32_t length = 0;
+			while (length < chunk && !data.IsEmpty()) {
+				const uint32_t span = std::min(chunk - length, data.ReadSize());
+				memcpy(sink + length, data.ReadPtr(), span);
+				data.Consume(span);
+				length += span;
+			}
+			return length;
+		}
+	};
+
+	struct send_queue
+	{
+		CSendQueue data;
+
+		uint32_t size() const { return data.GetSize(); }
+
+		void push(const uint8_t* header, const uint8_t* part, uint32_t length)
+		{
+			data.Push(BYTEVIEW(header, header_size), BYTEVIEW(part, length));
+		}
+
+		uint32_t send(uint32_t chunk)
+		{
+			CSendQueue::CSpan spans[64];
+			const uint32_t count = data.Gather(spans, 64);
+			uint32_t length = 0;
+			for (uint32_t i = 0; i < count && length < chunk; ++i) {
+				const uint32_t span = std::min(chunk - length, spans[i].Length);
+				memcpy(sink + length, spans[i].Data, span);
+				length += span;
+			}
+			data.Consume(length);
+			return length;
+		}
+	};
+
+	template <class Buffer>
+	void run(const char* name, const std::vector<uint8_t>& map, uint32_t chunk)
+	{
+		uint64_t sent = 0;
+		const double ns = bench::per_iteration([&](uint64_t n) {
+			for (uint64_t i = 0; i < n; ++i) {
+				Buffer buffer;
+				sent = download(buffer, map, chunk);
+			}
+		}, 500000000);
+		bench::keep(sent);
+		printf("  %-12s %8.1f ms per map %8.0f MB/s\n", name, ns / 1e6, sent / (ns / 1e9) / 1e6);
+	}
+}
+
+namespace bench
+{
+	int buffers(int, char**)
+	{
+		std::vector<uint8_t> map(map_size);
+		for (uint32_t i = 0; i < map_size; ++i) {
+			map[i] = (uint8_t)(i * 2654435761u >> 24);
+		}
+
+		printf("one 8 MB map download with a %u KB window\n", window / 1024);
+		for (uint32_t chunk : { 1460u, 8192u, 65536u }) {
+			printf("%u bytes per send\n", chunk);
+			run<string_buffer>("std::string", map, chunk);
+			run<ring_buffer>("CRingBuffer", map, chunk);
+			run<send_queue>("CSendQueue", map, chunk);
+		}
+		return 0;
+	}
+}
@@ -0,0 +1,57 @@
+#include "bench.h"
+#include "crc32.h"
+#include <stdio.h>
+#include <vector>
+
+// CRC32 throughput at the sizes the host and maphash hash: an action batch, a map part and a whole map file
+// the byte table is what src/crc32.h and tools/maphash had before, slicing-by-8 is the portable kernel and crc32 is whatever the dispatch picked for this CPU
+
+namespace
+{
+	typedef uint32_t (*crc32_fn)(const unsigned char* buf, size_t len);
+
+	double gbps(crc32_fn crc, const std::vector<unsigned char>& data, size_t size)
+	{
+		// small inputs are hashed at a few offsets so the loads aren't always aligned the same way
+		const double ns = bench::per_iteration([&](uint64_t n) {
+			for (uint64_t i = 0; i < n; ++i) {
+				bench::keep(crc(&data[i & 7], size));
+			}
+		});
+		return size / ns;
+	}
+}
+
+namespace bench
+{
+	int checksums(int, char**)
+	{
+		const size_t largest = 8 * 1024 * 1024;
+		std::vector<unsigned char> data(largest + 8);
+		for (size_t i = 0; i < data.size(); ++i) {
+			data[i] = (unsigned char)(i * 2654435761u >> 24);
+		}
+
+		// bit exact with the byte table at every length and alignment around the folding kernel's block sizes
+		for (size_t offset = 0; offset < 8; ++offset) {
+			for (size_t len = 0; len <= 1024; ++len) {
+				const uint32_t expected = crc32_bytewise(&data[offset], len);
+				if (hash::crc32(&data[offset], len) != expected || hash::crc32_portable(&data[offset], len) != expected) {
+					fprintf(stderr, "checksums: the kernels disagree at offset %u length %u\n", (uint32_t)offset, (uint32_t)len);
+					return 1;
+				}
+			}
+		}
+		if (hash::crc32(data.data(), largest) != crc32_bytewise(data.data(), largest)) {
+			fprintf(stderr, "checksums: the kernels disagree on 8 MB\n");
+			return 1;
+		}
+
+		printf("GB/s on one core, crc32 picked %s\n", hash::crc32_kernel());
+		for (size_t size : { (size_t)64, (size_t)1442, largest }) {
+			printf("  %7u bytes  byte table %5.2f  slicing-by-8 %5.2f  crc32 %5.2f\n", (uint32_t)size,
+				gbps(crc32_bytewise, data, size), gbps(hash::crc32_portable, data, size), gbps(hash::crc32, data, size));
+		}
+		return 0;
+	}
+}
@@ -0,0 +1,146 @@
+#include "bench.h"
+#include "gameprotocol.h"
+#include "gameslot.h"
+#include <stdio.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// heap allocations and time per encode of the W3GS packets the host sends most, the current encoders against the ones they replaced
+// the old encoders are copied here from before the rework: they built the packet with push_back and turned every integer field into a temporary vector first
+// the fixed size packets are now encoded into a std::array, the variable ones are measured first and written into a single vector of the right size
+
+namespace
+{
+	namespace old
+	{
+		void append(BYTEARRAY& b, uint16_t i)    { AppendByteArray(b, CreateByteArray(i)); }
+		void append(BYTEARRAY& b, uint32_t i)    { AppendByteArray(b, CreateByteArray(i)); }
+
+		void assign_length(BYTEARRAY& content)
+		{
+			const BYTEARRAY LengthBytes = CreateByteArray((uint16_t)content.size());
+			content[2] = LengthBytes[0];
+			content[3] = LengthBytes[1];
+		}
+
+		BYTEARRAY ping_from_host(uint32_t ticks)
+		{
+			BYTEARRAY packet = { W3GS_HEADER_CONSTANT, CGameProtocol::W3GS_PING_FROM_HOST, 8, 0 };
+			append(packet, ticks);
+			return packet;
+		}
+
+		BYTEARRAY stop_lag(uint8_t pid, uint32_t time)
+		{
+			BYTEARRAY packet = { W3GS_HEADER_CONSTANT, CGameProtocol::W3GS_STOP_LAG, 9, 0, pid };
+			append(packet, time);
+			return packet;
+		}
+
+		BYTEARRAY playerleave_others(uint8_t PID, uint32_t leftCode)
+		{
+			BYTEARRAY packet = { W3GS_HEADER_CONSTANT, CGameProtocol::W3GS_PLAYERLEAVE_OTHERS, 9, 0, PID };
+			append(packet, leftCode);
+			return packet;
+		}
+
+		BYTEARRAY chat_from_host(uint8_t fromPID, const BYTEARRAY& toPIDs, uint8_t flag, uint32_t flagExtra, const std::string& message)
+		{
+			BYTEARRAY packet = { W3GS_HEADER_CONSTANT, CGameProtocol::W3GS_CHAT_FROM_HOST, 0, 0, (uint8_t)toPIDs.size() };
+			AppendByteArray(packet, toPIDs);
+			packet.push_back(fromPID);
+			packet.push_back(flag);
+			append(packet, flagExtra);
+			AppendByteArray(packet, message);
+			assign_length(packet);
+			return packet;
+		}
+
+		BYTEARRAY slotinfo(const std::vector<CGameSlot>& slots, uint32_t randomSeed, uint8_t layoutStyle, uint8_t playerSlots)
+		{
+			BYTEARRAY SlotInfo;
+			SlotInfo.push_back((uint8_t)slots.size());
+			for (auto& slot : slots) {
+				AppendByteArray(SlotInfo, slot.GetPID());
+				AppendByteArray(SlotInfo, slot.GetDownloadStatus());
+				AppendByteArray(SlotInfo, slot.GetSlotStatus());
+				AppendByteArray(SlotInfo, slot.GetComputer());
+				AppendByteArray(SlotInfo, slot.GetTeam());
+				AppendByteArray(SlotInfo, slot.GetColour());
+				AppendByteArray(SlotInfo, slot.GetRace());
+				AppendByteArray(SlotInfo, slot.GetComputerType());
+				AppendByteArray(SlotInfo, slot.GetHandicap());
+			}
+			append(SlotInfo, randomSeed);
+			SlotInfo.push_back(layoutStyle);
+			SlotInfo.push_back(playerSlots);
+
+			BYTEARRAY packet = { W3GS_HEADER_CONSTANT, CGameProtocol::W3GS_SLOTINFO, 0, 0 };
+			append(packet, (uint16_t)SlotInfo.size());
+			AppendByteArray(packet, SlotInfo);
+			assign_length(packet);
+			return packet;
+		}
+	}
+
+	template <class Old, class New>
+	bool run(const char* name, Old encode_old, New encode_new)
+	{
+		// the same bytes or the comparison is meaningless
+		const BYTEARRAY a = encode_old();
+		const auto b = encode_new();
+		if (a.size() != b.size() || !std::equal(a.begin(), a.end(), b.begin())) {
+			fprintf(stderr, "%s: the old and the new encoder disagree\n", name);
+			return false;
+		}
+
+		const uint64_t count = 100000;
+		uint64_t before = bench::allocations();
+		for (uint64_t i = 0; i < count; ++i) {
+			bench::keep(encode_old().size());
+		}
+		const double old_allocs = (double)(bench::allocations() - before) / count;
+		before = bench::allocations();
+		for (uint64_t i = 0; i < count; ++i) {
+			bench::keep(encode_new().size());
+		}
+		const double new_allocs = (double)(bench::allocations() - before) / count;
+
+		const double old_ns = bench::per_iteration([&](uint64_t n) {
+			for (uint64_t i = 0; i < n; ++i) {
+				bench::keep(encode_old()[2]);
+			}
+		});
+		const double new_ns = bench::per_iteration([&](uint64_t n) {
+			for (uint64_t i = 0; i < n; ++i) {
+				bench::keep(encode_new()[2]);
+			}
+		});
+		printf("  %-20s %3u bytes  old %4.1f allocations %6.1f ns  new %4.1f allocations %6.1f ns\n", name, (uint32_t)a.size(), old_allocs, old_ns, new_allocs, new_ns);
+		return true;
+	}
+}
+
+namespace bench
+{
+	int encoders(int, char**)
+	{
+		CGameProtocol protocol;
+		std::vector<CGameSlot> slots;
+		for (uint8_t i = 0; i < 12; ++i) {
+			slots.push_back(CGameSlot(i + 1, 100, 2, 0, i % 2, i, 32));
+		}
+		const BYTEARRAY toPIDs = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+		const std::string message = "[Host] the game will start in 5 seconds";
+
+		printf("per encode\n");
+		const bool ok =
+			run("PING_FROM_HOST", [] { return old::ping_from_host(123456); }, [&] { return protocol.SEND_W3GS_PING_FROM_HOST(123456); }) &&
+			run("STOP_LAG", [] { return old::stop_lag(3, 4000); }, [&] { return protocol.SEND_W3GS_STOP_LAG(3, 4000); }) &&
+			run("PLAYERLEAVE_OTHERS", [] { return old::playerleave_others(3, PLAYERLEAVE_LOST); }, [&] { return protocol.SEND_W3GS_PLAYERLEAVE_OTHERS(3, PLAYERLEAVE_LOST); }) &&
+			run("CHAT_FROM_HOST", [&] { return old::chat_from_host(1, toPIDs, 16, 0, message); }, [&] { return protocol.SEND_W3GS_CHAT_FROM_HOST(1, toPIDs, 16, 0, message); }) &&
+			run("SLOTINFO", [&] { return old::slotinfo(slots, 12345, 3, 12); }, [&] { return protocol.SEND_W3GS_SLOTINFO(slots, 12345, 3, 12); });
+		return ok ? 0 : 1;
+	}
+}
@@ -0,0 +1,114 @@
+#include "bench.h"
+#include "gameprotocol.h"
+#include "ringbuffer.h"
+#include <stdio.h>
+#include <random>
+#include <string>
+#include <vector>
+
+// framing the W3GS packets a player sends during a game (OUTGOING_KEEPALIVE and OUTGOING_ACTION) out of the receive buffer
+// the old loop copied the whole buffer into a BYTEARRAY, copied every packet out of it and rebuilt the rest of the buffer after each one
+// the new one frames the packets in place and hands the handlers a view, the buffer is consumed once at the end
+// both call the same handlers, a read holds one game tick of packets or the backlog after a lag screen
+
+namespace
+{
+	// what a player sends every 100 ms, a keepalive and usually an action of a few to a few dozen bytes
+	std::vector<uint8_t> record(uint32_t packets)
+	{
+		std::mt19937 rng(packets);
+		std::vector<uint8_t> stream;
+		for (uint32_t i = 0; i < packets; ++i) {
+			if (i % 2 == 0) {
+				const uint8_t keepalive[] = { 247, CGameProtocol::W3GS_OUTGOING_KEEPALIVE, 9, 0, 1, (uint8_t)rng(), (uint8_t)rng(), (uint8_t)rng(), (uint8_t)rng() };
+				stream.insert(stream.end(), keepalive, keepalive + sizeof(keepalive));
+			}
+			else {
+				const uint16_t length = (uint16_t)(8 + 4 + rng() % 36);
+				const uint8_t header[] = { 247, CGameProtocol::W3GS_OUTGOING_ACTION, (uint8_t)length, (uint8_t)(length >> 8) };
+				stream.insert(stream.end(), header, header + sizeof(header));
+				for (uint16_t j = 4; j < length; ++j) {
+					stream.push_back((uint8_t)rng());
+				}
+			}
+		}
+		return stream;
+	}
+
+	uint64_t handle(CGameProtocol& protocol, const BYTEVIEW& data)
+	{
+		if (data[1] == CGameProtocol::W3GS_OUTGOING_KEEPALIVE) {
+			return protocol.RECEIVE_W3GS_OUTGOING_KEEPALIVE(data);
+		}
+		BYTEVIEW action;
+		return protocol.RECEIVE_W3GS_OUTGOING_ACTION(data, 1, action) ? action.size() : 0;
+	}
+
+	// the CGamePlayer::Update loop before the framer, with its std::string receive buffer
+	uint64_t parse_copy(CGameProtocol& protocol, std::string& recv)
+	{
+		uint64_t result = 0;
+		BYTEARRAY Bytes = CreateByteArray((uint8_t*)recv.c_str(), recv.size());
+		uint32_t LengthProcessed = 0;
+		while (Bytes.size() >= 4) {
+			const uint16_t Length = ByteArrayToUInt16(Bytes, 2);
+			const BYTEARRAY Data = BYTEARRAY(begin(Bytes), begin(Bytes) + Length);
+			if (Bytes[0] != W3GS_HEADER_CONSTANT || Bytes.size() < Length) {
+				break;
+			}
+			result += handle(protocol, Data);
+			LengthProcessed += Length;
+			Bytes = BYTEARRAY(begin(Bytes) + Length, end(Bytes));
+		}
+		recv = recv.substr(LengthProcessed);
+		return result;
+	}
+
+	// the CGamePlayer::Update loop now
+	uint64_t parse_view(CGameProtocol& protocol, CRingBuffer& recv)
+	{
+		uint64_t result = 0;
+		const uint8_t* Buffer = recv.Linearize();
+		const uint32_t BufferSize = recv.GetSize();
+		uint32_t LengthProcessed = 0;
+		while (true) {
+			const int32_t Length = CGameProtocol::FramePacket(BYTEVIEW(Buffer + LengthProcessed, BufferSize - LengthProcessed));
+			if (Length <= 0) {
+				break;
+			}
+			result += handle(protocol, BYTEVIEW(Buffer + LengthProcessed, Length));
+			LengthProcessed += Length;
+		}
+		recv.Consume(LengthProcessed);
+		return result;
+	}
+}
+
+namespace bench
+{
+	int framing(int, char**)
+	{
+		CGameProtocol protocol;
+		printf("ns per packet, the receive buffer filled by one recv and then parsed\n");
+		for (uint32_t packets : { 2u, 20u, 200u, 2000u }) {
+			const std::vector<uint8_t> stream = record(packets);
+			std::string string_recv;
+			CRingBuffer ring_recv;
+
+			const double copy = per_iteration([&](uint64_t n) {
+				for (uint64_t i = 0; i < n; ++i) {
+					string_recv += std::string((const char*)stream.data(), stream.size());
+					keep(parse_copy(protocol, string_recv));
+				}
+			});
+			const double view = per_iteration([&](uint64_t n) {
+				for (uint64_t i = 0; i < n; ++i) {
+					ring_recv.Append(stream.data(), (uint32_t)stream.size());
+					keep(parse_view(protocol, ring_recv));
+				}
+			});
+			printf("  %4u packets (%5u bytes)  copying %8.1f  in place %6.1f\n", packets, (uint32_t)stream.size(), copy / packets, view / packets);
+		}
+		return 0;
+	}
+}
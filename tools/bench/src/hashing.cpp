@@ -0,0 +1,182 @@
+#include "bench.h"
+#include "crc32.h"
+#include "maphash.h"
+#include "mpq.h"
+#include "rolc.h"
+#include "sha1.h"
+#include <stdio.h>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+// map_size, map_info, map_crc and map_sha1 of a map, hash::maphash against the sequential version it replaced
+// the old one read, decompressed and hashed the files one after another on one thread, the crc32 of the whole map went first
+// the new one decompresses and folds the files on a pool while the calling thread feeds them to sha1 in order, the crc32 of the map runs next to them
+// the critical path is the longest of those jobs, it's what the pool gets down to with enough cores
+
+namespace
+{
+	std::string join(const std::string& dir, const char* filename)
+	{
+		if (dir.empty()) {
+			return filename;
+		}
+		const char last = dir[dir.size() - 1];
+		return (last == '/' || last == '\\') ? dir + filename : dir + "/" + filename;
+	}
+
+	// the files in the order they're hashed, the magic number goes between blizzard.j and war3map.j
+	const char* const files[][3] = {
+		{ "common.j", "scripts\\common.j", "common.j" },
+		{ "blizzard.j", "scripts\\blizzard.j", "blizzard.j" },
+		{ "war3map.j", "scripts\\war3map.j", nullptr },
+		{ "war3map.w3e", nullptr, nullptr },
+		{ "war3map.wpm", nullptr, nullptr },
+		{ "war3map.doo", nullptr, nullptr },
+		{ "war3map.w3u", nullptr, nullptr },
+		{ "war3map.w3b", nullptr, nullptr },
+		{ "war3map.w3d", nullptr, nullptr },
+		{ "war3map.w3a", nullptr, nullptr },
+		{ "war3map.w3q", nullptr, nullptr },
+	};
+	const size_t magic = 2;
+
+	bool read(const mpq::archive& map, const std::string& jass, const char* const (&file)[3], std::string& buf)
+	{
+		return map.read(file[0], buf) || (file[1] && map.read(file[1], buf)) || (file[2] && hash::readfile(join(jass, file[2]), buf));
+	}
+
+	// hash::maphash before the pool
+	bool maphash_sequential(const unsigned char* data, size_t size, const std::string& jass, hash::mapinfo& info)
+	{
+		info.size = (uint32_t)size;
+		info.info = hash::crc32(data, size);
+
+		mpq::archive map;
+		if (!map.open(data, size)) {
+			return false;
+		}
+
+		hash::rolc rolc;
+		hash::sha1 sha1;
+		std::string buf;
+		for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); ++i) {
+			if (i == magic) {
+				rolc.update(0x03F1379E);
+				sha1.update((const unsigned char*)"\x9E\x37\xF1\x03", 4);
+			}
+			if (read(map, jass, files[i], buf)) {
+				rolc.update((const unsigned char*)buf.data(), buf.size());
+				sha1.update((const unsigned char*)buf.data(), buf.size());
+			}
+		}
+
+		info.crc = rolc.final();
+		sha1.final(info.sha1.data());
+		return true;
+	}
+
+	bool same(const hash::mapinfo& a, const hash::mapinfo& b)
+	{
+		return a.size == b.size && a.info == b.info && a.crc == b.crc && a.sha1 == b.sha1;
+	}
+
+	double ms(double ns)
+	{
+		return ns / 1e6;
+	}
+}
+
+namespace bench
+{
+	int hashing(int argc, char** argv)
+	{
+		if (argc < 1) {
+			fprintf(stderr, "usage: hashing <map> [jass directory]\n");
+			return 1;
+		}
+
+		std::string buf;
+		if (!hash::readfile(argv[0], buf)) {
+			fprintf(stderr, "%s: unable to read the map\n", argv[0]);
+			return 1;
+		}
+		const std::string jass = argc > 1 ? argv[1] : std::string();
+		const unsigned char* data = (const unsigned char*)buf.data();
+
+		hash::mapinfo sequential, pooled;
+		std::string error;
+		if (!maphash_sequential(data, buf.size(), jass, sequential) || !hash::maphash(data, buf.size(), jass, pooled, error)) {
+			fprintf(stderr, "%s: not an MPQ archive\n", argv[0]);
+			return 1;
+		}
+		if (!same(sequential, pooled)) {
+			fprintf(stderr, "%s: the sequential and the pooled hashes differ\n", argv[0]);
+			return 1;
+		}
+
+		// the jobs on their own, a worker reads and folds each file, the calling thread passes them through sha1 in order
+		mpq::archive map;
+		map.open(data, buf.size());
+		const double crc32_ns = per_iteration([&](uint64_t n) {
+			for (uint64_t i = 0; i < n; ++i) {
+				keep(hash::crc32(data, buf.size()));
+			}
+		});
+		double longest_ns = 0;
+		const char* longest = nullptr;
+		std::vector<std::string> contents;
+		uint64_t hashed = 0;
+		for (const auto& names : files) {
+			std::string file;
+			if (!read(map, jass, names, file)) {
+				continue;
+			}
+			hashed += file.size();
+			contents.push_back(std::move(file));
+			const double ns = per_iteration([&](uint64_t n) {
+				std::string b;
+				for (uint64_t i = 0; i < n; ++i) {
+					read(map, jass, names, b);
+					keep(hash::rolc::fold((const unsigned char*)b.data(), b.size()));
+				}
+			}, 50000000);
+			if (ns > longest_ns) {
+				longest_ns = ns;
+				longest = names[0];
+			}
+		}
+		const double sha1_ns = per_iteration([&](uint64_t n) {
+			for (uint64_t i = 0; i < n; ++i) {
+				hash::sha1 sha1;
+				for (const std::string& b : contents) {
+					sha1.update((const unsigned char*)b.data(), b.size());
+				}
+				unsigned char digest[20];
+				sha1.final(digest);
+				keep(digest[0]);
+			}
+		});
+
+		const double sequential_ns = per_iteration([&](uint64_t n) {
+			for (uint64_t i = 0; i < n; ++i) {
+				maphash_sequential(data, buf.size(), jass, sequential);
+				keep(sequential.crc);
+			}
+		}, 1000000000);
+		const double pooled_ns = per_iteration([&](uint64_t n) {
+			for (uint64_t i = 0; i < n; ++i) {
+				hash::maphash(data, buf.size(), jass, pooled, error);
+				keep(pooled.crc);
+			}
+		}, 1000000000);
+
+		printf("%.1f MB map, %.1f MB of hashed files, %u cores, crc32 %s, sha1 %s\n", buf.size() / 1e6, hashed / 1e6, std::thread::hardware_concurrency(), hash::crc32_kernel(), hash::sha1_kernel());
+		printf("  sequential     %8.1f ms\n", ms(sequential_ns));
+		printf("  pooled         %8.1f ms\n", ms(pooled_ns));
+		printf("  critical path  %8.1f ms, the longest of: map crc32 %.1f ms, %s read and fold %.1f ms, sha1 of the files %.1f ms\n",
+			ms(std::max(std::max(crc32_ns, longest_ns), sha1_ns)), ms(crc32_ns), longest, ms(longest_ns), ms(sha1_ns));
+		return 0;
+	}
+}
@@ -0,0 +1,86 @@
+#include "bench.h"
+#include "logging.h"
+#include <stdio.h>
+#include <string>
+
+// the cost of a log call on the thread that makes it, for the player joined line in CGame::EventPlayerJoined
+// the old Print call built the whole line first, with copies of the names and the address turned into a string, whether or not it was wanted
+// a LOG_ call below its tag's level is one branch, an enabled one packs its arguments into a queue slot and the writer thread formats them
+// the writer isn't started, so nothing is printed, which limits the enabled measurement to one run of lines into the empty queue
+
+namespace
+{
+	struct player
+	{
+		std::string name;
+		uint32_t ip;
+
+		// the old getters returned copies
+		std::string GetName() const                 { return name; }
+		std::string GetExternalIPString() const
+		{
+			return std::to_string(ip & 0xFF) + "." + std::to_string((ip >> 8) & 0xFF) + "." + std::to_string((ip >> 16) & 0xFF) + "." + std::to_string(ip >> 24);
+		}
+	};
+
+	const std::string game_name = "dota -ap 5v5 eu only";
+	std::string GetGameName()                       { return game_name; }
+
+	// what the queue holds, one run of lines has to fit without any of them being dropped
+	const uint64_t burst = 2000;
+}
+
+namespace bench
+{
+	int logcalls(int, char**)
+	{
+		const player joined = { "Sheepyman", 0x0100007F };
+
+		const double concat_ns = per_iteration([&](uint64_t n) {
+			for (uint64_t i = 0; i < n; ++i) {
+				const std::string line = "[GAME: " + GetGameName() + "] player [" + joined.GetName() + "|" + joined.GetExternalIPString() + "] joined the game";
+				keep(line.size());
+			}
+		});
+
+		// the loop around the disabled call on its own, keep is a call so the loop can't be thrown away
+		const double loop_ns = per_iteration([&](uint64_t n) {
+			for (uint64_t i = 0; i < n; ++i) {
+				keep(i);
+			}
+		});
+
+		logging::set_level(logging::TAG_GAME, logging::LEVEL_WARNING);
+		const double disabled_ns = per_iteration([&](uint64_t n) {
+			for (uint64_t i = 0; i < n; ++i) {
+				LOG_INFO(GAME, "[GAME: {}] player [{}|{}] joined the game", game_name, joined.name, logging::ipv4(joined.ip));
+				keep(i);
+			}
+		});
+
+		logging::set_level(logging::TAG_GAME, logging::LEVEL_INFO);
+		const uint64_t start = now_ns();
+		for (uint64_t i = 0; i < burst; ++i) {
+			LOG_INFO(GAME, "[GAME: {}] player [{}|{}] joined the game", game_name, joined.name, logging::ipv4(joined.ip));
+		}
+		const double enabled_ns = (double)(now_ns() - start) / burst;
+		if (logging::dropped() != 0) {
+			fprintf(stderr, "logcalls: %u of the enabled lines were dropped\n", (uint32_t)logging::dropped());
+			return 1;
+		}
+
+		// the queue is full now, so this is what a line costs when the writer can't keep up
+		const double full_ns = per_iteration([&](uint64_t n) {
+			for (uint64_t i = 0; i < n; ++i) {
+				LOG_INFO(GAME, "[GAME: {}] player [{}|{}] joined the game", game_name, joined.name, logging::ipv4(joined.ip));
+			}
+		});
+
+		printf("ns per log call on the calling thread\n");
+		printf("  old line built with copies and +   %7.1f (the old Print did this for every line, then wrote it)\n", concat_ns);
+		printf("  LOG_INFO below the level           %7.1f (the loop without the call takes %.1f)\n", disabled_ns, loop_ns);
+		printf("  LOG_INFO queued                    %7.1f (%u lines into the empty queue, the first touch of its memory included)\n", enabled_ns, (uint32_t)burst);
+		printf("  LOG_INFO dropped, queue full       %7.1f\n", full_ns);
+		return 0;
+	}
+}
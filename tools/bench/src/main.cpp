@@ -0,0 +1,122 @@
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <new>
+
+// microbenchmarks for the host's hot paths, each one compares the current code with the way it used to be done
+// usage: bench [name [arguments]], without a name every benchmark that doesn't need arguments is run
+// builds anywhere with a C++11 compiler together with the host sources it measures, e.g. from tools/bench/src
+// g++ -std=c++11 -O2 -pthread -I../../../src -I../../maphash/src -o bench *.cpp
+//   ../../../src/{timerwheel,ringbuffer,sendqueue,gameprotocol,actionqueue,gameslot,logging}.cpp ../../maphash/src/{maphash,mpq,decompress,sha1,crc32,cpu}.cpp
+
+namespace
+{
+	struct benchmark
+	{
+		const char* name;
+		const char* usage;
+		int (*run)(int argc, char** argv);
+		bool needs_args;
+	};
+
+	const benchmark benchmarks[] = {
+		{ "timers", "timers [games...]", bench::timers, false },
+		{ "buffers", "buffers", bench::buffers, false },
+		{ "framing", "framing", bench::framing, false },
+		{ "encoders", "encoders", bench::encoders, false },
+		{ "mapparts", "mapparts", bench::mapparts, false },
+		{ "hashing", "hashing <map> [jass directory]", bench::hashing, true },
+		{ "checksums", "checksums", bench::checksums, false },
+		{ "logcalls", "logcalls", bench::logcalls, false },
+	};
+
+	volatile uint64_t sink;
+	std::atomic<uint64_t> allocated(0);
+}
+
+// every allocation goes through here so a benchmark can tell how many its code path makes
+void* operator new(size_t size)
+{
+	allocated.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = malloc(size ? size : 1)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+namespace bench
+{
+	void keep(uint64_t v)
+	{
+		sink = sink + v;
+	}
+
+	uint64_t allocations()
+	{
+		return allocated.load(std::memory_order_relaxed);
+	}
+
+	uint32_t crc32_bytewise(const unsigned char* buf, size_t len)
+	{
+		// the same 256 entry table that was in src/crc32.h, generated instead of spelled out
+		static const struct table {
+			uint32_t entries[256];
+			table()
+			{
+				for (uint32_t i = 0; i < 256; ++i) {
+					uint32_t c = i;
+					for (int k = 0; k < 8; ++k) {
+						c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+					}
+					entries[i] = c;
+				}
+			}
+		} crc32tab;
+
+		uint32_t h = 0xFFFFFFFF;
+		while (len--) {
+			h = crc32tab.entries[(h ^ *buf++) & 0xFF] ^ (h >> 8);
+		}
+		return h ^ 0xFFFFFFFF;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		for (const benchmark& b : benchmarks) {
+			if (!b.needs_args) {
+				printf("%s\n", b.name);
+				if (b.run(0, nullptr) != 0) {
+					return 1;
+				}
+				printf("\n");
+			}
+		}
+		return 0;
+	}
+
+	for (const benchmark& b : benchmarks) {
+		if (strcmp(argv[1], b.name) == 0) {
+			return b.run(argc - 2, argv + 2);
+		}
+	}
+
+	fprintf(stderr, "usage: %s [benchmark [arguments]]\n", argv[0]);
+	for (const benchmark& b : benchmarks) {
+		fprintf(stderr, "  %s\n", b.usage);
+	}
+	return 1;
+}
@@ -0,0 +1,112 @@
+#include "bench.h"
+#include "crc32.h"
+#include "gameprotocol.h"
+#include "sendqueue.h"
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+// serving an 8 MB map to 12 downloaders, the work the host does per MAPPART packet before it reaches the socket
+// the old SEND_W3GS_MAPPART calculated the CRC32 of the part with the byte table and copied the part twice into a new packet every time any player was sent it
+// the host now calculates the CRC32 of every part once when the map is loaded, a MAPPART is an 18 byte header and the part is sent from the map data
+// the middle row is the old packet layout with today's CRC32 kernel, it separates what the table saves from what the faster kernel saves
+
+namespace
+{
+	const uint32_t map_size = 8 * 1024 * 1024;
+	const uint32_t part_size = 1442;
+	const uint32_t downloaders = 12;
+
+	// copied from before the table, only the CRC32 function differs between the two old rows
+	template <class Crc>
+	BYTEARRAY send_mappart(uint8_t fromPID, uint8_t toPID, uint32_t start, const std::vector<uint8_t>& map, Crc crc)
+	{
+		BYTEARRAY packet = { W3GS_HEADER_CONSTANT, CGameProtocol::W3GS_MAPPART, 0, 0, toPID, fromPID, 1, 0, 0, 0 };
+		AppendByteArray(packet, start);
+		const uint32_t end = std::min(start + part_size, (uint32_t)map.size());
+		AppendByteArray(packet, CreateByteArray(crc(&map[start], end - start)));
+		const BYTEARRAY data = CreateByteArray(&map[start], end - start);
+		AppendByteArray(packet, data);
+		AssignLength(packet);
+		return packet;
+	}
+
+	std::vector<uint32_t> build_table(const std::vector<uint8_t>& map)
+	{
+		std::vector<uint32_t> crcs((map.size() + part_size - 1) / part_size);
+		for (uint32_t i = 0; i < crcs.size(); ++i) {
+			const uint32_t start = i * part_size;
+			crcs[i] = hash::crc32(&map[start], std::min(part_size, (uint32_t)map.size() - start));
+		}
+		return crcs;
+	}
+
+	// every downloader is sent every part, the queue is emptied right away so only the per packet work is measured
+	template <class Send>
+	void run(const char* name, const std::vector<uint8_t>& map, Send send)
+	{
+		CSendQueue queue;
+		const double ns = bench::per_iteration([&](uint64_t n) {
+			for (uint64_t i = 0; i < n; ++i) {
+				for (uint8_t pid = 1; pid <= downloaders; ++pid) {
+					for (uint32_t start = 0; start < map.size(); start += part_size) {
+						send(queue, pid, start);
+						bench::keep(queue.GetSize());
+						queue.Consume(queue.GetSize());
+					}
+				}
+			}
+		}, 1000000000);
+		const double served = (double)map.size() * downloaders;
+		printf("  %-28s %8.1f ms %8.0f MB/s\n", name, ns / 1e6, served / (ns / 1e9) / 1e6);
+	}
+}
+
+namespace bench
+{
+	int mapparts(int, char**)
+	{
+		std::vector<uint8_t> map(map_size);
+		for (uint32_t i = 0; i < map_size; ++i) {
+			map[i] = (uint8_t)(i * 2654435761u >> 24);
+		}
+
+		CGameProtocol protocol;
+		std::vector<uint32_t> crcs = build_table(map);
+
+		// the header and the cached CRC32 have to produce the packet the old encoder did
+		for (uint32_t start = 0; start < map.size(); start += part_size) {
+			const uint32_t length = std::min(part_size, (uint32_t)map.size() - start);
+			const BYTEARRAY old_packet = send_mappart(1, 2, start, map, bench::crc32_bytewise);
+			const CGameProtocol::MAPPART_HEADER header = protocol.SEND_W3GS_MAPPART_HEADER(1, 2, start, length, crcs[start / part_size]);
+			if (old_packet.size() != header.size() + length || !std::equal(header.begin(), header.end(), old_packet.begin()) || !std::equal(old_packet.begin() + header.size(), old_packet.end(), &map[start])) {
+				fprintf(stderr, "mapparts: the packets differ at %u\n", start);
+				return 1;
+			}
+		}
+
+		const double table_ns = per_iteration([&](uint64_t n) {
+			for (uint64_t i = 0; i < n; ++i) {
+				crcs = build_table(map);
+				keep(crcs.back());
+			}
+		});
+		printf("the part CRC32 table for an 8 MB map takes %.2f ms to build on one core\n", table_ns / 1e6);
+
+		printf("the map sent to %u downloaders on one core, the time for all of them and MB of map served per second\n", downloaders);
+		run("CRC32 per send, byte table", map, [&](CSendQueue& queue, uint8_t pid, uint32_t start) {
+			const BYTEARRAY packet = send_mappart(1, pid, start, map, bench::crc32_bytewise);
+			queue.Push(BYTEVIEW(packet.data(), packet.size()));
+		});
+		run("CRC32 per send, hash::crc32", map, [&](CSendQueue& queue, uint8_t pid, uint32_t start) {
+			const BYTEARRAY packet = send_mappart(1, pid, start, map, hash::crc32);
+			queue.Push(BYTEVIEW(packet.data(), packet.size()));
+		});
+		run("cached CRC32, header only", map, [&](CSendQueue& queue, uint8_t pid, uint32_t start) {
+			const uint32_t length = std::min(part_size, (uint32_t)map.size() - start);
+			const CGameProtocol::MAPPART_HEADER header = protocol.SEND_W3GS_MAPPART_HEADER(1, pid, start, length, crcs[start / part_size]);
+			queue.Push(BYTEVIEW(header.data(), header.size()), BYTEVIEW(&map[start], length));
+		});
+		return 0;
+	}
+}
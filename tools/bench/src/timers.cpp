@@ -0,0 +1,179 @@
+#include "bench.h"
+#include "timerwheel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+// the timer cost of running games, the shared timer wheel against every game polling all of its timers on every loop
+// each game has the six game timers (action, ping, download, slot info, countdown, lag screen reset) and twelve players with a 30 second timeout
+// every timer is armed all the time which is the worst case for the wheel, the polling loop pays the same whatever the state
+// the loop wakes up exactly when the next timer is due, like the host does, and a minute of game time is simulated
+
+namespace
+{
+	const uint32_t game_periods[] = { 100, 5000, 100, 1000, 500, 60000 };
+	const uint32_t game_timers = sizeof(game_periods) / sizeof(game_periods[0]);
+	const uint32_t game_players = 12;
+	const uint32_t player_timeout = 30000;
+	const uint32_t duration = 60000;
+
+	struct result
+	{
+		uint64_t ns;
+		uint64_t wakeups;
+		uint64_t fired;
+	};
+
+	// the CTimer every game had before the timer wheel
+	class polled_timer
+	{
+	public:
+		polled_timer()
+			: ticks_(0)
+		{ }
+
+		bool update(uint32_t now, uint32_t period)
+		{
+			if (now < ticks_ + period) {
+				return false;
+			}
+			ticks_ += period;
+			return true;
+		}
+
+		void reset(uint32_t now)            { ticks_ = now; }
+		uint32_t due(uint32_t period) const { return ticks_ + period; }
+
+	private:
+		uint32_t ticks_;
+	};
+
+	struct polled_game
+	{
+		polled_timer timers[game_timers];
+		uint32_t last_recv[game_players];
+	};
+
+	result run_polled(uint32_t games, uint32_t seed)
+	{
+		std::mt19937 rng(seed);
+		std::vector<polled_game> state(games);
+		for (auto& game : state) {
+			for (uint32_t i = 0; i < game_timers; ++i) {
+				game.timers[i].reset(rng() % game_periods[i]);
+			}
+			for (auto& last : game.last_recv) {
+				last = rng() % player_timeout;
+			}
+		}
+
+		result r = { 0, 0, 0 };
+		const uint64_t start = bench::now_ns();
+		for (uint32_t now = 0; now < duration;) {
+			// every game checks all of its timers and then all of them are walked again to work out how long to sleep
+			for (auto& game : state) {
+				for (uint32_t i = 0; i < game_timers; ++i) {
+					if (game.timers[i].update(now, game_periods[i])) {
+						++r.fired;
+					}
+				}
+				for (auto& last : game.last_recv) {
+					if (now >= last + player_timeout) {
+						last = now;
+						++r.fired;
+					}
+				}
+			}
+
+			uint32_t next = UINT32_MAX;
+			for (const auto& game : state) {
+				for (uint32_t i = 0; i < game_timers; ++i) {
+					next = std::min(next, game.timers[i].due(game_periods[i]));
+				}
+				for (const auto& last : game.last_recv) {
+					next = std::min(next, last + player_timeout);
+				}
+			}
+
+			++r.wakeups;
+			now = std::max(now + 1, next);
+		}
+		r.ns = bench::now_ns() - start;
+		return r;
+	}
+
+	struct wheel_game
+	{
+		CTimer timers[game_timers];
+		CTimer players[game_players];
+	};
+
+	result run_wheel(uint32_t games, uint32_t seed)
+	{
+		std::mt19937 rng(seed);
+		result r = { 0, 0, 0 };
+		CTimerWheel wheel(0);
+		std::vector<std::unique_ptr<wheel_game>> state;
+
+		for (uint32_t g = 0; g < games; ++g) {
+			state.emplace_back(new wheel_game);
+			wheel_game& game = *state.back();
+
+			// the same phases as the polled games, the polled timers fire first one period after their reset
+			for (uint32_t i = 0; i < game_timers; ++i) {
+				CTimer* timer = &game.timers[i];
+				const uint32_t period = game_periods[i];
+				timer->Init(&wheel, [timer, period, &r](uint32_t now) { ++r.fired; timer->ScheduleNext(now, period); });
+				timer->Schedule(rng() % period + period);
+			}
+			for (auto& player : game.players) {
+				CTimer* timer = &player;
+				timer->Init(&wheel, [timer, &r](uint32_t now) { ++r.fired; timer->ScheduleNext(now, player_timeout); });
+				timer->Schedule(rng() % player_timeout + player_timeout);
+			}
+		}
+
+		const uint64_t start = bench::now_ns();
+		for (uint32_t now = 0; now < duration;) {
+			wheel.Advance(now);
+			++r.wakeups;
+			now += std::max(1u, wheel.GetNextTimeout(now, UINT32_MAX));
+		}
+		r.ns = bench::now_ns() - start;
+		return r;
+	}
+
+	void print(const char* name, const result& r)
+	{
+		const double seconds = duration / 1000.0;
+		printf("  %-8s %8.0f wakeups/s %9.0f timers/s %10.1f us/s (%.2f%% of a core)\n", name, r.wakeups / seconds, r.fired / seconds, r.ns / 1000.0 / seconds, r.ns / 1e7 / seconds);
+	}
+}
+
+namespace bench
+{
+	int timers(int argc, char** argv)
+	{
+		std::vector<uint32_t> counts;
+		for (int i = 0; i < argc; ++i) {
+			counts.push_back((uint32_t)atoi(argv[i]));
+		}
+		if (counts.empty()) {
+			counts = { 10, 100, 1000 };
+		}
+
+		printf("timer cost per second of game time, %u timers per game\n", game_timers + game_players);
+		for (uint32_t games : counts) {
+			const result polled = run_polled(games, games);
+			const result wheel = run_wheel(games, games);
+			printf("%u games\n", games);
+			print("polling", polled);
+			print("wheel", wheel);
+			keep(polled.fired + wheel.fired);
+		}
+		return 0;
+	}
+}
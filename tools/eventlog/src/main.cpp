@@ -0,0 +1,145 @@
+#include "eventrecord.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// converts the binary event logs ydhost writes to bot_eventlogpath into CSV or JSON lines
+// usage: eventlog <csv|json> <file>...
+// the records of every file are merged and sorted by time, the output goes to stdout
+// builds anywhere with a C++11 compiler, e.g. g++ -std=c++11 -O2 -I../../../src -o eventlog main.cpp
+
+namespace
+{
+	bool read(const char* path, std::vector<CEventRecord>& records)
+	{
+		FILE* f = fopen(path, "rb");
+		if (!f) {
+			fprintf(stderr, "%s: unable to open\n", path);
+			return false;
+		}
+
+		CEventLogHeader header;
+		if (fread(&header, sizeof(header), 1, f) != 1 || header.Magic != EVENTLOG_MAGIC) {
+			fprintf(stderr, "%s: not an event log\n", path);
+			fclose(f);
+			return false;
+		}
+		if (header.Version != EVENTLOG_VERSION || header.HeaderSize < sizeof(CEventLogHeader) || header.RecordSize < sizeof(CEventRecord)) {
+			fprintf(stderr, "%s: unsupported event log version %u\n", path, header.Version);
+			fclose(f);
+			return false;
+		}
+
+		// a newer writer may add fields at the end of the header or of a record, those are skipped
+		std::vector<char> buf(header.RecordSize);
+		fseek(f, (long)header.HeaderSize, SEEK_SET);
+		while (fread(buf.data(), buf.size(), 1, f) == 1) {
+			CEventRecord r;
+			memcpy(&r, buf.data(), sizeof(r));
+			if (r.Time != 0) {
+				records.push_back(r);
+			}
+		}
+		fclose(f);
+		return true;
+	}
+
+	std::string timestamp(uint64_t usec)
+	{
+		const time_t t = (time_t)(usec / 1000000);
+		struct tm tm_at = *gmtime(&t);
+		char buf[64];
+		snprintf(buf, sizeof(buf), "%04d-%02d-%02dT%02d:%02d:%02d.%06uZ", tm_at.tm_year + 1900, tm_at.tm_mon + 1, tm_at.tm_mday, tm_at.tm_hour, tm_at.tm_min, tm_at.tm_sec, (unsigned)(usec % 1000000));
+		return buf;
+	}
+
+	std::string field(const CEventInfo& info, const CEventRecord& r, int i)
+	{
+		const uint32_t v = r.Fields[i];
+		if (info.IPFields & (1 << i)) {
+			// network byte order, so the first octet is the lowest byte
+			return std::to_string(v & 0xFF) + "." + std::to_string((v >> 8) & 0xFF) + "." + std::to_string((v >> 16) & 0xFF) + "." + std::to_string(v >> 24);
+		}
+		return std::to_string(v);
+	}
+
+	void csv(const std::vector<CEventRecord>& records)
+	{
+		puts("time,time_us,game,pid,event,field1,field2,field3,field4");
+		std::string line;
+		for (const CEventRecord& r : records) {
+			const CEventInfo& info = *GetEventInfo(r.Type);
+			line = timestamp(r.Time) + "," + std::to_string(r.Time) + "," + std::to_string(r.HostCounter) + ",";
+			if (r.PID != 255) {
+				line += std::to_string(r.PID);
+			}
+			line += ",";
+			line += info.Name;
+			for (int i = 0; i < 4; ++i) {
+				line += ",";
+				if (info.Fields[i]) {
+					line += field(info, r, i);
+				}
+			}
+			puts(line.c_str());
+		}
+	}
+
+	void json(const std::vector<CEventRecord>& records)
+	{
+		// one object per line so the output can be streamed through jq or loaded a line at a time
+		std::string line;
+		for (const CEventRecord& r : records) {
+			const CEventInfo& info = *GetEventInfo(r.Type);
+			line = "{\"time\":\"" + timestamp(r.Time) + "\",\"time_us\":" + std::to_string(r.Time) + ",\"game\":" + std::to_string(r.HostCounter);
+			if (r.PID != 255) {
+				line += ",\"pid\":" + std::to_string(r.PID);
+			}
+			line += ",\"event\":\"";
+			line += info.Name;
+			line += "\"";
+			if (r.Type >= EVENT_COUNT) {
+				line += ",\"type\":" + std::to_string(r.Type);
+			}
+			for (int i = 0; i < 4; ++i) {
+				if (info.Fields[i]) {
+					const bool ip = (info.IPFields & (1 << i)) != 0;
+					line += ",\"";
+					line += info.Fields[i];
+					line += ip ? "\":\"" + field(info, r, i) + "\"" : "\":" + field(info, r, i);
+				}
+			}
+			line += "}";
+			puts(line.c_str());
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3 || (strcmp(argv[1], "csv") != 0 && strcmp(argv[1], "json") != 0)) {
+		fprintf(stderr, "usage: %s <csv|json> <file>...\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<CEventRecord> records;
+	for (int i = 2; i < argc; ++i) {
+		if (!read(argv[i], records)) {
+			return 1;
+		}
+	}
+
+	// the shards write concurrently so records a few microseconds apart can be out of order
+	std::stable_sort(records.begin(), records.end(), [](const CEventRecord& a, const CEventRecord& b) { return a.Time < b.Time; });
+
+	if (strcmp(argv[1], "csv") == 0) {
+		csv(records);
+	}
+	else {
+		json(records);
+	}
+	return 0;
+}
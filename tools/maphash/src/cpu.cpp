@@ -0,0 +1,54 @@
+#include "cpu.h"
+
+#ifdef HASH_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace hash
+{
+	namespace cpu
+	{
+		namespace
+		{
+			enum reg { EAX, EBX, ECX, EDX };
+
+			// the given register of CPUID leaf (subleaf 0), 0 when the leaf isn't supported
+			unsigned int cpuid(unsigned int leaf, reg r)
+			{
+#ifdef HASH_X86
+				unsigned int regs[4] = { 0, 0, 0, 0 };
+#ifdef _MSC_VER
+				int info[4];
+				__cpuid(info, 0);
+				if ((unsigned int)info[0] < leaf) {
+					return 0;
+				}
+				__cpuidex(info, (int)leaf, 0);
+				for (int i = 0; i < 4; ++i) {
+					regs[i] = (unsigned int)info[i];
+				}
+#else
+				if (__get_cpuid_max(0, nullptr) < leaf) {
+					return 0;
+				}
+				__cpuid_count(leaf, 0, regs[EAX], regs[EBX], regs[ECX], regs[EDX]);
+#endif
+				return regs[r];
+#else
+				(void)leaf;
+				(void)r;
+				return 0;
+#endif
+			}
+		}
+
+		bool ssse3()  { return (cpuid(1, ECX) & (1u << 9)) != 0; }
+		bool sse41()  { return (cpuid(1, ECX) & (1u << 19)) != 0; }
+		bool pclmul() { return (cpuid(1, ECX) & (1u << 1)) != 0; }
+		bool sha()    { return (cpuid(7, EBX) & (1u << 29)) != 0; }
+	}
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+// the x86 features the accelerated hash kernels need, checked with CPUID
+// everything is false on other architectures so the portable code is used there
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define HASH_X86
+#endif
+
+namespace hash
+{
+	namespace cpu
+	{
+		bool ssse3();
+		bool sse41();
+		bool pclmul();
+		bool sha();
+	}
+}
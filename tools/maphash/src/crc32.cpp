@@ -0,0 +1,175 @@
+#include "crc32.h"
+#include "cpu.h"
+
+#ifdef HASH_X86
+#include <emmintrin.h>
+#include <smmintrin.h>
+#include <wmmintrin.h>
+#endif
+
+namespace hash
+{
+	namespace
+	{
+		const uint32_t POLY = 0xEDB88320;
+
+		// tables[0] is the usual byte at a time table, tables[k][i] is the crc of byte i followed by k zero bytes
+		// built at static initialisation so it's ready before any thread can use it
+		struct crc32_tables
+		{
+			uint32_t t[8][256];
+
+			crc32_tables()
+			{
+				for (uint32_t i = 0; i < 256; ++i) {
+					uint32_t c = i;
+					for (int k = 0; k < 8; ++k) {
+						c = (c & 1) ? (c >> 1) ^ POLY : c >> 1;
+					}
+					t[0][i] = c;
+				}
+				for (uint32_t i = 0; i < 256; ++i) {
+					for (int k = 1; k < 8; ++k) {
+						t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xFF];
+					}
+				}
+			}
+		};
+
+		const crc32_tables tables;
+
+		inline uint32_t load32(const unsigned char* p)
+		{
+			return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+		}
+
+		// crc is the running value, i.e. not inverted on the way in or out
+		uint32_t crc32_slice8(uint32_t crc, const unsigned char* buf, size_t len)
+		{
+			const uint32_t (*t)[256] = tables.t;
+			for (; len >= 8; buf += 8, len -= 8) {
+				const uint32_t one = load32(buf) ^ crc;
+				const uint32_t two = load32(buf + 4);
+				crc = t[7][one & 0xFF] ^ t[6][(one >> 8) & 0xFF] ^ t[5][(one >> 16) & 0xFF] ^ t[4][one >> 24]
+				    ^ t[3][two & 0xFF] ^ t[2][(two >> 8) & 0xFF] ^ t[1][(two >> 16) & 0xFF] ^ t[0][two >> 24];
+			}
+			while (len--) {
+				crc = t[0][(crc ^ *buf++) & 0xFF] ^ (crc >> 8);
+			}
+			return crc;
+		}
+
+#ifdef HASH_X86
+		// folds 64 bytes at a time with carry-less multiplies and finishes with a Barrett reduction
+		// see Intel's "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction", the constants are the bit reflected ones from the paper
+		// len must be at least 64 and a multiple of 16
+#ifndef _MSC_VER
+		__attribute__((target("sse4.1,pclmul")))
+#endif
+		uint32_t crc32_clmul_fold(uint32_t crc, const unsigned char* buf, size_t len)
+		{
+			// 64 bit constants split into 32 bit halves, _mm_set_epi64x is missing from older 32 bit compilers
+			const __m128i k1k2 = _mm_setr_epi32((int)0x54442BD4, 0x01, (int)0xC6E41596, 0x01);
+			const __m128i k3k4 = _mm_setr_epi32((int)0x751997D0, 0x01, (int)0xCCAA009E, 0x00);
+			const __m128i k5k0 = _mm_setr_epi32((int)0x63CD6124, 0x01, 0x00, 0x00);
+			const __m128i poly = _mm_setr_epi32((int)0xDB710641, 0x01, (int)0xF7011641, 0x01);
+			const __m128i mask = _mm_setr_epi32(~0, 0, ~0, 0);
+
+			__m128i x1 = _mm_loadu_si128((const __m128i*)(buf + 0x00));
+			__m128i x2 = _mm_loadu_si128((const __m128i*)(buf + 0x10));
+			__m128i x3 = _mm_loadu_si128((const __m128i*)(buf + 0x20));
+			__m128i x4 = _mm_loadu_si128((const __m128i*)(buf + 0x30));
+			x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+			buf += 64;
+			len -= 64;
+
+			// four independent lanes of 16 bytes each
+			for (; len >= 64; buf += 64, len -= 64) {
+				const __m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+				const __m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+				const __m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+				const __m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+				x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, k1k2, 0x11), x5);
+				x2 = _mm_xor_si128(_mm_clmulepi64_si128(x2, k1k2, 0x11), x6);
+				x3 = _mm_xor_si128(_mm_clmulepi64_si128(x3, k1k2, 0x11), x7);
+				x4 = _mm_xor_si128(_mm_clmulepi64_si128(x4, k1k2, 0x11), x8);
+				x1 = _mm_xor_si128(x1, _mm_loadu_si128((const __m128i*)(buf + 0x00)));
+				x2 = _mm_xor_si128(x2, _mm_loadu_si128((const __m128i*)(buf + 0x10)));
+				x3 = _mm_xor_si128(x3, _mm_loadu_si128((const __m128i*)(buf + 0x20)));
+				x4 = _mm_xor_si128(x4, _mm_loadu_si128((const __m128i*)(buf + 0x30)));
+			}
+
+			// fold the lanes into one, then fold in what's left 16 bytes at a time
+			x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), _mm_clmulepi64_si128(x1, k3k4, 0x00)), x2);
+			x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), _mm_clmulepi64_si128(x1, k3k4, 0x00)), x3);
+			x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), _mm_clmulepi64_si128(x1, k3k4, 0x00)), x4);
+			for (; len >= 16; buf += 16, len -= 16) {
+				x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), _mm_clmulepi64_si128(x1, k3k4, 0x00)), _mm_loadu_si128((const __m128i*)buf));
+			}
+
+			// 128 bits to 64 bits
+			x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+			x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+			x2 = _mm_srli_si128(x1, 4);
+			x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, mask), k5k0, 0x00), x2);
+
+			// Barrett reduction to 32 bits
+			x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask), poly, 0x10);
+			x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, mask), poly, 0x00);
+			x1 = _mm_xor_si128(x1, x2);
+			return (uint32_t)_mm_extract_epi32(x1, 1);
+		}
+
+		// the folding kernel needs a few blocks before it pays for its setup and reduction
+		const size_t CLMUL_MIN_LENGTH = 64;
+
+		uint32_t crc32_clmul(uint32_t crc, const unsigned char* buf, size_t len)
+		{
+			if (len >= CLMUL_MIN_LENGTH) {
+				const size_t chunk = len & ~(size_t)15;
+				crc = crc32_clmul_fold(crc, buf, chunk);
+				buf += chunk;
+				len -= chunk;
+			}
+			return crc32_slice8(crc, buf, len);
+		}
+#endif
+
+		typedef uint32_t (*crc32_fn)(uint32_t crc, const unsigned char* buf, size_t len);
+
+		struct crc32_dispatch
+		{
+			crc32_fn fn;
+			const char* name;
+
+			crc32_dispatch()
+				: fn(crc32_slice8)
+				, name("slicing-by-8")
+			{
+#ifdef HASH_X86
+				if (cpu::pclmul() && cpu::sse41()) {
+					fn = crc32_clmul;
+					name = "pclmulqdq";
+				}
+#endif
+			}
+		};
+
+		const crc32_dispatch dispatch;
+	}
+
+	uint32_t crc32(const unsigned char* buf, size_t len)
+	{
+		return ~dispatch.fn(0xFFFFFFFF, buf, len);
+	}
+
+	const char* crc32_kernel()
+	{
+		return dispatch.name;
+	}
+
+	uint32_t crc32_portable(const unsigned char* buf, size_t len)
+	{
+		return ~crc32_slice8(0xFFFFFFFF, buf, len);
+	}
+}
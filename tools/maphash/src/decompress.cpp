@@ -0,0 +1,368 @@
+#include "decompress.h"
+
+// small, table free decoders in the spirit of Mark Adler's puff.c and blast.c
+// map files are only hashed once at startup so simplicity beats speed here
+
+namespace mpq
+{
+	namespace
+	{
+		const int MAXBITS = 15;
+
+		struct corrupt {};
+
+		class bitstream
+		{
+		public:
+			bitstream(const unsigned char* src, size_t srclen, unsigned char* dst, size_t dstlen)
+				: in(src)
+				, inlen(srclen)
+				, incnt(0)
+				, out(dst)
+				, outlen(dstlen)
+				, outcnt(0)
+				, bitbuf(0)
+				, bitcnt(0)
+			{ }
+
+			uint32_t bits(int need)
+			{
+				uint32_t val = bitbuf;
+				while (bitcnt < need) {
+					if (incnt == inlen) {
+						throw corrupt();
+					}
+					val |= (uint32_t)in[incnt++] << bitcnt;
+					bitcnt += 8;
+				}
+				bitbuf = val >> need;
+				bitcnt -= need;
+				return val & ((1u << need) - 1);
+			}
+
+			void align()
+			{
+				bitbuf = 0;
+				bitcnt = 0;
+			}
+
+			void put(unsigned char c)
+			{
+				if (outcnt == outlen) {
+					throw corrupt();
+				}
+				out[outcnt++] = c;
+			}
+
+			void copy(size_t dist, size_t len)
+			{
+				if (dist == 0 || dist > outcnt || len > outlen - outcnt) {
+					throw corrupt();
+				}
+				for (; len > 0; --len, ++outcnt) {
+					out[outcnt] = out[outcnt - dist];
+				}
+			}
+
+			const unsigned char* in;
+			size_t inlen;
+			size_t incnt;
+			unsigned char* out;
+			size_t outlen;
+			size_t outcnt;
+
+		private:
+			uint32_t bitbuf;
+			int bitcnt;
+		};
+
+		// a canonical huffman code, count[len] is the number of symbols with a code of len bits and symbol holds them in code order
+		struct huffman
+		{
+			short count[MAXBITS + 1];
+			short symbol[288];
+
+			void construct(const unsigned char* length, int n)
+			{
+				for (int len = 0; len <= MAXBITS; ++len) {
+					count[len] = 0;
+				}
+				for (int i = 0; i < n; ++i) {
+					count[length[i]]++;
+				}
+
+				// over subscribed codes are an error, incomplete ones are allowed (e.g. a single distance code)
+				int left = 1;
+				for (int len = 1; len <= MAXBITS; ++len) {
+					left <<= 1;
+					left -= count[len];
+					if (left < 0) {
+						throw corrupt();
+					}
+				}
+
+				short offs[MAXBITS + 1];
+				offs[1] = 0;
+				for (int len = 1; len < MAXBITS; ++len) {
+					offs[len + 1] = offs[len] + count[len];
+				}
+				for (int i = 0; i < n; ++i) {
+					if (length[i] != 0) {
+						symbol[offs[length[i]]++] = (short)i;
+					}
+				}
+			}
+
+			// invert is for the PKWARE codes which are stored with their bits inverted
+			int decode(bitstream& s, uint32_t invert = 0) const
+			{
+				int code = 0, first = 0, index = 0;
+				for (int len = 1; len <= MAXBITS; ++len) {
+					code |= (int)(s.bits(1) ^ invert);
+					if (code - count[len] < first) {
+						return symbol[index + (code - first)];
+					}
+					index += count[len];
+					first += count[len];
+					first <<= 1;
+					code <<= 1;
+				}
+				throw corrupt();
+			}
+		};
+
+		//
+		// inflate
+		//
+
+		const short lbase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+		const short lext[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+		const short dbase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+		const short dext[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+		void stored(bitstream& s)
+		{
+			s.align();
+			if (s.inlen - s.incnt < 4) {
+				throw corrupt();
+			}
+			const unsigned len = s.in[s.incnt] | (s.in[s.incnt + 1] << 8);
+			const unsigned nlen = s.in[s.incnt + 2] | (s.in[s.incnt + 3] << 8);
+			s.incnt += 4;
+			if (len != (~nlen & 0xFFFF) || len > s.inlen - s.incnt) {
+				throw corrupt();
+			}
+			for (unsigned i = 0; i < len; ++i) {
+				s.put(s.in[s.incnt++]);
+			}
+		}
+
+		void codes(bitstream& s, const huffman& lencode, const huffman& distcode)
+		{
+			for (;;) {
+				int symbol = lencode.decode(s);
+				if (symbol < 256) {
+					s.put((unsigned char)symbol);
+				}
+				else if (symbol == 256) {
+					return;
+				}
+				else {
+					symbol -= 257;
+					if (symbol >= 29) {
+						throw corrupt();
+					}
+					const size_t len = lbase[symbol] + s.bits(lext[symbol]);
+					symbol = distcode.decode(s);
+					if (symbol >= 30) {
+						throw corrupt();
+					}
+					const size_t dist = dbase[symbol] + s.bits(dext[symbol]);
+					s.copy(dist, len);
+				}
+			}
+		}
+
+		// the fixed codes are built before main so several threads can decompress at once
+		struct fixed_codes
+		{
+			huffman lencode;
+			huffman distcode;
+
+			fixed_codes()
+			{
+				unsigned char lengths[288];
+				int symbol = 0;
+				for (; symbol < 144; ++symbol) lengths[symbol] = 8;
+				for (; symbol < 256; ++symbol) lengths[symbol] = 9;
+				for (; symbol < 280; ++symbol) lengths[symbol] = 7;
+				for (; symbol < 288; ++symbol) lengths[symbol] = 8;
+				lencode.construct(lengths, 288);
+				for (symbol = 0; symbol < 30; ++symbol) lengths[symbol] = 5;
+				distcode.construct(lengths, 30);
+			}
+		};
+
+		const fixed_codes fixedcodes;
+
+		void fixed(bitstream& s)
+		{
+			codes(s, fixedcodes.lencode, fixedcodes.distcode);
+		}
+
+		void dynamic(bitstream& s)
+		{
+			static const unsigned char order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+			const int nlen = s.bits(5) + 257;
+			const int ndist = s.bits(5) + 1;
+			const int ncode = s.bits(4) + 4;
+			if (nlen > 286 || ndist > 30) {
+				throw corrupt();
+			}
+
+			unsigned char lengths[286 + 30] = { 0 };
+			for (int i = 0; i < ncode; ++i) {
+				lengths[order[i]] = (unsigned char)s.bits(3);
+			}
+
+			huffman lencode, distcode;
+			lencode.construct(lengths, 19);
+
+			int index = 0;
+			while (index < nlen + ndist) {
+				int symbol = lencode.decode(s);
+				if (symbol < 16) {
+					lengths[index++] = (unsigned char)symbol;
+					continue;
+				}
+				unsigned char len = 0;
+				int repeat;
+				if (symbol == 16) {
+					if (index == 0) {
+						throw corrupt();
+					}
+					len = lengths[index - 1];
+					repeat = 3 + s.bits(2);
+				}
+				else if (symbol == 17) {
+					repeat = 3 + s.bits(3);
+				}
+				else {
+					repeat = 11 + s.bits(7);
+				}
+				if (index + repeat > nlen + ndist) {
+					throw corrupt();
+				}
+				while (repeat--) {
+					lengths[index++] = len;
+				}
+			}
+
+			// there has to be an end of block code
+			if (lengths[256] == 0) {
+				throw corrupt();
+			}
+
+			lencode.construct(lengths, nlen);
+			distcode.construct(lengths + nlen, ndist);
+			codes(s, lencode, distcode);
+		}
+
+		//
+		// explode
+		//
+
+		// the code lengths are run length encoded: the low nibble is the length and the high nibble + 1 is how many symbols in a row have it
+		const unsigned char lenlen[] = { 2, 35, 36, 53, 38, 23 };
+		const unsigned char distlen[] = { 2, 20, 53, 230, 247, 151, 248 };
+		const short base[16] = { 3, 2, 4, 5, 6, 7, 8, 9, 10, 12, 16, 24, 40, 72, 136, 264 };
+		const char extra[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 3, 4, 5, 6, 7, 8 };
+
+		void construct_compact(huffman& h, const unsigned char* rep, int n)
+		{
+			unsigned char length[256];
+			int symbol = 0;
+			for (int i = 0; i < n; ++i) {
+				int left = (rep[i] >> 4) + 1;
+				while (left--) {
+					length[symbol++] = rep[i] & 15;
+				}
+			}
+			h.construct(length, symbol);
+		}
+
+		struct implode_codes
+		{
+			huffman lencode;
+			huffman distcode;
+
+			implode_codes()
+			{
+				construct_compact(lencode, lenlen, sizeof(lenlen));
+				construct_compact(distcode, distlen, sizeof(distlen));
+			}
+		};
+
+		const implode_codes implodecodes;
+	}
+
+	bool inflate(const unsigned char* src, size_t srclen, unsigned char* dst, size_t dstlen)
+	{
+		// the two byte zlib header, the adler32 at the end isn't checked since every MPQ file is checked against the map hashes anyway
+		if (srclen < 2 || (src[0] & 0x0F) != 8 || (src[1] & 0x20) || ((src[0] << 8) | src[1]) % 31 != 0) {
+			return false;
+		}
+
+		bitstream s(src + 2, srclen - 2, dst, dstlen);
+		try {
+			int last;
+			do {
+				last = s.bits(1);
+				switch (s.bits(2)) {
+				case 0: stored(s); break;
+				case 1: fixed(s); break;
+				case 2: dynamic(s); break;
+				default: return false;
+				}
+			} while (!last);
+		}
+		catch (const corrupt&) {
+			return false;
+		}
+		return s.outcnt == dstlen;
+	}
+
+	bool explode(const unsigned char* src, size_t srclen, unsigned char* dst, size_t dstlen)
+	{
+		bitstream s(src, srclen, dst, dstlen);
+		try {
+			const uint32_t lit = s.bits(8);
+			const uint32_t dict = s.bits(8);
+			if (lit != 0 || dict < 4 || dict > 6) {
+				return false;
+			}
+
+			for (;;) {
+				if (s.bits(1)) {
+					int symbol = implodecodes.lencode.decode(s, 1);
+					const size_t len = base[symbol] + s.bits(extra[symbol]);
+					if (len == 519) {
+						break;
+					}
+					const int lowbits = len == 2 ? 2 : dict;
+					size_t dist = (size_t)implodecodes.distcode.decode(s, 1) << lowbits;
+					dist += s.bits(lowbits) + 1;
+					s.copy(dist, len);
+				}
+				else {
+					s.put((unsigned char)s.bits(8));
+				}
+			}
+		}
+		catch (const corrupt&) {
+			return false;
+		}
+		return s.outcnt == dstlen;
+	}
+}
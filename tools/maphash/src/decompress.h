@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace mpq
+{
+	// the decompressors used by the MPQ files of Warcraft III maps
+	// both expect to produce exactly dstlen bytes and return false if the data is corrupt or doesn't fit
+
+	// a zlib stream (MPQ compression type 0x02)
+	bool inflate(const unsigned char* src, size_t srclen, unsigned char* dst, size_t dstlen);
+
+	// PKWARE Data Compression Library "implode" (MPQ compression type 0x08 and the old MPQ_FILE_IMPLODE flag)
+	// only the binary mode is supported, the World Editor never uses the ASCII mode
+	bool explode(const unsigned char* src, size_t srclen, unsigned char* dst, size_t dstlen);
+}
@@ -0,0 +1,80 @@
+#include "maphash.h"
+#include <stdio.h>
+#include <string>
+
+// prints the map cfg values tools/mapdump writes, without needing Windows, lua or StormLib
+// usage: maphash <map> [jass directory] [output cfg]
+// builds anywhere with a C++11 compiler, e.g. g++ -std=c++11 -O2 -pthread -o maphash main.cpp maphash.cpp mpq.cpp decompress.cpp sha1.cpp crc32.cpp cpu.cpp
+
+namespace
+{
+	std::string bytes(uint32_t n, int count)
+	{
+		std::string s;
+		for (int i = 0; i < count; ++i, n >>= 8) {
+			if (i > 0) {
+				s += ' ';
+			}
+			s += std::to_string(n & 0xFF);
+		}
+		return s;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <map> [jass directory] [output cfg]\n", argv[0]);
+		return 1;
+	}
+
+	const std::string path = argv[1];
+	const std::string jass = argc > 2 ? argv[2] : std::string();
+	std::string buf;
+	if (!hash::readfile(path, buf)) {
+		fprintf(stderr, "%s: unable to read the map\n", path.c_str());
+		return 1;
+	}
+
+	hash::mapinfo info;
+	std::string error;
+	if (!hash::maphash((const unsigned char*)buf.data(), buf.size(), jass, info, error) || !hash::mapw3i((const unsigned char*)buf.data(), buf.size(), info, error)) {
+		fprintf(stderr, "%s: %s\n", path.c_str(), error.c_str());
+		return 1;
+	}
+
+	std::string sha1;
+	for (size_t i = 0; i < info.sha1.size(); ++i) {
+		sha1 += (i > 0 ? " " : "") + std::to_string(info.sha1[i]);
+	}
+
+	std::string out;
+	out += "map_size = " + bytes(info.size, 4) + "\n";
+	out += "map_info = " + bytes(info.info, 4) + "\n";
+	out += "map_crc = " + bytes(info.crc, 4) + "\n";
+	out += "map_sha1 = " + sha1 + "\n";
+	out += "map_options = " + std::to_string(info.options) + "\n";
+	out += "map_width = " + bytes(info.width, 2) + "\n";
+	out += "map_height = " + bytes(info.height, 2) + "\n";
+	for (size_t i = 0; i < info.slots.size(); ++i) {
+		const hash::mapslot& s = info.slots[i];
+		out += "map_slot" + std::to_string(i + 1) + " =";
+		for (uint8_t v : { s.pid, s.download_status, s.slot_status, s.computer, s.team, s.colour, s.race, s.computer_type, s.handicap }) {
+			out += " " + std::to_string(v);
+		}
+		out += "\n";
+	}
+
+	fputs(out.c_str(), stdout);
+
+	if (argc > 3) {
+		FILE* f = fopen(argv[3], "wb");
+		if (!f) {
+			fprintf(stderr, "%s: unable to write\n", argv[3]);
+			return 1;
+		}
+		fputs(out.c_str(), f);
+		fclose(f);
+	}
+	return 0;
+}
@@ -0,0 +1,317 @@
+#include "maphash.h"
+#include "mpq.h"
+#include "crc32.h"
+#include "sha1.h"
+#include "rolc.h"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <thread>
+#include <string.h>
+
+namespace hash
+{
+	namespace
+	{
+		std::string join(const std::string& dir, const char* filename)
+		{
+			if (dir.empty()) {
+				return filename;
+			}
+			const char last = dir[dir.size() - 1];
+			return (last == '/' || last == '\\') ? dir + filename : dir + "/" + filename;
+		}
+
+		// one of the files that go into map_crc and map_sha1
+		struct hashfile
+		{
+			hashfile(const char* name, const char* alt, const char* fallback)
+				: jass(fallback)
+				, found(false)
+				, fold(0)
+			{
+				names[0] = name;
+				names[1] = alt;
+			}
+
+			const char* names[2];   // the names to look for in the map, in order (the second one can be null)
+			const char* jass;       // the file in the jass directory to use when the map doesn't have one (or null)
+			bool found;
+			std::string buf;
+			uint32_t fold;          // rolc::fold of buf
+			std::promise<void> done;  // set when buf and fold are ready, or to the exception that stopped them
+		};
+
+		// runs job(0) ... job(count - 1) on up to one thread per core, the jobs are started in order
+		class pool
+		{
+		public:
+			pool(size_t count, const std::function<void(size_t)>& job)
+				: job_(job)
+				, count_(count)
+				, next_(0)
+			{
+				const size_t threads = std::min<size_t>(count, std::max(1u, std::thread::hardware_concurrency()));
+				for (size_t i = 0; i < threads; ++i) {
+					threads_.emplace_back([this] { run(); });
+				}
+			}
+
+			~pool()
+			{
+				for (auto& thread : threads_) {
+					thread.join();
+				}
+			}
+
+		private:
+			void run()
+			{
+				for (size_t i; (i = next_++) < count_;) {
+					job_(i);
+				}
+			}
+
+			std::function<void(size_t)> job_;
+			size_t count_;
+			std::atomic<size_t> next_;
+			std::vector<std::thread> threads_;
+		};
+
+		// the little endian fields of war3map.w3i, reading past the end just sets ok to false
+		class w3ireader
+		{
+		private:
+			const std::string& buf_;
+			size_t pos_;
+
+		public:
+			explicit w3ireader(const std::string& buf)
+				: buf_(buf)
+				, pos_(0)
+				, ok(true)
+			{ }
+
+			uint32_t u32()
+			{
+				if (buf_.size() - pos_ < 4) {
+					ok = false;
+					pos_ = buf_.size();
+					return 0;
+				}
+				const unsigned char* p = (const unsigned char*)buf_.data() + pos_;
+				pos_ += 4;
+				return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+			}
+
+			void skip(size_t len)
+			{
+				if (buf_.size() - pos_ < len) {
+					ok = false;
+					pos_ = buf_.size();
+					return;
+				}
+				pos_ += len;
+			}
+
+			void skip_string()
+			{
+				const size_t end = buf_.find('\0', pos_);
+				if (end == std::string::npos) {
+					ok = false;
+					pos_ = buf_.size();
+					return;
+				}
+				pos_ = end + 1;
+			}
+
+			bool ok;
+		};
+	}
+
+	bool readfile(const std::string& path, std::string& buf)
+	{
+		std::ifstream f(path.c_str(), std::ios::binary);
+		if (!f) {
+			return false;
+		}
+		buf.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+		return !buf.empty();
+	}
+
+	bool maphash(const unsigned char* data, size_t size, const std::string& jass, mapinfo& info, std::string& error)
+	{
+		mpq::archive map;
+		if (!map.open(data, size)) {
+			error = "not an MPQ archive";
+			return false;
+		}
+
+		// in the order they're hashed, the magic number goes between blizzard.j and war3map.j
+		hashfile files[] = {
+			{ "common.j", "scripts\\common.j", "common.j" },
+			{ "blizzard.j", "scripts\\blizzard.j", "blizzard.j" },
+			{ "war3map.j", "scripts\\war3map.j", nullptr },
+			{ "war3map.w3e", nullptr, nullptr },
+			{ "war3map.wpm", nullptr, nullptr },
+			{ "war3map.doo", nullptr, nullptr },
+			{ "war3map.w3u", nullptr, nullptr },
+			{ "war3map.w3b", nullptr, nullptr },
+			{ "war3map.w3d", nullptr, nullptr },
+			{ "war3map.w3a", nullptr, nullptr },
+			{ "war3map.w3q", nullptr, nullptr },
+		};
+		const size_t count = sizeof(files) / sizeof(files[0]);
+		const size_t magic = 2;
+
+		std::vector<std::future<void>> ready;
+		for (auto& file : files) {
+			ready.push_back(file.done.get_future());
+		}
+
+		// the files are decompressed and folded into their rolc values on the pool while this thread feeds them to sha1 in order as they're done
+		// the crc32 of the whole map goes first since it's usually the biggest job
+		pool workers(count + 1, [&](size_t i) {
+			if (i == 0) {
+				info.size = (uint32_t)size;
+				info.info = hash::crc32(data, size);
+				return;
+			}
+			// an exception (e.g. std::bad_alloc) can't escape the worker thread, it's handed to this thread through the promise instead
+			hashfile& file = files[i - 1];
+			try {
+				file.found = map.read(file.names[0], file.buf) || (file.names[1] && map.read(file.names[1], file.buf)) || (file.jass && readfile(join(jass, file.jass), file.buf));
+				file.fold = file.found ? hash::rolc::fold((const unsigned char*)file.buf.data(), file.buf.size()) : 0;
+				file.done.set_value();
+			}
+			catch (...) {
+				file.done.set_exception(std::current_exception());
+			}
+		});
+
+		hash::rolc rolc;
+		hash::sha1 sha1;
+		for (size_t i = 0; i < count; ++i) {
+			if (i == magic) {
+				rolc.update(0x03F1379E);
+				sha1.update((const unsigned char*)"\x9E\x37\xF1\x03", 4);
+			}
+			ready[i].get();  // rethrows the worker's exception, the pool finishes the other jobs before files goes away
+			if (files[i].found) {
+				rolc.update(files[i].fold);
+				sha1.update((const unsigned char*)files[i].buf.data(), files[i].buf.size());
+				std::string().swap(files[i].buf);
+			}
+		}
+
+		info.crc = rolc.final();
+		sha1.final(info.sha1.data());
+		return true;
+	}
+
+	bool mapw3i(const unsigned char* data, size_t size, mapinfo& info, std::string& error)
+	{
+		mpq::archive map;
+		std::string buf;
+		if (!map.open(data, size)) {
+			error = "not an MPQ archive";
+			return false;
+		}
+		if (!map.read("war3map.w3i", buf)) {
+			error = "unable to read war3map.w3i";
+			return false;
+		}
+
+		// version 25 is The Frozen Throne, 28 (1.31) and 31 (1.32) only add a few fields
+		w3ireader r(buf);
+		const uint32_t version = r.u32();
+		if (version < 25) {
+			error = "unsupported war3map.w3i version " + std::to_string(version);
+			return false;
+		}
+		r.skip(8);                          // map version, editor version
+		if (version >= 28) {
+			r.skip(16);                     // game version
+		}
+		for (int i = 0; i < 4; ++i) {
+			r.skip_string();                // name, author, description, recommended players
+		}
+		r.skip(48);                         // camera bounds and complements
+		info.width = (uint16_t)r.u32();
+		info.height = (uint16_t)r.u32();
+		info.options = (uint8_t)(r.u32() & 0x64); // melee map, fixed player settings, custom forces
+		r.skip(1);                          // tileset
+		r.skip(4);                          // loading screen
+		for (int i = 0; i < 4; ++i) {
+			r.skip_string();
+		}
+		r.skip(4);                          // game data set
+		for (int i = 0; i < 4; ++i) {
+			r.skip_string();                // prologue screen
+		}
+		r.skip(20);                         // fog
+		r.skip(4);                          // weather
+		r.skip_string();                    // sound environment
+		r.skip(5);                          // light environment, water colour
+		if (version >= 31) {
+			r.skip(12);                     // script language, graphics modes, game data version
+		}
+
+		info.slots.clear();
+		const uint32_t players = r.u32();
+		for (uint32_t i = 0; i < players && r.ok; ++i) {
+			const uint32_t colour = r.u32();
+			const uint32_t type = r.u32();
+			const uint32_t race = r.u32();
+			r.skip(4);                      // fixed start position
+			r.skip_string();                // name
+			r.skip(16);                     // start position, ally priorities
+			if (version >= 31) {
+				r.skip(8);                  // enemy priorities
+			}
+
+			// only the human and computer players get a slot
+			if (type != 1 && type != 2) {
+				continue;
+			}
+			mapslot slot;
+			slot.pid = 0;
+			slot.download_status = 255;
+			slot.slot_status = type == 1 ? 0 : 2;
+			slot.computer = type == 1 ? 0 : 1;
+			slot.team = 0;
+			slot.colour = (uint8_t)colour;
+			switch (race) {
+			case 1: slot.race = 1; break;   // human
+			case 2: slot.race = 2; break;   // orc
+			case 3: slot.race = 8; break;   // undead
+			case 4: slot.race = 4; break;   // night elf
+			default: slot.race = 32; break; // random
+			}
+			slot.computer_type = 1;
+			slot.handicap = 100;
+			info.slots.push_back(slot);
+		}
+
+		const uint32_t forces = r.u32();
+		for (uint32_t i = 0; i < forces && r.ok; ++i) {
+			r.skip(4);                      // flags
+			const uint32_t mask = r.u32();
+			r.skip_string();                // name
+			for (auto& slot : info.slots) {
+				if (slot.colour < 32 && (mask & (1u << slot.colour))) {
+					slot.team = (uint8_t)i;
+				}
+			}
+		}
+
+		if (!r.ok) {
+			error = "war3map.w3i is truncated";
+			return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace hash
+{
+	struct mapslot
+	{
+		uint8_t pid;
+		uint8_t download_status;
+		uint8_t slot_status;
+		uint8_t computer;
+		uint8_t team;
+		uint8_t colour;
+		uint8_t race;
+		uint8_t computer_type;
+		uint8_t handicap;
+	};
+
+	// everything the server needs to know about a map, the same values tools/mapdump writes to the map cfg
+	struct mapinfo
+	{
+		uint32_t size;                 // map_size
+		uint32_t info;                 // map_info, the crc32 of the map file
+		uint32_t crc;                  // map_crc, the rolc of the scripts and the object files
+		std::array<uint8_t, 20> sha1;  // map_sha1, the sha1 of the same files
+		uint8_t options;               // map_options
+		uint16_t width;                // map_width
+		uint16_t height;               // map_height
+		std::vector<mapslot> slots;    // map_slot<x>
+	};
+
+	// map_size, map_info, map_crc and map_sha1
+	// common.j and blizzard.j are read from the jass directory when the map doesn't have its own
+	bool maphash(const unsigned char* data, size_t size, const std::string& jass, mapinfo& info, std::string& error);
+
+	// map_options, map_width, map_height and the slots from war3map.w3i
+	bool mapw3i(const unsigned char* data, size_t size, mapinfo& info, std::string& error);
+
+	bool readfile(const std::string& path, std::string& buf);
+}
@@ -0,0 +1,297 @@
+#include "mpq.h"
+#include "decompress.h"
+#include <algorithm>
+#include <string.h>
+
+namespace mpq
+{
+	namespace
+	{
+		const uint32_t MPQ_SIGNATURE = 0x1A51504D; // "MPQ\x1A"
+		const uint32_t MPQ_HASH_EMPTY = 0xFFFFFFFF;
+		const uint32_t MPQ_HASH_DELETED = 0xFFFFFFFE;
+
+		const uint32_t MPQ_FILE_IMPLODE = 0x00000100;
+		const uint32_t MPQ_FILE_COMPRESS = 0x00000200;
+		const uint32_t MPQ_FILE_ENCRYPTED = 0x00010000;
+		const uint32_t MPQ_FILE_FIX_KEY = 0x00020000;
+		const uint32_t MPQ_FILE_SINGLE_UNIT = 0x01000000;
+		const uint32_t MPQ_FILE_EXISTS = 0x80000000;
+
+		const unsigned char MPQ_COMPRESSION_ZLIB = 0x02;
+		const unsigned char MPQ_COMPRESSION_PKWARE = 0x08;
+
+		enum hash_type
+		{
+			HASH_TABLE_OFFSET = 0,
+			HASH_NAME_A = 1,
+			HASH_NAME_B = 2,
+			HASH_FILE_KEY = 3,
+		};
+
+		struct crypt_table
+		{
+			uint32_t v[0x500];
+
+			crypt_table()
+			{
+				uint32_t seed = 0x00100001;
+				for (uint32_t index1 = 0; index1 < 0x100; ++index1) {
+					for (uint32_t index2 = index1, i = 0; i < 5; ++i, index2 += 0x100) {
+						seed = (seed * 125 + 3) % 0x2AAAAB;
+						const uint32_t temp1 = (seed & 0xFFFF) << 0x10;
+						seed = (seed * 125 + 3) % 0x2AAAAB;
+						const uint32_t temp2 = (seed & 0xFFFF);
+						v[index2] = temp1 | temp2;
+					}
+				}
+			}
+		};
+
+		const crypt_table crypt;
+
+		uint32_t hash_string(const char* str, hash_type type)
+		{
+			uint32_t seed1 = 0x7FED7FED;
+			uint32_t seed2 = 0xEEEEEEEE;
+			for (; *str; ++str) {
+				// file names are case insensitive and either slash works
+				uint32_t ch = (unsigned char)*str;
+				if (ch >= 'a' && ch <= 'z') {
+					ch -= 'a' - 'A';
+				}
+				else if (ch == '/') {
+					ch = '\\';
+				}
+				seed1 = crypt.v[type * 0x100 + ch] ^ (seed1 + seed2);
+				seed2 = ch + seed1 + seed2 + (seed2 << 5) + 3;
+			}
+			return seed1;
+		}
+
+		uint32_t read_u32(const unsigned char* p)
+		{
+			return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+		}
+
+		void write_u32(unsigned char* p, uint32_t v)
+		{
+			p[0] = (unsigned char)v;
+			p[1] = (unsigned char)(v >> 8);
+			p[2] = (unsigned char)(v >> 16);
+			p[3] = (unsigned char)(v >> 24);
+		}
+
+		// decrypt the whole 32 bit words of buf in place, any bytes left over at the end aren't encrypted
+		void decrypt(unsigned char* buf, size_t len, uint32_t key)
+		{
+			uint32_t seed = 0xEEEEEEEE;
+			for (size_t i = 0; i + 4 <= len; i += 4) {
+				seed += crypt.v[0x400 + (key & 0xFF)];
+				const uint32_t ch = read_u32(buf + i) ^ (key + seed);
+				key = ((~key << 0x15) + 0x11111111) | (key >> 0x0B);
+				seed = ch + seed + (seed << 5) + 3;
+				write_u32(buf + i, ch);
+			}
+		}
+
+		// read and decrypt a table of 16 byte entries, protected maps often claim more entries than the file holds so the missing ones are left empty
+		std::vector<unsigned char> read_table(const unsigned char* data, size_t size, uint32_t offset, uint32_t count, const char* name)
+		{
+			std::vector<unsigned char> table((size_t)count * 16, 0xFF);
+			if (offset < size) {
+				const size_t len = std::min<size_t>(table.size(), size - offset) & ~(size_t)3;
+				memcpy(table.data(), data + offset, len);
+				decrypt(table.data(), len, hash_string(name, HASH_FILE_KEY));
+			}
+			return table;
+		}
+	}
+
+	archive::archive()
+		: data_(nullptr)
+		, size_(0)
+		, sector_size_(0)
+	{ }
+
+	bool archive::open(const unsigned char* data, size_t size)
+	{
+		// the header is at a multiple of 512 bytes, a map starts with its own 512 byte header so it's usually the second try
+		size_t start = 0;
+		for (; start + 32 <= size; start += 0x200) {
+			if (read_u32(data + start) == MPQ_SIGNATURE) {
+				break;
+			}
+		}
+		if (start + 32 > size) {
+			return false;
+		}
+
+		// Warcraft III treats every archive as format version 1 and ignores the header and archive sizes which map protectors like to corrupt
+		data_ = data + start;
+		size_ = size - start;
+		sector_size_ = 0x200 << (data_[14] & 0x1F);
+		const uint32_t hash_offset = read_u32(data_ + 16);
+		const uint32_t block_offset = read_u32(data_ + 20);
+		const uint32_t hash_count = read_u32(data_ + 24);
+		const uint32_t block_count = std::min<uint32_t>(read_u32(data_ + 28), (uint32_t)(size_ / 16));
+
+		if (hash_count == 0 || hash_count > size_ / 16 || sector_size_ == 0) {
+			return false;
+		}
+
+		const std::vector<unsigned char> hashes = read_table(data_, size_, hash_offset, hash_count, "(hash table)");
+		hashes_.resize(hash_count);
+		for (uint32_t i = 0; i < hash_count; ++i) {
+			const unsigned char* p = hashes.data() + i * 16;
+			hashes_[i].name_a = read_u32(p);
+			hashes_[i].name_b = read_u32(p + 4);
+			hashes_[i].locale = (uint16_t)(p[8] | (p[9] << 8));
+			hashes_[i].platform = (uint16_t)(p[10] | (p[11] << 8));
+			hashes_[i].block = read_u32(p + 12);
+		}
+
+		const std::vector<unsigned char> blocks = read_table(data_, size_, block_offset, block_count, "(block table)");
+		blocks_.resize(block_count);
+		for (uint32_t i = 0; i < block_count; ++i) {
+			const unsigned char* p = blocks.data() + i * 16;
+			blocks_[i].offset = read_u32(p);
+			blocks_[i].csize = read_u32(p + 4);
+			blocks_[i].fsize = read_u32(p + 8);
+			blocks_[i].flags = read_u32(p + 12);
+		}
+		return true;
+	}
+
+	const archive::block_entry* archive::find(const char* filename) const
+	{
+		if (hashes_.empty()) {
+			return nullptr;
+		}
+
+		const uint32_t count = (uint32_t)hashes_.size();
+		const uint32_t name_a = hash_string(filename, HASH_NAME_A);
+		const uint32_t name_b = hash_string(filename, HASH_NAME_B);
+		const block_entry* result = nullptr;
+
+		// prefer the neutral locale like StormLib does when there's more than one version of the file
+		uint32_t index = hash_string(filename, HASH_TABLE_OFFSET) & (count - 1);
+		for (uint32_t i = 0; i < count && hashes_[index].block != MPQ_HASH_EMPTY; ++i, index = (index + 1) % count) {
+			const hash_entry& entry = hashes_[index];
+			if (entry.name_a != name_a || entry.name_b != name_b || entry.block == MPQ_HASH_DELETED || entry.block >= blocks_.size()) {
+				continue;
+			}
+			if (entry.locale == 0) {
+				return &blocks_[entry.block];
+			}
+			if (!result) {
+				result = &blocks_[entry.block];
+			}
+		}
+		return result;
+	}
+
+	bool archive::read_sector(const unsigned char* src, size_t srclen, uint32_t flags, uint32_t key, unsigned char* dst, size_t dstlen) const
+	{
+		std::vector<unsigned char> decrypted;
+		if (flags & MPQ_FILE_ENCRYPTED) {
+			decrypted.assign(src, src + srclen);
+			decrypt(decrypted.data(), srclen, key);
+			src = decrypted.data();
+		}
+
+		// a sector that didn't get any smaller is stored as it is
+		if (srclen == dstlen) {
+			memcpy(dst, src, dstlen);
+			return true;
+		}
+		if (srclen == 0 || srclen > dstlen) {
+			return false;
+		}
+		if (flags & MPQ_FILE_IMPLODE) {
+			return explode(src, srclen, dst, dstlen);
+		}
+
+		// the first byte says which compressions were used, the World Editor only ever uses one of these two
+		switch (src[0]) {
+		case MPQ_COMPRESSION_ZLIB:
+			return inflate(src + 1, srclen - 1, dst, dstlen);
+		case MPQ_COMPRESSION_PKWARE:
+			return explode(src + 1, srclen - 1, dst, dstlen);
+		default:
+			return false;
+		}
+	}
+
+	bool archive::read(const char* filename, std::string& buf) const
+	{
+		const block_entry* block = find(filename);
+		if (!block || !(block->flags & MPQ_FILE_EXISTS) || block->fsize == 0 || block->offset >= size_) {
+			return false;
+		}
+
+		const unsigned char* raw = data_ + block->offset;
+		const size_t avail = size_ - block->offset;
+		const uint32_t flags = block->flags;
+
+		// the key comes from the file name without its path
+		uint32_t key = 0;
+		if (flags & MPQ_FILE_ENCRYPTED) {
+			const char* name = filename;
+			for (const char* p = filename; *p; ++p) {
+				if (*p == '\\' || *p == '/') {
+					name = p + 1;
+				}
+			}
+			key = hash_string(name, HASH_FILE_KEY);
+			if (flags & MPQ_FILE_FIX_KEY) {
+				key = (key + block->offset) ^ block->fsize;
+			}
+		}
+
+		buf.resize(block->fsize);
+		unsigned char* out = (unsigned char*)&buf[0];
+
+		if (flags & MPQ_FILE_SINGLE_UNIT) {
+			return read_sector(raw, std::min<size_t>(block->csize, avail), flags, key, out, block->fsize);
+		}
+
+		const uint32_t sectors = (block->fsize + sector_size_ - 1) / sector_size_;
+
+		if (!(flags & (MPQ_FILE_COMPRESS | MPQ_FILE_IMPLODE))) {
+			if (avail < block->fsize) {
+				return false;
+			}
+			for (uint32_t i = 0; i < sectors; ++i) {
+				const size_t len = std::min<size_t>(sector_size_, block->fsize - i * sector_size_);
+				if (!read_sector(raw + (size_t)i * sector_size_, len, flags, key + i, out + (size_t)i * sector_size_, len)) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// compressed files start with a table of sector offsets, one more than there are sectors so the last one is the end of the data
+		const size_t table_len = ((size_t)sectors + 1) * 4;
+		if (avail < table_len) {
+			return false;
+		}
+		std::vector<unsigned char> table(raw, raw + table_len);
+		if (flags & MPQ_FILE_ENCRYPTED) {
+			decrypt(table.data(), table_len, key - 1);
+		}
+
+		for (uint32_t i = 0; i < sectors; ++i) {
+			const uint32_t start = read_u32(table.data() + i * 4);
+			const uint32_t end = read_u32(table.data() + i * 4 + 4);
+			if (start > end || end > avail) {
+				return false;
+			}
+			const size_t len = std::min<size_t>(sector_size_, block->fsize - i * sector_size_);
+			if (!read_sector(raw + start, end - start, flags, key + i, out + (size_t)i * sector_size_, len)) {
+				return false;
+			}
+		}
+		return true;
+	}
+}
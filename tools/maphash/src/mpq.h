@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace mpq
+{
+	// a read only MPQ reader with just enough of the format for Warcraft III maps (format version 1, zlib and binary implode compression)
+	// it works on the map file already in memory so the server can hash the same mapping it sends to players
+	class archive
+	{
+	public:
+		archive();
+
+		// data must outlive the archive, the files are read from it directly
+		bool open(const unsigned char* data, size_t size);
+
+		// read a whole file, false if it doesn't exist, is empty or can't be decompressed
+		bool read(const char* filename, std::string& buf) const;
+
+	private:
+		struct hash_entry
+		{
+			uint32_t name_a;
+			uint32_t name_b;
+			uint16_t locale;
+			uint16_t platform;
+			uint32_t block;
+		};
+
+		struct block_entry
+		{
+			uint32_t offset;
+			uint32_t csize;
+			uint32_t fsize;
+			uint32_t flags;
+		};
+
+		const block_entry* find(const char* filename) const;
+		bool read_sector(const unsigned char* src, size_t srclen, uint32_t flags, uint32_t key, unsigned char* dst, size_t dstlen) const;
+
+		const unsigned char* data_;  // the start of the archive (after the map header)
+		size_t size_;
+		uint32_t sector_size_;
+		std::vector<hash_entry> hashes_;
+		std::vector<block_entry> blocks_;
+	};
+}
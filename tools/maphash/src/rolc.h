@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
 namespace hash
@@ -16,7 +17,9 @@ namespace hash
 			return (x << 3) | (x >> 29);
 		}
 
-		void update(const unsigned char* buf, size_t len)
+		// each buffer is folded into a single value on its own before it's combined with the others
+		// so the files can be folded on different threads and combined in order afterwards
+		static uint32_t fold(const unsigned char* buf, size_t len)
 		{
 			uint32_t h = 0;
 			size_t i = 0;
@@ -26,7 +29,12 @@ namespace hash
 			for (; i < len; ++i) {
 				h = rol3(h ^ (uint32_t)buf[i]);
 			}
-			update(h);
+			return h;
+		}
+
+		void update(const unsigned char* buf, size_t len)
+		{
+			update(fold(buf, len));
 		}
 
 		void update(uint32_t v)
@@ -1,6 +1,16 @@
 #include "sha1.h"
+#include "cpu.h"
 #include <string.h>
 
+// the SHA intrinsics need Visual Studio 2015 or later
+#if defined(HASH_X86) && (!defined(_MSC_VER) || _MSC_VER >= 1900)
+#define HASH_SHA1_SHANI
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <smmintrin.h>
+#include <immintrin.h>
+#endif
+
 namespace hash
 {
 #define rol(value, bits) (((value) << (bits)) | ((value) >> (32 - (bits))))
@@ -20,7 +30,7 @@ namespace hash
 #define R3(v,w,x,y,z,i) z+=(((w|x)&y)|(w&x))+blk(i)+0x8F1BBCDC+rol(v,5);w=rol(w,30);
 #define R4(v,w,x,y,z,i) z+=(w^x^y)+blk(i)+0xCA62C1D6+rol(v,5);w=rol(w,30);
 
-	static void transform(uint32_t state[5], const unsigned char buffer[64])
+	static void transform_block(uint32_t state[5], const unsigned char buffer[64])
 	{
 		uint32_t a, b, c, d, e;
 		typedef union
@@ -123,6 +133,118 @@ namespace hash
 		state[4] += e;
 	}
 
+#undef R0
+#undef R1
+#undef R2
+#undef R3
+#undef R4
+#undef blk
+#undef blk0
+#undef rol
+
+	namespace
+	{
+		// both kernels hash count whole 64 byte blocks
+		void transform_scalar(uint32_t state[5], const unsigned char* data, size_t count)
+		{
+			for (; count > 0; --count, data += 64) {
+				transform_block(state, data);
+			}
+		}
+
+#ifdef HASH_SHA1_SHANI
+		// four rounds with the SHA extensions, based on Intel's "New Instructions Supporting the Secure Hash Algorithm on Intel Architecture Processors"
+		// m0 holds the message words for these rounds, the next ones are scheduled into m1, m2 and m3 as they're needed
+		// e holds e for these rounds and next receives a copy of abcd which is e for the rounds after
+#define SHA1_ROUNDS(g, e, next, m0, m1, m2, m3) \
+		e = (g) == 0 ? _mm_add_epi32(e, m0) : _mm_sha1nexte_epu32(e, m0); \
+		next = abcd; \
+		if ((g) >= 3 && (g) <= 18) { m1 = _mm_sha1msg2_epu32(m1, m0); } \
+		abcd = _mm_sha1rnds4_epu32(abcd, e, (g) / 5); \
+		if ((g) >= 1 && (g) <= 16) { m3 = _mm_sha1msg1_epu32(m3, m0); } \
+		if ((g) >= 2 && (g) <= 17) { m2 = _mm_xor_si128(m2, m0); }
+
+#ifndef _MSC_VER
+		__attribute__((target("sha,ssse3,sse4.1")))
+#endif
+		void transform_shani(uint32_t state[5], const unsigned char* data, size_t count)
+		{
+			const __m128i mask = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+			__m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)state), 0x1B);
+			__m128i e0 = _mm_set_epi32((int)state[4], 0, 0, 0);
+			__m128i e1;
+
+			for (; count > 0; --count, data += 64) {
+				const __m128i abcd_save = abcd;
+				const __m128i e0_save = e0;
+
+				__m128i m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 0)), mask);
+				__m128i m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16)), mask);
+				__m128i m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 32)), mask);
+				__m128i m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 48)), mask);
+
+				SHA1_ROUNDS(0, e0, e1, m0, m1, m2, m3)
+				SHA1_ROUNDS(1, e1, e0, m1, m2, m3, m0)
+				SHA1_ROUNDS(2, e0, e1, m2, m3, m0, m1)
+				SHA1_ROUNDS(3, e1, e0, m3, m0, m1, m2)
+				SHA1_ROUNDS(4, e0, e1, m0, m1, m2, m3)
+				SHA1_ROUNDS(5, e1, e0, m1, m2, m3, m0)
+				SHA1_ROUNDS(6, e0, e1, m2, m3, m0, m1)
+				SHA1_ROUNDS(7, e1, e0, m3, m0, m1, m2)
+				SHA1_ROUNDS(8, e0, e1, m0, m1, m2, m3)
+				SHA1_ROUNDS(9, e1, e0, m1, m2, m3, m0)
+				SHA1_ROUNDS(10, e0, e1, m2, m3, m0, m1)
+				SHA1_ROUNDS(11, e1, e0, m3, m0, m1, m2)
+				SHA1_ROUNDS(12, e0, e1, m0, m1, m2, m3)
+				SHA1_ROUNDS(13, e1, e0, m1, m2, m3, m0)
+				SHA1_ROUNDS(14, e0, e1, m2, m3, m0, m1)
+				SHA1_ROUNDS(15, e1, e0, m3, m0, m1, m2)
+				SHA1_ROUNDS(16, e0, e1, m0, m1, m2, m3)
+				SHA1_ROUNDS(17, e1, e0, m1, m2, m3, m0)
+				SHA1_ROUNDS(18, e0, e1, m2, m3, m0, m1)
+				SHA1_ROUNDS(19, e1, e0, m3, m0, m1, m2)
+
+				e0 = _mm_sha1nexte_epu32(e0, e0_save);
+				abcd = _mm_add_epi32(abcd, abcd_save);
+			}
+
+			_mm_storeu_si128((__m128i*)state, _mm_shuffle_epi32(abcd, 0x1B));
+			state[4] = (uint32_t)_mm_extract_epi32(e0, 3);
+		}
+
+#undef SHA1_ROUNDS
+#endif
+
+		typedef void (*transform_fn)(uint32_t state[5], const unsigned char* data, size_t count);
+
+		// picked once at static initialisation
+		struct sha1_dispatch
+		{
+			transform_fn fn;
+			const char* name;
+
+			sha1_dispatch()
+				: fn(transform_scalar)
+				, name("scalar")
+			{
+#ifdef HASH_SHA1_SHANI
+				if (cpu::sha() && cpu::ssse3() && cpu::sse41()) {
+					fn = transform_shani;
+					name = "sha-ni";
+				}
+#endif
+			}
+		};
+
+		const sha1_dispatch dispatch;
+	}
+
+	const char* sha1_kernel()
+	{
+		return dispatch.name;
+	}
+
 	sha1::sha1()
 	{
 		state[0] = 0x67452301;
@@ -145,11 +267,10 @@ namespace hash
 		if ((j + len) > 63)
 		{
 			memcpy(&buffer[j], buf, (i = 64 - j));
-			transform(state, buffer);
-			for (; i + 63 < len; i += 64)
-			{
-				transform(state, &buf[i]);
-			}
+			dispatch.fn(state, buffer, 1);
+			const size_t blocks = (len - i) / 64;
+			dispatch.fn(state, &buf[i], blocks);
+			i += blocks * 64;
 			j = 0;
 		}
 		else
@@ -1,9 +1,11 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
 namespace hash
 {
+	// x86 CPUs with the SHA extensions use them, everything else gets the portable code
 	class sha1
 	{
 	public:
@@ -16,4 +18,7 @@ namespace hash
 		uint32_t count[2];
 		unsigned char buffer[64];
 	};
+
+	// the name of the kernel sha1 picked for this CPU
+	const char* sha1_kernel();
 }